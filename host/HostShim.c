@@ -0,0 +1,154 @@
+/*
+    HostShim.c -- Register images and driver stubs so the ELS interrupt and
+    motor driver code can be linked into a Linux library.
+
+    Copyright (C) 2005  John Dammeyer
+
+    This file is part of The Electronic Lead Screw (ELS) Project.
+
+    ELS is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+	Or download here.
+	http://www.gnu.org/copyleft/gpl.html
+
+    John Dammeyer
+    johnd@autoartisans.com
+
+
+   	Initial Version: 0.00a
+
+   	Version changes:
+
+*/
+
+#include "Processor.h"
+
+#include "Common.h"
+#include "Config.h"
+#include "Serial.h"
+#include "Timer.h"
+#include "OB_EEROM.h"
+
+// *** SPECIAL FUNCTION REGISTER IMAGES ***
+volatile unsigned char PORTA, PORTB, PORTC, PORTD, PORTE;
+volatile unsigned char INTCON;
+volatile unsigned char SSPBUF, SSPSTAT, SSPCON1;
+volatile unsigned short CCPR1, ECCPR1;
+volatile unsigned char CCP1CON, ECCP1CON, T1CON, T3CON, TMR1L, TMR1H;
+volatile unsigned char T2CON, PR2;
+volatile unsigned char TMR0L, TMR0H;
+
+// On the PIC the PORTx and PORTxbits symbols share an address.  The host
+// keeps them separate; the ENCODER_PORT read only looks at PORTB.
+volatile typeof(PORTAbits) PORTAbits;
+volatile typeof(PORTBbits) PORTBbits;
+volatile typeof(PORTCbits) PORTCbits;
+volatile typeof(PORTDbits) PORTDbits;
+volatile typeof(LATAbits) LATAbits;
+volatile typeof(LATBbits) LATBbits;
+volatile typeof(LATCbits) LATCbits;
+volatile typeof(LATEbits) LATEbits;
+volatile typeof(INTCONbits) INTCONbits;
+volatile typeof(PIE1bits) PIE1bits;
+volatile typeof(PIR1bits) PIR1bits;
+volatile typeof(PIE2bits) PIE2bits;
+volatile typeof(PIR2bits) PIR2bits;
+volatile typeof(SSPSTATbits) SSPSTATbits;
+
+/*
+ *  FUNCTION: HostResetSFR
+ *
+ *  PARAMETERS:		None
+ *
+ *  DESCRIPTION:	Put the register images into the state InitHardware() leaves them in.
+ *					The SPI buffer full flag stays set so the micro-stepping busy waits
+ *					fall straight through.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+void
+HostResetSFR(void) {
+	PORTA = PORTB = PORTC = PORTD = PORTE = 0;
+	*(unsigned char *)&PORTAbits = 0;
+	*(unsigned char *)&PORTBbits = 0;
+	*(unsigned char *)&PORTCbits = 0;
+	*(unsigned char *)&PORTDbits = 0;
+	*(unsigned char *)&LATAbits = 0;
+	*(unsigned char *)&LATBbits = 0;
+	*(unsigned char *)&LATCbits = 0;
+	*(unsigned char *)&LATEbits = 0;
+	*(unsigned char *)&INTCONbits = 0;
+	*(unsigned char *)&PIR1bits = 0;
+	*(unsigned char *)&PIE1bits = 0;
+	*(unsigned char *)&PIR2bits = 0;
+	*(unsigned char *)&PIE2bits = 0;
+	TMR1L = TMR1H = 0;
+	INTCON = 0xC0;
+	PIE1bits.TMR2IE = 1;
+	INTCONbits.INT0E = 1;
+	*(unsigned char *)&SSPSTATbits = 0;
+	SSPSTATbits.BF = 1;
+}
+
+// *** EEROM ***
+// The on board EEROM becomes a RAM array that starts out erased.
+static uint8 HostEEROM[1024];
+
+void
+Put_ObEEROM_Byte( uint16 addr, uint8 data) {
+	HostEEROM[addr & 1023] = data;
+}
+
+uint8
+Get_ObEEROM_Byte(uint16 addr) {
+	return(HostEEROM[addr & 1023]);
+}
+
+void
+Put_ObEEROM_Float( uint16 addr, float32 * pdata ) {
+	memcpy(&HostEEROM[addr & 1023], pdata, sizeof(float32));
+}
+
+void
+Get_ObEEROM_Float(uint16 addr, float32 * pdata) {
+	memcpy(pdata, &HostEEROM[addr & 1023], sizeof(float32));
+}
+
+// *** TIMERS ***
+// The 10ms thread timers never expire on the host.  A harness that needs the
+// spindle stopped timeout sets HostTimersDone.
+volatile int16 TickCount;
+int8 HostTimersDone;
+
+void
+StartTimer( uint8 TimerNumber, int16 DelayTime ) {
+}
+
+int16
+TimerDone( uint8 TimerNumber ) {
+	return(HostTimersDone);
+}
+
+// *** SERIAL ***
+BITS CommFlags;
+
+void
+RxCharDevice(void) {
+}
+
+void
+TxCharDevice(void) {
+}
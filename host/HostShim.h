@@ -0,0 +1,272 @@
+/*
+    HostShim.h -- Hardware abstraction used to compile the ELS interrupt and
+    motor driver code natively on a Linux host.
+
+    Copyright (C) 2005  John Dammeyer
+
+    This file is part of The Electronic Lead Screw (ELS) Project.
+
+    ELS is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+	Or download here.
+	http://www.gnu.org/copyleft/gpl.html
+
+    John Dammeyer
+    johnd@autoartisans.com
+
+
+   	Initial Version: 0.00a
+
+   	Version changes:
+
+*/
+// HostShim.h -- Included by Processor.h in place of <p18cxxx.h> when HOST_BUILD is defined.
+//
+// The special function registers used by Int.c and MotorDriver.c become plain
+// RAM variables (defined in HostShim.c) so that a test harness can drive the
+// inputs (spindle sensor, ESTOP, MPG) and watch the outputs (step, direction, SPI).
+// Only the registers and bits the firmware actually touches are modelled.
+
+#ifndef __HOSTSHIM_H
+#define __HOSTSHIM_H
+
+// Bring the C library in first so the renames below don't touch its prototypes.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <float.h>
+
+// MPLAB-C18 storage qualifiers.
+#define rom		const
+#define far
+#define near
+#define ram
+
+// Serial.h has its own putchar/getc/ungetc with C18 prototypes that clash with stdio.
+#define putchar		ELS_putchar
+#define getc		ELS_getc
+#define ungetc		ELS_ungetc
+
+// Program memory copies are plain memory copies on the host.
+#define memcpypgm2ram	memcpy
+#define strcpypgm2ram	strcpy
+
+#define Nop()
+#define ClrWdt()
+#define Reset()		exit(0)
+
+// <delays.h>
+#define Delay1TCY()
+#define Delay10TCYx(n)
+#define Delay100TCYx(n)
+#define Delay1KTCYx(n)
+#define Delay10KTCYx(n)
+
+#define __18F4685	1
+
+extern volatile unsigned char PORTA, PORTB, PORTC, PORTD, PORTE;
+extern volatile union {
+  struct {
+	unsigned RA0:1;
+	unsigned RA1:1;
+	unsigned RA2:1;
+	unsigned RA3:1;
+	unsigned RA4:1;
+	unsigned RA5:1;
+	unsigned RA6:1;
+	unsigned RA7:1;
+  };
+} PORTAbits;
+extern volatile union {
+  struct {
+	unsigned RB0:1;
+	unsigned RB1:1;
+	unsigned RB2:1;
+	unsigned RB3:1;
+	unsigned RB4:1;
+	unsigned RB5:1;
+	unsigned RB6:1;
+	unsigned RB7:1;
+  };
+} PORTBbits;
+extern volatile union {
+  struct {
+	unsigned RC0:1;
+	unsigned RC1:1;
+	unsigned RC2:1;
+	unsigned RC3:1;
+	unsigned RC4:1;
+	unsigned RC5:1;
+	unsigned RC6:1;
+	unsigned RC7:1;
+  };
+} PORTCbits;
+extern volatile union {
+  struct {
+	unsigned RD0:1;
+	unsigned RD1:1;
+	unsigned RD2:1;
+	unsigned RD3:1;
+	unsigned RD4:1;
+	unsigned RD5:1;
+	unsigned RD6:1;
+	unsigned RD7:1;
+  };
+} PORTDbits;
+
+extern volatile union {
+  struct {
+	unsigned LATA0:1;
+	unsigned LATA1:1;
+	unsigned LATA2:1;
+	unsigned LATA3:1;
+	unsigned LATA4:1;
+	unsigned LATA5:1;
+	unsigned LATA6:1;
+	unsigned LATA7:1;
+  };
+} LATAbits;
+extern volatile union {
+  struct {
+	unsigned LATB0:1;
+	unsigned LATB1:1;
+	unsigned LATB2:1;
+	unsigned LATB3:1;
+	unsigned LATB4:1;
+	unsigned LATB5:1;
+	unsigned LATB6:1;
+	unsigned LATB7:1;
+  };
+} LATBbits;
+extern volatile union {
+  struct {
+	unsigned LATC0:1;
+	unsigned LATC1:1;
+	unsigned LATC2:1;
+	unsigned LATC3:1;
+	unsigned LATC4:1;
+	unsigned LATC5:1;
+	unsigned LATC6:1;
+	unsigned LATC7:1;
+  };
+} LATCbits;
+extern volatile union {
+  struct {
+	unsigned LATE0:1;
+	unsigned LATE1:1;
+	unsigned LATE2:1;
+	unsigned :5;
+  };
+} LATEbits;
+
+extern volatile unsigned char INTCON;
+extern volatile union {
+  struct {
+	unsigned RBIF:1;
+	unsigned INT0IF:1;
+	unsigned TMR0IF:1;
+	unsigned RBIE:1;
+	unsigned INT0IE:1;
+	unsigned TMR0IE:1;
+	unsigned PEIE:1;
+	unsigned GIE:1;
+  };
+  struct {
+	unsigned :1;
+	unsigned INT0F:1;
+	unsigned T0IF:1;
+	unsigned :1;
+	unsigned INT0E:1;
+	unsigned T0IE:1;
+	unsigned GIEL:1;
+	unsigned GIEH:1;
+  };
+} INTCONbits;
+
+extern volatile union {
+  struct {
+	unsigned TMR1IE:1;
+	unsigned TMR2IE:1;
+	unsigned CCP1IE:1;
+	unsigned SSPIE:1;
+	unsigned TXIE:1;
+	unsigned RCIE:1;
+	unsigned ADIE:1;
+	unsigned PSPIE:1;
+  };
+} PIE1bits;
+extern volatile union {
+  struct {
+	unsigned TMR1IF:1;
+	unsigned TMR2IF:1;
+	unsigned CCP1IF:1;
+	unsigned SSPIF:1;
+	unsigned TXIF:1;
+	unsigned RCIF:1;
+	unsigned ADIF:1;
+	unsigned PSPIF:1;
+  };
+} PIR1bits;
+
+extern volatile union {
+  struct {
+	unsigned ECCP1IE:1;
+	unsigned TMR3IE:1;
+	unsigned LVDIE:1;
+	unsigned BCLIE:1;
+	unsigned EEIE:1;
+	unsigned :1;
+	unsigned CMIE:1;
+	unsigned OSCFIE:1;
+  };
+} PIE2bits;
+extern volatile union {
+  struct {
+	unsigned ECCP1IF:1;
+	unsigned TMR3IF:1;
+	unsigned LVDIF:1;
+	unsigned BCLIF:1;
+	unsigned EEIF:1;
+	unsigned :1;
+	unsigned CMIF:1;
+	unsigned OSCFIF:1;
+  };
+} PIR2bits;
+
+extern volatile unsigned char SSPBUF, SSPSTAT, SSPCON1;
+extern volatile union {
+  struct {
+	unsigned BF:1;
+	unsigned UA:1;
+	unsigned R_W:1;
+	unsigned S:1;
+	unsigned P:1;
+	unsigned D_A:1;
+	unsigned CKE:1;
+	unsigned SMP:1;
+  };
+} SSPSTATbits;
+
+// CCPR1 and ECCPR1 are 16 bit register pairs in the C18 header too.
+extern volatile unsigned short CCPR1, ECCPR1;
+extern volatile unsigned char CCP1CON, ECCP1CON, T1CON, T3CON, TMR1L, TMR1H;
+extern volatile unsigned char T2CON, PR2;
+extern volatile unsigned char TMR0L, TMR0H;
+
+void HostResetSFR(void);
+
+#endif
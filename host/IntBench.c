@@ -0,0 +1,1339 @@
+/*
+    IntBench.c -- Cycle budget benchmark for the ELS step interrupt.
+
+    Copyright (C) 2005  John Dammeyer
+
+    This file is part of The Electronic Lead Screw (ELS) Project.
+
+    ELS is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+	Or download here.
+	http://www.gnu.org/copyleft/gpl.html
+
+    John Dammeyer
+    johnd@autoartisans.com
+
+
+   	Initial Version: 0.00a
+
+		The high priority interrupt (__INTH in Int.c) has to leave time for the main loop.  This
+		program runs it on a PC through a set of jog, threading, tapering and micro-stepping
+		scenarios.  Timer1 is simulated count by count so the Timer2 pulse clock and the CCP1/ECCP1
+		step compares interrupt at the times the hardware would.  Each interrupt is classified by
+		its source and by what it actually did (accelerated, stepped Z, stepped X on the taper,
+		saw the spindle index...) and its cost is recorded against that branch.
+
+		Int.c is compiled with -fsanitize-coverage=trace-pc so every basic block executed
+		inside __INTH calls __sanitizer_cov_trace_pc() below.  That count is the "ops" column;
+		it doesn't depend on the speed or load of the PC so numbers from two builds of the
+		interrupt routine can be compared directly.  Host nanoseconds are shown as well but
+		are only a rough guide.
+
+		The pass scenario also runs MovementThread() in the main loop and presses START
+		whenever the cycle stops, to show the depth and start each automatic pass is cut at.
+
+   	Version changes:
+
+*/
+
+#include "Processor.h"
+
+#include <time.h>
+#include <math.h>
+
+#include "Common.h"
+#include "Config.h"
+#include "Menu.h"
+#include "GlobVars.h"
+
+#include "Int.h"
+#include "MotorDriver.h"
+#include "MovementThread.h"
+
+void __INTH(void);
+extern int32 ZBackLashCount;
+extern int8 HostTimersDone;
+
+// *** PRIVATE DECLARATIONS ***
+#define MAX_BRANCHES		96
+#define MAIN_LOOP_TICKS		20			// Main loop runs MotorDevice() about once a millisecond.
+static uint16 MainLoopTicks;			// Ticks between MotorDevice() calls this scenario.
+static uint8 RunMovement;				// Main loop runs MovementThread() too.
+#define NEVER				0xFFFFFFFF
+
+// Things __INTH can do during one tick.
+#define B_Z_ACCEL			0x0001
+#define B_Z_STEP			0x0002
+#define B_Z_BACKLASH		0x0004
+#define B_Z_MICROSTEP		0x0008
+#define B_TAPER_X			0x0010
+#define B_X_ACCEL			0x0020
+#define B_X_STEP			0x0040
+#define B_SPINDLE_INDEX		0x0080
+#define B_MOVE_START		0x0100
+#define B_Z_ACTIVE			0x0200
+#define B_X_ACTIVE			0x0400
+#define B_MPG				0x0800
+#define B_TICK				0x1000		// Interrupt sources.
+#define B_CCP1				0x2000
+#define B_ECCP1				0x4000
+
+typedef struct {
+	uint16 mask;
+	uint32 ticks;
+	uint32 opsMin, opsMax;
+	double opsSum;
+	uint32 nsMax;
+	double nsSum;
+} BRANCH_STATS;
+
+static BRANCH_STATS Branches[MAX_BRANCHES];
+static int8 BranchCount;
+static BRANCH_STATS Worst;			// Worst single tick over all scenarios.
+static const char * WorstScenario;
+static const char * Scenario;
+static uint32 ScenarioInts;			// Interrupts and ops for the load figure.
+static double ScenarioOps;
+
+// *** PRIVATE VARIABLES ***
+static unsigned long TraceCount;	// Basic blocks executed in the traced code.
+
+// Simulated Timer1.  Counts at 10MHz from the start of each scenario.
+static uint32 SimTime;
+static uint32 NextTick;				// When Timer2 next matches PR2.
+static uint32 TickCount;
+
+// Simulated spindle.
+static double SpindleTicksPerRev;	// 0 when stopped.
+static double SpindlePhase;			// 0..1 revolutions.
+static double SpindleSlot = 0.05;	// Fraction of a revolution the sensor is high.
+static uint8 LastSpindle;
+static uint8 SensorSlots;			// Slots per revolution on the sensor disk.
+static uint8 SensorGap;				// 1 if a slot position is left out for the index.
+static uint16 SensorNoise;			// Pulse clocks the sensor is held high by noise.
+static uint16 EncoderLines;			// 0 for the one slot sensor.
+static int32 EncoderLine;			// Line the encoder is on.
+static uint32 EncoderTotal;			// Lines gone by.
+
+// Simulated MPG.
+static int16 MPGClicks;
+static uint8 MPGPhase;
+
+// *** PRIVATE FUNCTIONS ***
+
+/*
+ *  FUNCTION: __sanitizer_cov_trace_pc
+ *
+ *  PARAMETERS:		None
+ *
+ *  DESCRIPTION:	Called by gcc instrumentation at every basic block of Int.c.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+void
+__sanitizer_cov_trace_pc(void) {
+	TraceCount++;
+}
+
+static uint32
+NowNs(void) {
+  struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return((uint32)(ts.tv_sec * 1000000000UL + ts.tv_nsec));
+}
+
+/*
+ *  FUNCTION: BranchName
+ *
+ *  PARAMETERS:		mask	-- B_xxx bits for one tick.
+ *
+ *  DESCRIPTION:	Turns the branch bits into a short description.
+ *
+ *  RETURNS: 		Pointer to static text.
+ *
+ */
+static const char *
+BranchName(uint16 mask) {
+  static char name[96];
+	name[0] = '\0';
+	if (mask & B_TICK)				strcat(name, "tick ");
+	if (mask & B_CCP1)				strcat(name, "ccp1 ");
+	if (mask & B_ECCP1)				strcat(name, "eccp1 ");
+	if (!(mask & (B_Z_ACTIVE | B_X_ACTIVE)))
+		strcat(name, "idle ");
+	if (mask & B_Z_ACTIVE) {
+		strcat(name, "Z");
+		if (mask & B_Z_ACCEL)		strcat(name, ":ramp");
+		if (mask & B_Z_STEP)		strcat(name, ":step");
+		if (mask & B_Z_BACKLASH)	strcat(name, ":backlash");
+		if (mask & B_Z_MICROSTEP)	strcat(name, ":spi");
+		if (mask & B_TAPER_X)		strcat(name, ":taperX");
+		strcat(name, " ");
+	}
+	if (mask & B_X_ACTIVE) {
+		strcat(name, "X");
+		if (mask & B_X_ACCEL)		strcat(name, ":ramp");
+		if (mask & B_X_STEP)		strcat(name, ":step");
+		strcat(name, " ");
+	}
+	if (mask & B_SPINDLE_INDEX)		strcat(name, "index ");
+	if (mask & B_MOVE_START)		strcat(name, "start ");
+	if (mask & B_MPG)				strcat(name, "mpg ");
+	return(name);
+}
+
+static void
+Record(uint16 mask, uint32 ops, uint32 ns) {
+  int8 i;
+  BRANCH_STATS * b;
+
+	for (i=0; i<BranchCount; i++)
+		if (Branches[i].mask == mask)
+			break;
+	if (i == BranchCount) {
+		if (BranchCount == MAX_BRANCHES)
+			return;
+		BranchCount++;
+		memset(&Branches[i], 0, sizeof(BRANCH_STATS));
+		Branches[i].mask = mask;
+		Branches[i].opsMin = 0xFFFFFFFF;
+	}
+	b = &Branches[i];
+	ScenarioInts++;
+	ScenarioOps += ops;
+	b->ticks++;
+	b->opsSum += ops;
+	b->nsSum += ns;
+	if (ops < b->opsMin) b->opsMin = ops;
+	if (ops > b->opsMax) b->opsMax = ops;
+	if (ns > b->nsMax) b->nsMax = ns;
+
+	if (ops > Worst.opsMax) {
+		Worst.opsMax = ops;
+		Worst.mask = mask;
+		WorstScenario = Scenario;
+	}
+}
+
+/*
+ *  FUNCTION: PulseClockInputs
+ *
+ *  PARAMETERS:		None
+ *
+ *  DESCRIPTION:	Moves the simulated spindle sensor and MPG on by one PULSE_CLOCK period.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+static void
+PulseClockInputs(void) {
+	// Spindle encoder: INT0 on every line.  Lines never come faster than the pulse clock.
+	if (EncoderLines) {
+		if (SpindleTicksPerRev > 0.0) {
+			SpindlePhase += 1.0 / SpindleTicksPerRev;
+			if (SpindlePhase >= 1.0)
+				SpindlePhase -= 1.0;
+			if ((int32)(SpindlePhase * EncoderLines) != EncoderLine) {
+				EncoderLine = (int32)(SpindlePhase * EncoderLines);
+				EncoderTotal++;
+				if (INTCONbits.INT0E)
+					INTCONbits.INT0F = 1;
+			}
+		}
+	}
+	// Spindle sensor: high for SpindleSlot of a revolution at each of SensorSlots slots.  With
+	// SensorGap the last of SensorSlots + 1 positions has no slot.
+	else if (SpindleTicksPerRev > 0.0) {
+		SpindlePhase += 1.0 / SpindleTicksPerRev;
+		if (SpindlePhase >= 1.0)
+			SpindlePhase -= 1.0;
+		bSPINDLE = (fmod(SpindlePhase * (SensorSlots + SensorGap), 1.0) < SpindleSlot * (SensorSlots + SensorGap))
+					&& !(SensorGap && ((int)(SpindlePhase * (SensorSlots + SensorGap)) == SensorSlots));
+	}
+	else
+		bSPINDLE = 0;
+	if (SensorNoise) {
+		SensorNoise--;
+		bSPINDLE = 1;
+	}
+	if (LastSpindle && !bSPINDLE && INTCONbits.INT0E)	// INT0 fires on the falling edge.
+		INTCONbits.INT0F = 1;
+	LastSpindle = bSPINDLE;
+
+	// MPG quadrature: one state change every 10 ticks while clicks are pending.
+	if (MPGClicks && (TickCount % 10) == 0) {
+		MPGPhase = (MPGPhase + 1) & 3;
+		PORTB = (PORTB & ~ENCODER_MASK) | ((MPGPhase ^ (MPGPhase >> 1)) << 4);
+		MPGClicks--;
+	}
+}
+
+/*
+ *  FUNCTION: Interrupt
+ *
+ *  PARAMETERS:		None
+ *
+ *  DESCRIPTION:	Calls __INTH with Timer1 at SimTime and works out which branches it took.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+static void
+Interrupt(void) {
+  uint16 mask = 0;
+  uint32 zPer, xPer;
+  int32 zPos, xPos, zBack, xBack;
+  int8 phaseA;
+  uint16 spinClocks;
+  uint8 moveBSY, encoder;
+  uint32 t0, t1;
+  unsigned long ops;
+
+	if (PIE1bits.TMR2IE && PIR1bits.TMR2IF)		mask |= B_TICK;
+	if (PIE1bits.CCP1IE && PIR1bits.CCP1IF)		mask |= B_CCP1;
+	if (PIE2bits.ECCP1IE && PIR2bits.ECCP1IF)	mask |= B_ECCP1;
+
+	TMR1L = SimTime;
+	TMR1H = SimTime >> 8;
+	encoder = ZEncoderCounter;
+	zPer = ZStepPeriod; xPer = XStepPeriod;
+	zPos = ZMotorPosition; xPos = XMotorRelPosition;
+	zBack = ZBackLashCount; xBack = XBackLashCount;
+	phaseA = PhaseAIndex;
+	spinClocks = SpindleClockValue;
+	moveBSY = fZMoveBSY;
+	if (fZAxisActive) mask |= B_Z_ACTIVE;
+	if (fXAxisActive) mask |= B_X_ACTIVE;
+
+	TraceCount = 0;
+	t0 = NowNs();
+	__INTH();
+	t1 = NowNs();
+	ops = TraceCount;
+
+	if (ZStepPeriod != zPer)				mask |= B_Z_ACCEL;
+	if (ZMotorPosition != zPos)				mask |= B_Z_STEP;
+	if (ZBackLashCount != zBack)			mask |= B_Z_BACKLASH;
+	if (PhaseAIndex != phaseA)				mask |= B_Z_MICROSTEP;
+	if (XStepPeriod != xPer)				mask |= B_X_ACCEL;
+	if (XMotorRelPosition != xPos) {
+		if ((mask & B_Z_STEP) && fTapering)	mask |= B_TAPER_X;
+		else								mask |= B_X_STEP;
+	}
+	else if (XBackLashCount != xBack)		mask |= B_X_STEP;
+	if (SpindleClockValue < spinClocks)			// Counter restarts on each index pulse.
+		mask |= B_SPINDLE_INDEX;
+	if (!moveBSY && fZMoveBSY)				mask |= (B_MOVE_START | B_Z_ACTIVE);
+	if (ZEncoderCounter != encoder)			mask |= B_MPG;
+
+	Record(mask, (uint32)ops, t1 - t0);
+}
+
+// Time of the next Timer1 match with a compare register.
+static uint32
+NextCompare(uint16 ccpr) {
+  uint16 delta = ccpr - (uint16)SimTime;
+	return(SimTime + (delta ? delta : 0x10000));
+}
+
+/*
+ *  FUNCTION: Event
+ *
+ *  PARAMETERS:		None
+ *
+ *  DESCRIPTION:	Moves Timer1 on to the next pulse clock or step compare, raises the
+ *					interrupt flags and runs __INTH until no enabled flag is left set.
+ *					__INTH sets a step flag itself when an axis starts from a stop.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+static void
+Event(void) {
+  uint32 t, tz, tx;
+  uint8 tick;
+
+	tz = PIE1bits.CCP1IE ? NextCompare(CCPR1) : NEVER;
+	tx = PIE2bits.ECCP1IE ? NextCompare(ECCPR1) : NEVER;
+	t = NextTick;
+	if (tz < t) t = tz;
+	if (tx < t) t = tx;
+	if ((t >> 16) != (SimTime >> 16))	// Timer1 overflowed on the way.
+		PIR1bits.TMR1IF = 1;
+	SimTime = t;
+
+	tick = (t == NextTick);
+	if (tick) {
+		PulseClockInputs();
+		PIR1bits.TMR2IF = 1;
+		NextTick += PULSE_CLOCK_DIVISOR;
+	}
+	if (t == tz) PIR1bits.CCP1IF = 1;
+	if (t == tx) PIR2bits.ECCP1IF = 1;
+
+	do {
+		Interrupt();
+	} while ((PIE1bits.TMR2IE && PIR1bits.TMR2IF) || (PIE1bits.CCP1IE && PIR1bits.CCP1IF)
+				|| (PIE2bits.ECCP1IE && PIR2bits.ECCP1IF));
+
+	if (tick && (++TickCount % MainLoopTicks) == 0) {
+		MotorDevice();
+		if (RunMovement)
+			MovementThread();
+	}
+}
+
+static void
+RunTicks(uint32 n) {
+  uint32 end = TickCount + n;
+	while (TickCount < end)
+		Event();
+}
+
+// Run until both axes have stopped or the limit is reached.
+static void
+RunUntilIdle(uint32 limit) {
+  uint32 end = TickCount + limit;
+	while ((TickCount < end) && (fZMoveRQ || fZMoveBSY || fXMoveBSY || fZAxisActive || fXAxisActive || fArcing))
+		Event();
+}
+
+static void
+SetSpindleRPM(float32 rpm) {
+	SpindleTicksPerRev = (rpm > 0.0) ? (PULSE_CLOCK_RATE * 60.0) / rpm : 0.0;
+}
+
+/*
+ *  FUNCTION: BeginScenario
+ *
+ *  PARAMETERS:		name	-- Shown in the report.
+ *
+ *  DESCRIPTION:	Puts the registers, EEROM defaults and motor driver back to power up.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+static void
+BeginScenario(const char * name) {
+	Scenario = name;
+	BranchCount = 0;
+	ScenarioInts = 0;
+	ScenarioOps = 0.0;
+	SimTime = 0;
+	NextTick = PULSE_CLOCK_DIVISOR;
+	TickCount = 0;
+	printf("\n%s\n", Scenario);
+	HostResetSFR();
+	HostTimersDone = 0;
+
+	InitDefaultGlobalVars();
+	SYSFlags.Byte = 0;			// ESTOP and LIMIT not inverted, no on board micro-stepping.
+	ZMotorFlags.Byte = 0;
+	XMotorFlags.Byte = 0;
+	TaperFlags.Byte = 0;
+	ZDistanceDivisor = GetGlobalVarFloat(MOTOR_STEPS_REV_Z_NDX) / GetGlobalVarFloat(LEADSCREW_IPITCH_NDX);
+	XDistanceDivisor = GetGlobalVarLong(MOTOR_STEPS_REV_X_NDX) / GetGlobalVarFloat(CROSS_SLIDE_IPITCH_NDX);
+	MotionPitchIndex = THREAD_SIZE_NDX;
+	SystemState = MACHINE_READY;
+	SystemError = 0;
+
+	ActiveFlags.Byte = 0;			// Axes stopped so InitMotorDevice() can build the ramp tables.
+	InitMotorDevice();
+	InitInterruptVariables();
+	CONTROLFlags.Byte = 0;
+
+	SetSpindleRPM(0.0);
+	SpindlePhase = 0.0;
+	LastSpindle = 0;
+	SensorSlots = 1;
+	SensorGap = 0;
+	SensorNoise = 0;
+	MainLoopTicks = MAIN_LOOP_TICKS;
+	RunMovement = 0;
+	EncoderLines = 0;
+	EncoderLine = 0;
+	MPGClicks = 0;
+}
+
+static int
+CompareBranch(const void * a, const void * b) {
+	return(((BRANCH_STATS *)a)->mask - ((BRANCH_STATS *)b)->mask);
+}
+
+static void
+EndScenario(void) {
+  int8 i;
+  BRANCH_STATS * b;
+  uint32 worstOps = 0;
+
+	qsort(Branches, BranchCount, sizeof(BRANCH_STATS), CompareBranch);
+	printf("  %-40s %9s %6s %8s %6s %8s %7s\n", "branch", "ints", "ops<", "ops avg", "ops>", "ns avg", "ns>");
+	for (i=0; i<BranchCount; i++) {
+		b = &Branches[i];
+		printf("  %-40s %9u %6u %8.1f %6u %8.1f %7u\n", BranchName(b->mask), b->ticks,
+				b->opsMin, b->opsSum / b->ticks, b->opsMax, b->nsSum / b->ticks, b->nsMax);
+		if (b->opsMax > worstOps)
+			worstOps = b->opsMax;
+	}
+	printf("  worst interrupt: %u ops\n", worstOps);
+	printf("  load: %u interrupts in %.2f s, %.0f ops/mS\n", ScenarioInts, SimTime / (double)STEP_TIMER_RATE,
+			ScenarioOps / (SimTime / (double)(STEP_TIMER_RATE / 1000)));
+	if (SystemError)
+		printf("  SystemError = %d\n", SystemError);
+}
+
+// *** SCENARIOS ***
+
+static void
+JogScenario(void) {
+	BeginScenario("Z jog at slew rate, then stop");
+	MotorJog(MOTOR_Z, (WORD)GetGlobalVarWord(SLEW_RATE_Z_NDX), MOVE_RIGHT);
+	RunTicks(2 * PULSE_CLOCK_RATE);
+	MotorStop(MOTOR_Z);
+	RunUntilIdle(10L * PULSE_CLOCK_RATE);
+	EndScenario();
+
+	BeginScenario("Z and X distance moves with direction reversal (backlash)");
+	SystemZBackLashCount = 20;
+	SetGlobalVarFloat(X_AXIS_BACKLASH_NDX, 0.002);
+	MotorMoveDistance(MOTOR_Z, 8000, (WORD)GetGlobalVarWord(MOVE_RATE_Z_NDX), MOVE_RIGHT, SPINDLE_EITHER, 0);
+	MotorMoveDistance(MOTOR_X, 2000, (WORD)GetGlobalVarWord(MOVE_RATE_X_NDX), MOVE_OUT, SPINDLE_EITHER, 0);
+	RunUntilIdle(20L * PULSE_CLOCK_RATE);
+	MotorMoveDistance(MOTOR_Z, 8000, (WORD)GetGlobalVarWord(MOVE_RATE_Z_NDX), MOVE_LEFT, SPINDLE_EITHER, 0);
+	MotorMoveDistance(MOTOR_X, 2000, (WORD)GetGlobalVarWord(MOVE_RATE_X_NDX), MOVE_IN, SPINDLE_EITHER, 0);
+	RunUntilIdle(20L * PULSE_CLOCK_RATE);
+	EndScenario();
+
+	BeginScenario("MPG knob turned while idle");
+	MPGClicks = 400;
+	RunTicks(5000);
+	EndScenario();
+}
+
+static void
+ThreadingScenario(void) {
+  int8 err;
+
+	BeginScenario("Threading 20 TPI at 400 RPM, spindle sags 10% mid pass");
+	SetSpindleRPM(400.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);	// Let MotorDevice() settle the average.
+	err = MotorMoveDistance(MOTOR_Z, 16000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	if (err)
+		printf("  MotorMoveDistance error %d\n", err);
+	RunTicks(PULSE_CLOCK_RATE);
+	SetSpindleRPM(360.0);
+	RunUntilIdle(30L * PULSE_CLOCK_RATE);
+	printf("  Z moved %d steps\n", ZMotorPosition);
+	EndScenario();
+}
+
+// Run until a requested Z move has started.  Returns the spindle phase it started at.
+static double
+PhaseAtStart(void) {
+  uint32 start = TickCount;
+	while (fZMoveRQ && (TickCount < start + 10L * PULSE_CLOCK_RATE))
+		Event();
+	return(SpindlePhase);
+}
+
+static void
+SlotScenario(void) {
+  int8 err;
+  int16 revs;
+  double at;
+
+	BeginScenario("Threading 20 TPI with a 4 slot sensor at 400 RPM, spindle sags 10% mid pass");
+	SensorSlots = 4;
+	SensorGap = 1;
+	fXThreading = 1;
+	GlobalVars[SPINDLE_PULSE_REV_NDX].l = SensorSlots;
+	InitInterruptVariables();
+	SetSpindleRPM(400.0);
+	RunTicks(PULSE_CLOCK_RATE);		// Settles in a quarter of the revolutions.
+	printf("  RPM after 1 s: %d, index %s\n", AverageRPM, fSpindleIndexed ? "found" : "not found");
+	err = MotorMoveDistance(MOTOR_Z, 16000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	if (err)
+		printf("  MotorMoveDistance error %d\n", err);
+	at = PhaseAtStart();
+	RunTicks(PULSE_CLOCK_RATE);
+	SetSpindleRPM(360.0);
+	RunUntilIdle(30L * PULSE_CLOCK_RATE);
+	printf("  Z moved %d steps, RPM %d, started at %.3f rev\n", ZMotorPosition, AverageRPM, at);
+
+	// A noise edge in the gap puts the slot count one out.
+	while (SpindlePhase < 0.9)
+		Event();
+	SensorNoise = 10;
+	for (revs=0; revs<10; revs++) {
+		RunTicks((uint32)(PULSE_CLOCK_RATE * 60.0 / 360.0));
+		if (fSpindleIndexed)
+			break;
+	}
+	printf("  Noise edge: index found again in %d revs\n", revs + 1);
+	err = MotorMoveDistance(MOTOR_Z, 1000, SPEED_TRACK_SPINDLE, MOVE_LEFT, SPINDLE_TURNING, 0);
+	at = PhaseAtStart();
+	RunUntilIdle(10L * PULSE_CLOCK_RATE);
+	printf("  Next pass started at %.3f rev\n", at);
+
+	// Evenly spaced slots have no index to find.
+	SensorGap = 0;
+	RunTicks(PULSE_CLOCK_RATE);
+	err = MotorMoveDistance(MOTOR_Z, 1000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	printf("  No gap: MotorMoveDistance %s\n", (err == MSG_SPINDLE_INDEX_ERROR) ? "refused" : "didn't refuse");
+	fXThreading = 0;
+	EndScenario();
+}
+
+// The spindle estimator predicts the period at the index a thread starts on.
+int32 PredictClocksPerRev(int16 updates);
+
+static void
+SpinUpScenario(void) {
+  int8 i;
+
+	BeginScenario("Spindle estimate while the spindle speeds up from 300 to 400 RPM in 2 s");
+	SetSpindleRPM(300.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);
+	for (i=1; i<=20; i++) {
+		SetSpindleRPM(300.0 + 5.0 * i);
+		RunTicks(PULSE_CLOCK_RATE / 10);
+	}
+	printf("  At 400 RPM: RPM %d, next rev predicted at %ld RPM\n", AverageRPM,
+			(SPINDLE_CLOCK_RATE * 60L) / PredictClocksPerRev(1));
+	EndScenario();
+
+	BeginScenario("Same with a 4 slot sensor and the main loop only every 50 ms");
+	SensorSlots = 4;
+	SensorGap = 1;
+	GlobalVars[SPINDLE_PULSE_REV_NDX].l = SensorSlots;
+	InitInterruptVariables();
+	MainLoopTicks = PULSE_CLOCK_RATE / 20;
+	SetSpindleRPM(300.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);
+	for (i=1; i<=20; i++) {
+		SetSpindleRPM(300.0 + 2.5 * i);
+		RunTicks(PULSE_CLOCK_RATE / 20);
+	}
+	// The next rev averages about 354 RPM.
+	printf("  At 350 RPM: RPM %d, next rev predicted at %ld RPM\n", AverageRPM,
+			(SPINDLE_CLOCK_RATE * 60L) / PredictClocksPerRev(SpindleSlots));
+	EndScenario();
+}
+
+// Run until a requested Z move has started.  Returns the wait in milliseconds.
+static double
+WaitForStart(void) {
+  uint32 start = TickCount;
+	while (fZMoveRQ && (TickCount < start + 10L * PULSE_CLOCK_RATE))
+		Event();
+	return((TickCount - start) * 1000.0 / PULSE_CLOCK_RATE);
+}
+
+// Start a pass from a third of a turn past the index, first waiting for the index and then
+// moving on to the spindle phase.  Both have to end on the same helix, and the phase start
+// mustn't lose a turn by getting there late.
+static void
+PhaseStartScenario(void) {
+  static const int32 jerks[] = { 0, 180000 };
+  int32 steps;
+  uint16 rate;
+  uint32 start;
+  double wait, indexEnd, off;
+  int8 i;
+
+	BeginScenario("Threading 20 TPI at 60 RPM from the index and from the spindle phase, without and with jerk");
+	rate = GetGlobalVarWord(MOVE_RATE_Z_NDX);
+	SetSpindleRPM(60.0);
+	RunTicks(5 * PULSE_CLOCK_RATE);
+	for (i = 0; i < 2; i++) {
+		SetGlobalVarLong(JERK_RATE_Z_NDX, jerks[i]);
+		printf("  Jerk %ld:\n", (long)jerks[i]);
+		while ((SpindlePhase < 0.33) || (SpindlePhase > 0.34))
+			Event();
+		MotorMoveDistance(MOTOR_Z, 16000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+		wait = WaitForStart();
+		RunUntilIdle(60L * PULSE_CLOCK_RATE);
+		indexEnd = SpindlePhase;
+		printf("    Index start: waited %.0f mS, Z moved %d steps, ended at spindle phase %.3f\n",
+				wait, ZMotorPosition, SpindlePhase);
+
+		MotorMoveDistance(MOTOR_Z, 16000, rate, MOVE_LEFT, SPINDLE_EITHER, 0);
+		RunUntilIdle(30L * PULSE_CLOCK_RATE);
+		while ((SpindlePhase < 0.33) || (SpindlePhase > 0.34))
+			Event();
+		start = TickCount;
+		steps = ThreadPhaseSteps(GetGlobalVarWord(SLEW_RATE_Z_NDX), 16000);
+		if (steps != 0) {
+			MotorMoveDistance(MOTOR_Z, steps, GetGlobalVarWord(SLEW_RATE_Z_NDX), MOVE_RIGHT, SPINDLE_EITHER, 0);
+			RunUntilIdle(30L * PULSE_CLOCK_RATE);
+		}
+		MotorMoveDistance(MOTOR_Z, 16000 - steps, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+		WaitForStart();
+		wait = (TickCount - start) * 1000.0 / PULSE_CLOCK_RATE;
+		RunUntilIdle(60L * PULSE_CLOCK_RATE);
+		off = SpindlePhase - indexEnd;
+		off = (off - floor(off + 0.5)) * LeadScrewRatio;	// Steps off the index start's helix.
+		printf("    Phase start: moved on %d steps, started after %.0f mS, Z moved %d steps, ended at spindle phase %.3f\n",
+				steps, wait, ZMotorPosition, SpindlePhase);
+		printf("    %s: %.1f steps off the helix, %s\n", ((fabs(off) <= 1.0) && (wait < 1000.0)) ? "PASS" : "FAIL",
+				off, (wait < 1000.0) ? "no turn lost" : "a turn lost");
+
+		MotorMoveDistance(MOTOR_Z, 16000, rate, MOVE_LEFT, SPINDLE_EITHER, 0);
+		RunUntilIdle(30L * PULSE_CLOCK_RATE);
+	}
+	EndScenario();
+}
+
+// Start each pass ThreadRunUpSteps() before the thread at 200 and 400 RPM, then from the start
+// of the thread itself.  Where Z is on the lead at an index once it's up to speed is the helix
+// being cut.  With the run-up it should be the same at both speeds.
+static void
+RunUpScenario(void) {
+  static const float32 rpms[] = { 200.0, 400.0 };
+  int32 runUp, begin;
+  double last, helix;
+  int8 i, revs, up;
+
+	BeginScenario("Threading 20 TPI at 200 and 400 RPM with and without the run-up");
+	for (i = 0; i < 4; i++) {
+		SetSpindleRPM(rpms[i & 1]);
+		RunTicks(15 * PULSE_CLOCK_RATE);		// Long enough for the estimate to forget the last speed.
+		runUp = (i < 2) ? ThreadRunUpSteps(16000) : 0;
+		begin = ZMotorPosition + runUp;
+		MotorMoveDistance(MOTOR_Z, 16000 + runUp, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+		WaitForStart();
+		up = 0;
+		last = SpindlePhase;
+		for (revs = 0; fZMoveBSY && (revs < 2); ) {
+			Event();
+			if (!up && (ZMotorPosition >= begin))
+				up = fZUpToSpeed + 1;
+			if (SpindlePhase < last)
+				revs++;
+			last = SpindlePhase;
+		}
+		helix = fmod((float32)(ZMotorPosition - begin) + 100.0 * LeadScrewRatio, LeadScrewRatio);
+		printf("  %3.0f RPM: run-up %ld steps, %s at the thread start, on the lead at %.0f steps\n",
+				rpms[i & 1], (long)runUp, (up == 2) ? "up to speed" : "ramping", helix);
+		RunUntilIdle(60L * PULSE_CLOCK_RATE);
+	}
+	EndScenario();
+}
+
+/*
+ *  FUNCTION: IndexHelix
+ *
+ *  PARAMETERS:		until	-- Give up once Z gets here.
+ *
+ *  DESCRIPTION:	Runs to the next index once Z is up to speed.
+ *
+ *  RETURNS: 		Z on the lead there, or -1 if it wasn't up to speed before until.
+ *
+ */
+static double
+IndexHelix(int32 until) {
+  double last;
+
+	last = SpindlePhase;
+	while (fZMoveBSY && (ZMotorPosition < until)) {
+		Event();
+		if ((SpindlePhase < last) && fZUpToSpeed && !fZDeccel)
+			return(fmod((double)ZMotorPosition, LeadScrewRatio));
+		last = SpindlePhase;
+	}
+	return(-1.0);
+}
+
+static void
+HoldScenario(void) {
+  int32 heldAt, at;
+  double before, after;
+  int8 err;
+
+	BeginScenario("Feed hold threading 20 TPI at 300 RPM, resumed at 250 RPM");
+	SetSpindleRPM(300.0);
+	RunTicks(15 * PULSE_CLOCK_RATE);
+	MotorMoveDistance(MOTOR_Z, 16000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	WaitForStart();
+	before = IndexHelix(16000);
+	RunTicks(PULSE_CLOCK_RATE);
+	heldAt = ZMotorPosition;
+	if ((err = MotorFeedHold()) != 0)
+		printf("  MotorFeedHold error %d\n", err);
+	RunUntilIdle(60L * PULSE_CLOCK_RATE);
+	printf("  held at %ld, stopped at %ld\n", (long)heldAt, (long)ZMotorPosition);
+	SetSpindleRPM(250.0);
+	RunTicks(15 * PULSE_CLOCK_RATE);
+	at = MotorResumeAt(16000, 0, 0);
+	MotorMoveTo(MOTOR_Z, at, GetGlobalVarWord(SLEW_RATE_Z_NDX), SPINDLE_EITHER);
+	RunUntilIdle(60L * PULSE_CLOCK_RATE);
+	MotorMoveTo(MOTOR_Z, 16000, SPEED_TRACK_SPINDLE, SPINDLE_TURNING);
+	WaitForStart();
+	after = IndexHelix(16000);
+	printf("  resumed from %ld, on the lead at %.0f steps before the hold and %.0f after\n",
+			(long)at, before, after);
+	RunUntilIdle(60L * PULSE_CLOCK_RATE);
+	EndScenario();
+}
+
+// Pull X out over the last lead at 1 X step per 2 Z steps.  X should start with Z still
+// following the spindle and take exactly half the Z steps.
+static void
+PullOutScenario(void) {
+  int32 x0, zAt = -1;
+  int8 locked = 0;
+
+	BeginScenario("Thread pull-out over the last lead of 20 TPI at 300 RPM after a 0.005\" backlash infeed");
+	SetSpindleRPM(300.0);
+	RunTicks(15 * PULSE_CLOCK_RATE);
+	x0 = XMotorRelPosition;
+	GlobalVars[X_AXIS_BACKLASH_NDX].f = 0.005;
+	fXDirection = MOVE_IN ^ fMXInvertDirMotor;		// The infeed went in.
+	MotorMoveDistance(MOTOR_Z, 16000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	MotorPullOut((int32)(LeadScrewRatio + 0.5), (int32)(LeadScrewRatio / 2.0 + 0.5), MOVE_OUT);
+	GlobalVars[X_AXIS_BACKLASH_NDX].f = 0.0;
+	printf("  %ld X backlash steps to take up first\n", (long)PullOutBacklash);
+	while ((fZMoveRQ || fZMoveBSY || fZAxisActive) && (TickCount < 120L * PULSE_CLOCK_RATE)) {
+		Event();
+		if ((zAt < 0) && (XMotorRelPosition != x0)) {
+			zAt = ZMotorPosition;
+			locked = fThreading;
+		}
+	}
+	printf("  X started %ld steps from the end %s, pulled out %ld steps\n", (long)(ZMotorPosition - zAt),
+			locked ? "following the spindle" : "off the spindle", (long)(XMotorRelPosition - x0));
+	EndScenario();
+}
+
+static void
+PassScenario(float32 retract) {
+  enum MOVEMENT_STATES last = MOVE_WAIT;
+  int16 pass = 0;
+  int16 runOn = 0;
+  int8 finished = 0;
+  int32 z0, x0;
+  uint32 start;
+
+	BeginScenario("Automatic passes of a 3 start thread, 0.15\" lead: depth and Z start of each pass");
+	printf("  X retracts to %.2f\"\n", retract);
+	GlobalVars[RETRACTED_X_NDX].f = retract;
+	GlobalVars[THREAD_SIZE_NDX].f = 0.15;
+	GlobalVars[THREAD_STARTS_NDX].l = 3;
+	GlobalVars[THREAD_END_NDX].f = -0.3;
+	GlobalVars[PASS_FIRST_X_DEPTH_NDX].f = 0.005;
+	GlobalVars[PASS_EACH_X_DEPTH_NDX].f = 0.004;
+	GlobalVars[PASS_END_X_DEPTH_NDX].f = 0.002;
+	GlobalVars[DEPTH_X_NDX].f = 0.013;
+	GlobalVars[PASS_SPRING_CNT_NDX].l = 1;
+	fAutoX = 1;
+	fXThreading = 1;
+	InitMovementThread();
+	fExternalThreading = (XBeginPosition < XRetractedPosition);
+	fMovingRight = (ZBeginPosition < ZEndPosition);
+	fMovingOut = !fExternalThreading;
+	z0 = ZBeginPositionSteps;
+	x0 = XBeginPositionSteps;
+	XMotorRelPosition = XRetractedPositionSteps;
+	SetSpindleRPM(300.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);
+	RunMovement = 1;
+	start = SimTime;
+	// Press START whenever the cycle stops, and once more after the last depth.
+	while ((finished < 2) && (TickCount < 600L * PULSE_CLOCK_RATE)) {
+		if (!fRunMachine && fMTRdy) {
+			if (PassState == FINISHED_PASSES)
+				if (++finished == 2)
+					break;
+			fRunMachine = 1;
+			MovementStartThread();
+		}
+		Event();
+		if ((MovementState != last) && (MovementState == MOVE_TO_END))
+			printf("  pass %2d: depth %3ld X steps, Z start %+4ld steps\n", ++pass,
+					(long)labs(XBeginPositionSteps - x0), (long)(ZBeginPositionSteps - z0));
+#ifdef MOTION_QUEUE
+		if ((MovementState != last) && (MovementState == MOVE_WAIT_X_DONE) && (XQueueTail != XQueueHead))
+			runOn++;			// Infeed queued behind the approach.
+#endif
+		last = MovementState;
+	}
+	printf("  %d passes in %.3f s, X ran on through the clearance point on %d\n", pass,
+			(SimTime - start) / (double)STEP_TIMER_RATE, runOn);
+	RunMovement = 0;
+	fXThreading = 0;
+	fAutoX = 0;
+	EndScenario();
+}
+
+// CalculatePosition() has no prototype in MovementThread.h.
+void CalculatePosition(int8 holdPosition);
+
+/*
+ *  FUNCTION: PassDepths
+ *
+ *  PARAMETERS:		depths	-- Filled in with the X depth of each pass in steps.
+ *
+ *  DESCRIPTION:	Steps the pass state machine through a thread from CALCULATE_PASSES the way
+ *					MOVE_TO_END does and notes how deep each pass goes.
+ *
+ *  RETURNS: 		Number of passes.
+ *
+ */
+static int16
+PassDepths(int32 * depths) {
+  int32 x0;
+  int16 n = 0;
+
+	InitMovementThread();
+	x0 = XBeginPositionSteps;
+	SetCalculatePositionState(CALCULATE_PASSES);
+	for (;;) {
+		CalculatePosition(0);
+		if ((PassState == FINISHED_PASSES) || (n == 64))
+			return(n);
+		depths[n++] = labs(XBeginPositionSteps - x0);
+	}
+}
+
+// Constant area passes for a thread against the FRST, EACH, LAST passes of the same thread.  The
+// table has to go deeper every pass, finish on DEPTH_X with the LAST pass on its own and never
+// cut a first pass deeper than FRST.  One too deep for the table mustn't start, and if it's made
+// too deep once started the FRST, EACH, LAST passes are cut instead.
+static void
+AreaPassScenario(void) {
+  static const float32 threads[][3] = {		// DEPTH_X, FRST, LAST
+	{ 0.013, 0.005, 0.002 }, { 0.025, 0.006, 0.0 }, { 0.0243, 0.005, 0.0 }, { 0.040, 0.005, 0.002 }
+  };
+  int32 depths[64];
+  float32 perInch;
+  int16 n, plain, i, t;
+  int8 ok;
+
+	BeginScenario("Constant area infeed: pass depths in X steps against the FRST, EACH, LAST passes");
+	perInch = GetGlobalVarLong(MOTOR_STEPS_REV_X_NDX) / GetGlobalVarFloat(CROSS_SLIDE_IPITCH_NDX);
+	GlobalVars[PASS_EACH_X_DEPTH_NDX].f = 0.004;
+	GlobalVars[PASS_SPRING_CNT_NDX].l = 0;
+	fAutoX = 1;
+	fXThreading = 1;
+	for (t = 0; t < 4; t++) {	// The last is too deep for the table.
+		GlobalVars[DEPTH_X_NDX].f = threads[t][0];
+		GlobalVars[PASS_FIRST_X_DEPTH_NDX].f = threads[t][1];
+		GlobalVars[PASS_END_X_DEPTH_NDX].f = threads[t][2];
+		fConstantArea = 0;
+		plain = PassDepths(depths);
+		fConstantArea = 1;
+		n = PassDepths(depths);
+		printf("  %.4f\" deep, FRST %.4f\", LAST %.4f\": %d passes against %d,", threads[t][0],
+				threads[t][1], threads[t][2], n, plain);
+		for (i = 0; i < n; i++)
+			printf(" %ld", (long)depths[i]);
+		ok = (n > 0) && (depths[0] <= (int32)(threads[t][1] * perInch + 0.5))
+				&& (depths[n - 1] == (int32)(threads[t][0] * perInch + 0.5));
+		for (i = 1; i < n; i++)
+			ok &= (depths[i] > depths[i - 1]);
+		if (t == 3)
+			ok &= (n == plain);
+		else if ((threads[t][2] > 0.0) && (n > 1))
+			ok &= (labs(depths[n - 1] - depths[n - 2] - (int32)(threads[t][2] * perInch + 0.5)) <= 1);
+		printf("\n    %s\n", ok ? "PASS" : "FAIL");
+	}
+
+	// The last thread needs more passes than the table holds so START refuses it.
+	RunMovement = 1;
+	fRunMachine = 1;
+	MovementStartThread();
+	RunTicks(PULSE_CLOCK_RATE / 10);
+	printf("  START on the last thread: %s\n", (SystemError == MSG_AREA_PASSES_ERROR) ? "refused" : "not refused");
+	RunMovement = 0;
+	fXThreading = 0;
+	fAutoX = 0;
+	EndScenario();
+}
+
+/*
+ *  FUNCTION: GearOff
+ *
+ *  PARAMETERS:		lines	-- EncoderTotal when the pass started.
+ *					z		-- ZMotorPosition then.
+ *
+ *  DESCRIPTION:	How far Z is from where the gearbox puts it for the lines since the start.
+ *
+ *  RETURNS: 		Steps Z is behind.  Negative if it's ahead.
+ *
+ */
+static long
+GearOff(uint32 lines, int32 z) {
+	return((long)((unsigned long long)(EncoderTotal - lines) * GearNumerator / GearDenominator) - (long)(ZMotorPosition - z));
+}
+
+static void
+GearingScenario(void) {
+  int8 err;
+  uint32 lines = 0, first = 0, t0 = 0;
+  int32 z = 0, runUp;
+  int8 locked = 0;
+
+	BeginScenario("Gearing 20 TPI off a 1000 line encoder at 400 RPM, spindle sags 10% mid pass");
+	EncoderLines = 1000;
+	GlobalVars[ENCODER_LINES_NDX].l = EncoderLines;
+	InitInterruptVariables();
+	SetSpindleRPM(400.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);
+	runUp = ThreadRunUpSteps(16000);
+	err = MotorMoveDistance(MOTOR_Z, 16000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	if (err)
+		printf("  MotorMoveDistance error %d\n", err);
+	// Z has to ramp up from the index and catch up with the lines before they step it.
+	while (fZMoveRQ && (TickCount < 10L * PULSE_CLOCK_RATE))
+		Event();
+	lines = EncoderTotal;
+	z = ZMotorPosition;
+	t0 = SimTime;
+	while (fZMoveBSY && !locked) {
+		Event();
+		if (!first && (ZMotorPosition - z == 2))
+			first = SimTime - t0;
+		locked = fGearing && (ZTopPeriod == 0);
+	}
+	printf("  First 2 steps took %.0f us, %.0f us geared.  On the lines %ld steps and %.3f s in, %ld off\n",
+			first * 1e6 / STEP_TIMER_RATE, 2.0 * GearDenominator * 1e6 * 60.0 / (400.0 * EncoderLines * GearNumerator),
+			(long)(ZMotorPosition - z), (SimTime - t0) / (double)STEP_TIMER_RATE, GearOff(lines, z));
+	RunTicks(PULSE_CLOCK_RATE);
+	printf("  A second on, %ld steps off the lines.  Run-up %ld steps\n", GearOff(lines, z), (long)runUp);
+	SetSpindleRPM(360.0);
+	RunUntilIdle(30L * PULSE_CLOCK_RATE);
+	printf("  Z moved %d steps, %u/%u steps per line\n", ZMotorPosition, GearNumerator, GearDenominator);
+	EndScenario();
+}
+
+/*
+ *  FUNCTION: MetricThread
+ *
+ *  PARAMETERS:		lock	-- 0 to cut it on the float ratio alone.
+ *
+ *  DESCRIPTION:	Cuts 1.5mm on the 10 TPI leadscrew with the one slot sensor, 120000/127
+ *					steps per rev, with the spindle sagging 10% part way.  Z is compared with
+ *					the exact pitch on every revolution once up to speed.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+static void
+MetricThread(int8 lock) {
+  int8 err;
+  int32 z0 = 0, revs = -1;
+  double off, first = 0.0, worst = 0.0, last = 0.0, phase;
+  uint32 num, den;
+
+	SetGlobalVarFloat(THREAD_SIZE_NDX, 1.5 / 25.4);
+	SetupGearRatio(THREAD_SIZE_NDX, &num, &den);
+	printf("  %u/%u steps per rev\n", num, den);
+	SetSpindleRPM(400.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);
+	err = MotorMoveDistance(MOTOR_Z, 64000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	if (err)
+		printf("  MotorMoveDistance error %d\n", err);
+	if (!lock)
+		fPitchLock = 0;
+	phase = SpindlePhase;
+	while ((fZMoveRQ || fZMoveBSY) && (TickCount < 60L * PULSE_CLOCK_RATE)) {
+		Event();
+		if ((TickCount == 5L * PULSE_CLOCK_RATE) && (SpindleTicksPerRev != 0.0))
+			SetSpindleRPM(360.0);
+		if ((SpindlePhase < phase) && fZMoveBSY && fZUpToSpeed && !fZDeccel) {	// Once a revolution.
+			if (revs < 0)
+				z0 = ZMotorPosition;
+			revs++;
+			off = (ZMotorPosition - z0) - revs * 120000.0 / 127.0;
+			if (revs == 1)
+				first = off;
+			if (fabs(off - first) > worst)
+				worst = fabs(off - first);
+			last = off - first;
+		}
+		phase = SpindlePhase;
+	}
+	RunUntilIdle(10L * PULSE_CLOCK_RATE);
+	printf("  Z moved %d steps, %d revolutions up to speed, %.2f steps off the pitch at the end, worst %.2f\n",
+			ZMotorPosition, revs, last, worst);
+}
+
+/*
+ *  FUNCTION: TrackDrop
+ *
+ *  PARAMETERS:		accel	-- ACCEL_RATE_Z_NDX for the pass.
+ *
+ *  DESCRIPTION:	Threads 20 TPI at 300 RPM while a heavy cut pulls a belt drive down 40% in
+ *					one go, and lets it pick up again 3 s later.  Z is compared with the pitch on
+ *					every revolution once up to speed, as for MetricThread().
+ *
+ *					With the one slot sensor Z doesn't hear of the drop until the next index.
+ *					Up to then it runs at the old speed, up to 300/180 - 1 of a lead ahead by the
+ *					time the spindle has made the turn, whatever tracking does.  That's the bound.
+ *					Past the index it's down to how fast SpinSlew lets Z follow and the pitch lock
+ *					has to have paid the steps back by the end of the pass.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+static void
+TrackDrop(int32 accel) {
+  int32 z0 = 0, revs = -1;
+  double off, first = 0.0, worst = 0.0, last = 0.0, phase, bound;
+  uint16 slewed = 0;
+
+	SetGlobalVarLong(ACCEL_RATE_Z_NDX, accel);
+	SetSpindleRPM(300.0);
+	RunTicks(15 * PULSE_CLOCK_RATE);
+	MotorMoveDistance(MOTOR_Z, 64000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	printf("  ACCEL_RATE_Z %ld, SpinSlew %ld of %ld spindle clocks a rev\n", (long)accel, (long)SpinSlew, (long)SpinRate);
+	phase = SpindlePhase;
+	while ((fZMoveRQ || fZMoveBSY) && (TickCount < 60L * PULSE_CLOCK_RATE)) {
+		Event();
+		if (TickCount == 20L * PULSE_CLOCK_RATE)
+			SetSpindleRPM(180.0);
+		if (TickCount == 23L * PULSE_CLOCK_RATE) {
+			SetSpindleRPM(300.0);
+			slewed = TrackSlewed;
+		}
+		if ((SpindlePhase < phase) && fZMoveBSY && fZUpToSpeed && !fZDeccel) {
+			if (revs < 0)
+				z0 = ZMotorPosition;
+			revs++;
+			off = (ZMotorPosition - z0) - revs * (double)LeadScrewRatio;
+			if (revs == 1)
+				first = off;
+			if (fabs(off - first) > worst)
+				worst = fabs(off - first);
+			last = off - first;
+		}
+		phase = SpindlePhase;
+	}
+	RunUntilIdle(10L * PULSE_CLOCK_RATE);
+	printf("  %d revolutions up to speed, %.2f steps off the pitch at the end, worst %.2f\n", revs, last, worst);
+	printf("  Slewed %u slowing down and %u speeding up\n", slewed, TrackSlewed - slewed);
+	printf("  ");
+	PrintTracking();
+	bound = LeadScrewRatio * (300.0 / 180.0 - 1.0);		// The turn Z can't know about.
+	printf("  %s: worst %.0f steps against a bound of %.0f, %.2f at the end\n",
+			((worst <= bound) && (fabs(last) <= 1.0)) ? "PASS" : "FAIL", worst, bound, last);
+}
+
+static void
+TrackingScenario(void) {
+	BeginScenario("Threading 20 TPI at 300 RPM, spindle drops 40% mid pass and picks up again");
+	TrackDrop(9000);
+	EndScenario();
+
+	// Slow enough that SpinSlew holds Z back both ways.
+	BeginScenario("Same with Z accelerating at a tenth of the default");
+	TrackDrop(900);
+	EndScenario();
+}
+
+static void
+RationalScenario(void) {
+	BeginScenario("1.5mm thread on a 10 TPI leadscrew at 400 RPM, spindle sags 10%, float ratio only");
+	MetricThread(0);
+	EndScenario();
+
+	BeginScenario("1.5mm thread on a 10 TPI leadscrew at 400 RPM, spindle sags 10%, held to 120000/127");
+	MetricThread(1);
+	EndScenario();
+}
+
+static void
+TaperScenario(void) {
+	BeginScenario("Taper turning MT2 (0.04995\"/\") at move rate");
+	fTapering = 1;
+	fTaperDirection = 1;
+	TaperTangent = (uint32)3274 * 3 << 16;		// Z and X step sizes differ on the default setup.
+	MotorMoveDistance(MOTOR_Z, 16000, (WORD)GetGlobalVarWord(MOVE_RATE_Z_NDX), MOVE_LEFT, SPINDLE_EITHER, 0);
+	RunUntilIdle(30L * PULSE_CLOCK_RATE);
+	printf("  Z moved %d steps, X moved %d steps\n", ZMotorPosition, XMotorRelPosition);
+	EndScenario();
+}
+
+static void
+SteepTaperScenario(void) {
+  int8 err;
+
+	BeginScenario("Steep taper with X the master, 0.3 Z steps per X step at 300 RPM");
+	fTapering = 1;
+	fTaperSteep = 1;
+	fTaperDirection = 1;
+	fXThreading = 0;
+	TaperTangent = (uint32)(0.3 * 4294967296.0);
+	SetSpindleRPM(300.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);
+	err = MotorTaperMove(-3000);
+	if (err)
+		printf("  MotorTaperMove error %d\n", err);
+	RunUntilIdle(30L * PULSE_CLOCK_RATE);
+	printf("  Z moved %d steps, X moved %d steps\n", ZMotorPosition, XMotorRelPosition);
+	EndScenario();
+}
+
+static void
+ArcScenario(void) {
+  int8 err;
+  int32 r = 4000;		// 0.25" on Z.
+  double x, z, off, worst = 0.0;
+  uint32 start, end;
+
+	BeginScenario("Quarter circle 0.25\" ball at 0.005\"/rev and 600 RPM, X backlash 0.002\"");
+	MotionPitchIndex = TURN_PITCH_NDX;
+	SetGlobalVarFloat(X_AXIS_BACKLASH_NDX, 0.002);
+	SetSpindleRPM(600.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);
+	ZMotorPosition = r;					// Tip of the ball with the centre at 0, 0.
+	XMotorRelPosition = 0;
+	start = SimTime;
+	end = TickCount + 30L * PULSE_CLOCK_RATE;
+	err = MotorArcMove(0, (int32)(0.25 * XDistanceDivisor), 0, 0);
+	if (err)
+		printf("  MotorArcMove error %d\n", err);
+	while (fArcing && (TickCount < end)) {
+		Event();
+		x = XMotorRelPosition / XDistanceDivisor;
+		z = ZMotorPosition / ZDistanceDivisor;
+		off = fabs(sqrt(x * x + z * z) - 0.25);
+		if (off > worst)
+			worst = off;
+	}
+	RunUntilIdle(PULSE_CLOCK_RATE);
+	printf("  Z at %d, X at %d after %.3f s, furthest off the circle %.6f\"\n", ZMotorPosition, XMotorRelPosition,
+			(SimTime - start) / (double)STEP_TIMER_RATE, worst);
+	EndScenario();
+}
+
+static void
+SCurveScenario(void) {
+	BeginScenario("S-curve Z move at slew rate and an X move too short to reach its speed");
+	SetGlobalVarLong(JERK_RATE_Z_NDX, 180000);	// About 50mS to build up the acceleration.
+	SetGlobalVarLong(JERK_RATE_X_NDX, 60000);
+	MotorMoveDistance(MOTOR_Z, 16000, (WORD)GetGlobalVarWord(SLEW_RATE_Z_NDX), MOVE_RIGHT, SPINDLE_EITHER, 0);
+	MotorMoveDistance(MOTOR_X, 300, (WORD)GetGlobalVarWord(SLEW_RATE_X_NDX), MOVE_OUT, SPINDLE_EITHER, 0);
+	RunUntilIdle(30L * PULSE_CLOCK_RATE);
+	printf("  Z moved %d steps, X moved %d steps\n", ZMotorPosition, XMotorRelPosition);
+	EndScenario();
+}
+
+// Z segments at slew, move and slew rate one way then back, and X out, out and in.
+static void
+QueueMoves(int8 queued) {
+  uint16 slewZ = GetGlobalVarWord(SLEW_RATE_Z_NDX);
+  uint16 moveZ = GetGlobalVarWord(MOVE_RATE_Z_NDX);
+  uint16 slewX = GetGlobalVarWord(SLEW_RATE_X_NDX);
+  int32 z[4] = { 6000, 3000, 6000, 4000 };
+  uint16 zRate[4];
+  uint8 zDir[4] = { MOVE_RIGHT, MOVE_RIGHT, MOVE_RIGHT, MOVE_LEFT };
+  int32 x[3] = { 800, 800, 600 };
+  uint8 xDir[3] = { MOVE_OUT, MOVE_OUT, MOVE_IN };
+  int8 i;
+
+	zRate[0] = zRate[2] = zRate[3] = slewZ;
+	zRate[1] = moveZ;
+	for (i=0; i<4; i++) {
+		if (queued) {
+			MotorQueueMove(MOTOR_Z, z[i], zRate[i], zDir[i]);
+			if (i < 3)
+				MotorQueueMove(MOTOR_X, x[i], slewX, xDir[i]);
+		}
+		else {
+			MotorMoveDistance(MOTOR_Z, z[i], zRate[i], zDir[i], SPINDLE_EITHER, 0);
+			if (i < 3)
+				MotorMoveDistance(MOTOR_X, x[i], slewX, xDir[i], SPINDLE_EITHER, 0);
+			RunUntilIdle(30L * PULSE_CLOCK_RATE);
+		}
+	}
+	RunUntilIdle(30L * PULSE_CLOCK_RATE);
+}
+
+static void
+QueueScenario(void) {
+  uint32 start;
+  double single;
+
+	BeginScenario("Motion queue: Z and X segments one at a time, then queued with look-ahead");
+	SetGlobalVarLong(SLEW_RATE_X_NDX, 8000);
+	QueueMoves(0);
+	single = SimTime / (double)STEP_TIMER_RATE;
+	printf("  One at a time: Z at %d, X at %d after %.3f s\n", ZMotorPosition, XMotorRelPosition, single);
+	start = SimTime;
+	QueueMoves(1);
+	printf("  Queued: Z at %d, X at %d after %.3f s\n", ZMotorPosition, XMotorRelPosition,
+			(SimTime - start) / (double)STEP_TIMER_RATE);
+	EndScenario();
+}
+
+static void
+MicroStepScenario(void) {
+	BeginScenario("On board micro-stepping Z jog with X jog");
+	fZLocalMicroStep = 1;
+	MotorJog(MOTOR_Z, (WORD)GetGlobalVarWord(MOVE_RATE_Z_NDX), MOVE_RIGHT);
+	MotorJog(MOTOR_X, (WORD)GetGlobalVarWord(MOVE_RATE_X_NDX), MOVE_OUT);
+	RunTicks(2 * PULSE_CLOCK_RATE);
+	MotorStop(MOTOR_Z);
+	MotorStop(MOTOR_X);
+	RunUntilIdle(10L * PULSE_CLOCK_RATE);
+	EndScenario();
+
+	BeginScenario("Everything at once: micro-stepped threading on a taper, X jog, MPG");
+	fZLocalMicroStep = 1;
+	fTapering = 1;
+	TaperTangent = (uint32)3274 * 3 << 16;
+	SetSpindleRPM(300.0);
+	RunTicks(3 * PULSE_CLOCK_RATE);
+	MotorMoveDistance(MOTOR_Z, 8000, SPEED_TRACK_SPINDLE, MOVE_RIGHT, SPINDLE_TURNING, 0);
+	MotorJog(MOTOR_X, (WORD)GetGlobalVarWord(SLEW_RATE_X_NDX), MOVE_OUT);
+	MPGClicks = 1000;
+	RunTicks(4 * PULSE_CLOCK_RATE);
+	MotorStop(MOTOR_X);
+	RunUntilIdle(30L * PULSE_CLOCK_RATE);
+	EndScenario();
+}
+
+int
+main(void) {
+	printf("ELS __INTH benchmark.  PULSE_CLOCK_RATE %u Hz, %u instruction cycles per tick at 10 MIPS.\n",
+			PULSE_CLOCK_RATE, PULSE_CLOCK_DIVISOR);
+	printf("ops = basic blocks executed inside Int.c for one interrupt.\n");
+
+	JogScenario();
+	ThreadingScenario();
+	SlotScenario();
+	SpinUpScenario();
+	PhaseStartScenario();
+	RunUpScenario();
+	HoldScenario();
+	PullOutScenario();
+	PassScenario(0.1);
+	PassScenario(0.4);
+	AreaPassScenario();
+	GearingScenario();
+	RationalScenario();
+	TrackingScenario();
+	TaperScenario();
+	SteepTaperScenario();
+	ArcScenario();
+	SCurveScenario();
+	QueueScenario();
+	MicroStepScenario();
+
+	printf("\nWorst interrupt overall: %u ops, %s(%s)\n", Worst.opsMax, BranchName(Worst.mask), WorstScenario);
+	return(0);
+}
@@ -0,0 +1,447 @@
+/*
+    MenuCheck.c -- Consistency check and navigation index for the ELS menu tables.
+
+    Copyright (C) 2005  John Dammeyer
+
+    This file is part of The Electronic Lead Screw (ELS) Project.
+
+    ELS is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+	Or download here.
+	http://www.gnu.org/copyleft/gpl.html
+
+    John Dammeyer
+    johnd@autoartisans.com
+
+
+   	Initial Version: 0.00a
+
+		MenuData[] in MenuScript.c is edited by hand and the records point at each other,
+		at GlobalVars[], at the EEROM flag bytes and at the GlobalMinimums/GlobalMaximums
+		tables by number.  Nothing in C18 checks any of that so a wrong link only shows up
+		when somebody presses the key.  This program links against the real tables, compiled
+		from src/MenuScript.c and src/GlobVars.c, and checks:
+
+			- every menu's text is exactly LCD_MENU_SIZE characters,
+			- MENU_TYPE soft key links and FLAG_TYPE scroll links are inside MenuData[],
+			- the FLAG_TYPE scroll list is properly double linked,
+			- GIndex is inside GlobalVars[] and every menu using it agrees on its type,
+			- the value field (Pos, Len width and decimals) fits on the second LCD line,
+			- FLAG_TYPE EEROM locations, bit numbers and FlagText[] entries are valid and
+			  clear of EM_GLOBAL_COUNT,
+			- LIST_TYPE element counts match their lists,
+			- FLOAT_TYPE metric dependancies point at a FLAG_TYPE menu,
+			- the menus KeyThread.c jumps to by number are the type it expects,
+			- GlobalMinimums <= GlobalMaximums and GlobalVars[] fits in EEROM,
+			- every menu can be reached.
+
+		Errors make it exit with 1 so "make menucheck" fails the build.
+
+		"MenuCheck -i" also prints the navigation tree and the EEROM layout.
+
+   	Version changes:
+
+*/
+
+#include "Processor.h"
+
+#include <stdarg.h>
+
+#include "Common.h"
+#include "Config.h"
+#include "Menu.h"
+#include "MenuScript.h"
+#include "GlobVars.h"
+
+extern rom TMENU_DATA MenuData[MENU_ITEMS];
+extern const rom TMENU_LIST MorseTaperList[NUMBER_OF_MORSE_TAPERS];
+extern const rom TMENU_LIST JacobTaperList[NUMBER_OF_JACOB_TAPERS];
+extern const rom TMENU_LIST AssortedTaperList[NUMBER_OF_ASSORTED_TAPERS];
+
+// *** PRIVATE DECLARATIONS ***
+#define NO_LINK			0xFF		// Unused link in a FLAG_TYPE record.
+#define FIRST_EEROM_FLAG	EM_SYS_FLAGS
+
+// Menus KeyThread.c and ELeadscrew.c select by number rather than through a link.
+static const struct {
+	uint8 Menu;
+	uint8 Format;
+	const char * From;
+} FixedMenus[] = {
+	{ SIGNON_MENU_INDEX,	MENU_TYPE,	"sign on" },
+	{ RUN_SETUP_MENU_INDEX,	MENU_TYPE,	"KEY_TURN, KEY_ESC" },
+	{ 0x19,					FLOAT_TYPE,	"KEY_BEGIN" },
+	{ 0x1A,					FLOAT_TYPE,	"KEY_END" },
+	{ 0x25,					MENU_TYPE,	"taper choices" },
+	{ 0x34,					MENU_TYPE,	"thread parameters" },
+	{ 0x41,					FLAG_TYPE,	"taper flag" },
+	{ 0x45,					FLOAT_TYPE,	"first pass depth" },
+};
+#define FIXED_MENUS		(sizeof(FixedMenus) / sizeof(FixedMenus[0]))
+
+// LIST_TYPE menus by the GlobalVars[] index that holds the selection.
+static const struct {
+	uint8 GIndex;
+	uint8 Count;
+} Lists[] = {
+	{ MORSE_TAPER_LIST_NDX,		NUMBER_OF_MORSE_TAPERS },
+	{ JACOBS_TAPER_LIST_NDX,	NUMBER_OF_JACOB_TAPERS },
+	{ ASSORTED_TAPER_LIST_NDX,	NUMBER_OF_ASSORTED_TAPERS },
+};
+#define LISTS			(sizeof(Lists) / sizeof(Lists[0]))
+
+static const char * FormatNames[] = {
+	"MENU", "BYTE", "INT", "WORD", "LONG", "ULONG", "FLOAT", "MNEM", "LIST", "FLAG"
+};
+
+static int Errors, Warnings;
+static uint8 Reached[MENU_ITEMS];
+static uint8 Listed[MENU_ITEMS];
+
+// Int.c in libels_host.a is built with basic block tracing for IntBench.
+void
+__sanitizer_cov_trace_pc(void) {
+}
+
+static void
+Error(uint8 menu, const char * fmt, ...) {
+  va_list ap;
+	printf("error: MenuData[0x%02X] ", menu);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putc('\n', stdout);
+	Errors++;
+}
+
+static void
+Warning(uint8 menu, const char * fmt, ...) {
+  va_list ap;
+	printf("warning: MenuData[0x%02X] ", menu);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putc('\n', stdout);
+	Warnings++;
+}
+
+static const char *
+FormatName(uint8 format) {
+	return((format <= FLAG_TYPE) ? FormatNames[format] : "?");
+}
+
+// First line of the menu text without the trailing blanks.
+static const char *
+Title(uint8 menu) {
+  static char s[LCD_LINE_LENGTH+1];
+  int8 i;
+	memcpy(s, MenuData[menu].Menubuf, LCD_LINE_LENGTH);
+	s[LCD_LINE_LENGTH] = '\0';
+	for (i=LCD_LINE_LENGTH-1; (i >= 0) && (s[i] == ' '); i--)
+		s[i] = '\0';
+	return(s);
+}
+
+// Where a menu's links go.  Returns the number of links put in next[].
+static int
+Links(uint8 menu, uint8 * next) {
+  const TMENU_DATA * p = &MenuData[menu];
+  int n = 0;
+  int8 i;
+	if (p->GIndex == 0) {
+		for (i=0; i<4; i++)
+			next[n++] = p->Data.Next[i];
+	}
+	else if ((uint8)p->GIndex == 0xFF) {
+		for (i=0; i<2; i++)
+			if (p->Data.Next[i] != NO_LINK)
+				next[n++] = p->Data.Next[i];
+	}
+	return(n);
+}
+
+static void
+CheckText(uint8 menu) {
+  size_t len = strnlen((const char *)MenuData[menu].Menubuf, LCD_MENU_SIZE+1);
+	if (len != LCD_MENU_SIZE)
+		Error(menu, "text is %u characters, not %u", (unsigned)len, LCD_MENU_SIZE);
+}
+
+static void
+CheckLinks(uint8 menu) {
+  const TMENU_DATA * p = &MenuData[menu];
+  uint8 next[4];
+  int n, i;
+	if (p->GIndex == 0 && p->Format != MENU_TYPE)
+		Error(menu, "has GIndex 0 (a menu) but Format %s", FormatName(p->Format));
+	n = Links(menu, next);
+	for (i=0; i<n; i++)
+		if (next[i] >= MENU_ITEMS)
+			Error(menu, "link %d goes to 0x%02X past the end of MenuData[]", i, next[i]);
+
+	/*
+		The up/down arrows walk the scroll list through Next[1] and Next[0].  A flag
+		that stands on its own has both pointing back at the menu that led to it.
+	*/
+	if ((uint8)p->GIndex == 0xFF && !(p->Data.Next[0] == p->Data.Next[1] && p->Data.Next[0] < MENU_ITEMS
+			&& (uint8)MenuData[p->Data.Next[0]].GIndex != 0xFF)) {
+		if (p->Data.Next[0] < MENU_ITEMS && MenuData[p->Data.Next[0]].Data.Next[1] != menu)
+			Error(menu, "scrolls down to 0x%02X which doesn't scroll back up to it", p->Data.Next[0]);
+		if (p->Data.Next[1] < MENU_ITEMS && MenuData[p->Data.Next[1]].Data.Next[0] != menu)
+			Error(menu, "scrolls up to 0x%02X which doesn't scroll back down to it", p->Data.Next[1]);
+		if (p->Data.Next[0] < MENU_ITEMS && (uint8)MenuData[p->Data.Next[0]].GIndex != 0xFF)
+			Error(menu, "scrolls down to 0x%02X which isn't in a scroll list", p->Data.Next[0]);
+		if (p->Data.Next[1] < MENU_ITEMS && (uint8)MenuData[p->Data.Next[1]].GIndex != 0xFF)
+			Error(menu, "scrolls up to 0x%02X which isn't in a scroll list", p->Data.Next[1]);
+	}
+}
+
+static void
+CheckFlag(uint8 menu) {
+  const TMENU_DATA * p = &MenuData[menu];
+	if ((uint8)p->GIndex != 0xFF)
+		Error(menu, "FLAG_TYPE needs GIndex 0xFF, has 0x%02X", (uint8)p->GIndex);
+	if (p->Pos < FIRST_EEROM_FLAG || p->Pos >= EM_GLOBAL_VARS)
+		Error(menu, "flag EEROM location %u isn't below EM_GLOBAL_VARS (%u)", p->Pos, EM_GLOBAL_VARS);
+	if (p->Pos == EM_GLOBAL_COUNT)
+		Error(menu, "flag EEROM location %u is EM_GLOBAL_COUNT", p->Pos);
+	if (p->Len > 7)
+		Error(menu, "flag bit %u isn't 0..7", p->Len);
+	if (p->Dependancy >= NUMBER_OF_BOOL_STRINGS)
+		Error(menu, "flag text %u past the end of FlagText[]", p->Dependancy);
+	if (p->UnitsPos >= LCD_LINE_LENGTH)
+		Error(menu, "flag text at column %u is off the LCD", p->UnitsPos);
+}
+
+static void
+CheckValue(uint8 menu) {
+  const TMENU_DATA * p = &MenuData[menu];
+  uint8 width = p->Len & 0x0F;
+  uint8 fractions = (p->Len >> 4) & 0x0F;
+  uint8 end;
+  uint8 i;
+	if (p->GIndex < 0 || p->GIndex >= GLOBAL_VAR_SIZE) {
+		Error(menu, "GIndex %d past the end of GlobalVars[%u]", p->GIndex, GLOBAL_VAR_SIZE);
+		return;
+	}
+	switch (p->Format) {
+	  case BYTE_TYPE :
+	  case INT_TYPE :
+	  case WORD_TYPE :
+	  case LONG_TYPE :
+	  case ULONG_TYPE :
+		if (width == 0)
+			Error(menu, "%s field has no width", FormatName(p->Format));
+		if (fractions)
+			Error(menu, "%s field has %u decimals", FormatName(p->Format), fractions);
+		end = p->Pos + width;
+		break;
+
+	  case FLOAT_TYPE :
+		if (fractions + 1 >= width)
+			Error(menu, "FLOAT field %u wide has no room for %u decimals", width, fractions);
+		// GetMenu() puts the ReadValue() flag character after the number.
+		end = p->Pos + width + 1;
+		if (p->Dependancy && MenuData[p->Dependancy].Format != FLAG_TYPE)
+			Error(menu, "metric dependancy 0x%02X is a %s menu, not a FLAG",
+					p->Dependancy, FormatName(MenuData[p->Dependancy].Format));
+		if (p->Conversion == 0.0)
+			Error(menu, "conversion factor is 0");
+		break;
+
+	  case LIST_TYPE :
+		// The list text goes at Pos and the number 9 characters further on.
+		end = p->Pos + 9 + width;
+		if (fractions + 1 >= width)
+			Error(menu, "LIST value %u wide has no room for %u decimals", width, fractions);
+		if (p->Dependancy >= GLOBAL_VAR_SIZE)
+			Error(menu, "LIST result GIndex %u past the end of GlobalVars[]", p->Dependancy);
+		for (i=0; i<LISTS; i++)
+			if (Lists[i].GIndex == p->GIndex)
+				break;
+		if (i == LISTS)
+			Error(menu, "LIST selection GIndex %d isn't one of the taper lists", p->GIndex);
+		else if (p->UnitsPos != Lists[i].Count)
+			Error(menu, "LIST says %u elements, list has %u", p->UnitsPos, Lists[i].Count);
+		break;
+
+	  default :
+		Error(menu, "GIndex %d with Format %s", p->GIndex, FormatName(p->Format));
+		return;
+	}
+	if (end > LCD_LINE_LENGTH)
+		Error(menu, "value field ends at column %u, past the %u column LCD", end, LCD_LINE_LENGTH);
+}
+
+// All the menus that edit a GlobalVars[] entry have to agree on what's in it.
+static void
+CheckGlobals(void) {
+  uint8 owner[GLOBAL_VAR_SIZE];
+  uint8 i, g;
+	memset(owner, 0xFF, sizeof(owner));
+	for (i=0; i<MENU_ITEMS; i++) {
+		g = MenuData[i].GIndex;
+		if (g == 0 || g >= GLOBAL_VAR_SIZE || MenuData[i].Format == LIST_TYPE)
+			continue;
+		if (owner[g] == 0xFF)
+			owner[g] = i;
+		else if (MenuData[owner[g]].Format != MenuData[i].Format)
+			Error(i, "edits GlobalVars[%u] as %s, MenuData[0x%02X] edits it as %s", g,
+					FormatName(MenuData[i].Format), owner[g], FormatName(MenuData[owner[g]].Format));
+	}
+	for (g=0; g<GLOBAL_VAR_SIZE; g++) {
+		if (GlobalMinimums[g] > GlobalMaximums[g]) {
+			printf("error: GlobalVars[%u] minimum %g is more than maximum %g\n",
+					g, GlobalMinimums[g], GlobalMaximums[g]);
+			Errors++;
+		}
+	}
+	if (EM_GLOBAL_VARS + GLOBAL_VAR_SIZE * sizeof(PARAMETERS) > EEROM_SIZE + 1) {
+		printf("error: GlobalVars[] at EEROM %u..%u runs past EEROM_SIZE %u\n", EM_GLOBAL_VARS,
+				(unsigned)(EM_GLOBAL_VARS + GLOBAL_VAR_SIZE * sizeof(PARAMETERS) - 1), EEROM_SIZE);
+		Errors++;
+	}
+}
+
+static void
+CheckFixedMenus(void) {
+  uint8 i;
+	for (i=0; i<FIXED_MENUS; i++) {
+		if (FixedMenus[i].Menu >= MENU_ITEMS)
+			printf("error: %s menu 0x%02X is past the end of MenuData[]\n",
+					FixedMenus[i].From, FixedMenus[i].Menu), Errors++;
+		else if (MenuData[FixedMenus[i].Menu].Format != FixedMenus[i].Format)
+			Error(FixedMenus[i].Menu, "used as the %s %s menu is a %s menu", FixedMenus[i].From,
+					FormatName(FixedMenus[i].Format), FormatName(MenuData[FixedMenus[i].Menu].Format));
+	}
+}
+
+static void
+Reach(uint8 menu) {
+  uint8 next[4];
+  int n, i;
+	if (menu >= MENU_ITEMS || Reached[menu])
+		return;
+	Reached[menu] = 1;
+	n = Links(menu, next);
+	for (i=0; i<n; i++)
+		Reach(next[i]);
+}
+
+static void
+CheckReach(void) {
+  uint8 i;
+	for (i=0; i<FIXED_MENUS; i++)
+		Reach(FixedMenus[i].Menu);
+	for (i=0; i<MENU_ITEMS; i++)
+		if (!Reached[i])
+			Warning(i, "\"%s\" can't be reached", Title(i));
+}
+
+/*
+	The navigation index.  Each menu is listed once, under the first menu that
+	leads to it; later links to it are shown as "see 0xNN".
+*/
+static void
+ListMenu(uint8 menu, int depth, const char * key) {
+  const TMENU_DATA * p = &MenuData[menu];
+  uint8 next[4];
+  int n, i;
+	printf("%*s%-5s 0x%02X %-5s %s", depth * 4, "", key, menu, FormatName(p->Format), Title(menu));
+	if (p->GIndex > 0 && p->GIndex < GLOBAL_VAR_SIZE)
+		printf("  [GlobalVars %d]", p->GIndex);
+	else if (p->Format == FLAG_TYPE)
+		printf("  [EEROM %u bit %u]", p->Pos, p->Len);
+	if (Listed[menu]) {
+		printf("  see above\n");
+		return;
+	}
+	putc('\n', stdout);
+	Listed[menu] = 1;
+	n = Links(menu, next);
+	for (i=0; i<n; i++) {
+		char k[8];
+		int d = depth + 1;
+		if (next[i] >= MENU_ITEMS)
+			continue;
+		if (p->GIndex == 0) {
+			// Blank soft keys just go back to the setup menu.
+			if (next[i] == RUN_SETUP_MENU_INDEX && menu != SIGNON_MENU_INDEX)
+				continue;
+			sprintf(k, "F%d", i+1);
+		}
+		else {
+			// A scroll list is shown flat under its heading, top to bottom.
+			if (i == 1)
+				break;
+			if (p->Format != MENU_TYPE)
+				d = depth;
+			sprintf(k, "down");
+		}
+		if (!Listed[next[i]])
+			ListMenu(next[i], d, k);
+		else
+			printf("%*s%-5s see 0x%02X\n", d * 4, "", k, next[i]);
+	}
+}
+
+static void
+ListEEROM(void) {
+  uint8 loc, bit, i;
+	printf("\nEEROM layout\n");
+	for (loc=FIRST_EEROM_FLAG; loc<EM_GLOBAL_VARS; loc++)
+		for (bit=0; bit<8; bit++)
+			for (i=0; i<MENU_ITEMS; i++)
+				if (MenuData[i].Format == FLAG_TYPE && MenuData[i].Pos == loc && MenuData[i].Len == bit)
+					printf("  %3u.%u      0x%02X %s\n", loc, bit, i, Title(i));
+	printf("  %3u        EM_GLOBAL_COUNT %u\n", EM_GLOBAL_COUNT, GLOBAL_VAR_SIZE);
+	for (loc=0; loc<GLOBAL_VAR_SIZE; loc++) {
+		for (i=0; i<MENU_ITEMS; i++)
+			if (MenuData[i].GIndex == loc && MenuData[i].Format != MENU_TYPE && MenuData[i].Format != LIST_TYPE)
+				break;
+		printf("  %3u..%-3u  GlobalVars[%u]", (unsigned)(EM_GLOBAL_VARS + loc * sizeof(PARAMETERS)),
+				(unsigned)(EM_GLOBAL_VARS + loc * sizeof(PARAMETERS) + sizeof(PARAMETERS) - 1), loc);
+		if (i < MENU_ITEMS)
+			printf(" %s 0x%02X %s", FormatName(MenuData[i].Format), i, Title(i));
+		printf("  min %g max %g\n", GlobalMinimums[loc], GlobalMaximums[loc]);
+	}
+}
+
+int
+main(int argc, char * argv[]) {
+  uint8 i;
+	for (i=0; i<MENU_ITEMS; i++) {
+		CheckText(i);
+		CheckLinks(i);
+		if (MenuData[i].Format == FLAG_TYPE)
+			CheckFlag(i);
+		else if (MenuData[i].GIndex != 0 && (uint8)MenuData[i].GIndex != 0xFF)
+			CheckValue(i);
+	}
+	CheckGlobals();
+	CheckFixedMenus();
+	CheckReach();
+
+	if (argc > 1 && strcmp(argv[1], "-i") == 0) {
+		printf("\nNavigation index\n");
+		ListMenu(SIGNON_MENU_INDEX, 0, "");
+		for (i=0; i<MENU_ITEMS; i++)
+			if (!Listed[i] && Reached[i])
+				ListMenu(i, 0, "");
+		ListEEROM();
+	}
+	printf("MenuData[%u]: %d errors, %d warnings\n", MENU_ITEMS, Errors, Warnings);
+	return(Errors ? 1 : 0);
+}
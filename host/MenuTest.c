@@ -0,0 +1,176 @@
+/*
+    MenuTest.c -- Host checks of the menu and run time value formatting in lib/Menu.c.
+
+    Copyright (C) 2005  John Dammeyer
+
+    This file is part of The Electronic Lead Screw (ELS) Project.
+
+    ELS is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+	Or download here.
+	http://www.gnu.org/copyleft/gpl.html
+
+    John Dammeyer
+    johnd@autoartisans.com
+
+
+   	Initial Version: 0.00a
+
+		lib/Menu.c is linked against a stub floatToAscii() that counts its calls so the
+		MenuCache[] in MenuFloatToAscii() can be checked for:
+
+			- a hit on the same menu and value without calling floatToAscii(),
+			- a miss when the value or the menu changes,
+			- the least recently used entry being the one replaced,
+			- results too long for MENU_CACHE_TEXT (exponents) being left uncached.
+
+		SFixedToDec() is checked against the strings the run time display expects for
+		positive and negative values, values under one and values wider than the field.
+
+		Failures make it exit with 1 so "make menutest" fails the build.
+
+   	Version changes:
+
+*/
+
+#include "Processor.h"
+
+#include "Common.h"
+#include "Config.h"
+#include "Menu.h"
+#include "Floatio.h"
+#include "Serial.h"
+#include "LCD.h"
+
+int8 OutputBuffer[SERIAL_OUTBUFFER_SIZE];
+
+static int Formats;					// floatToAscii() calls.
+static int Failures;
+
+// Int.c in libels_host.a is built with basic block tracing for IntBench.
+void
+__sanitizer_cov_trace_pc(void) {
+}
+
+// Serial.h's putchar() is ELS_putchar() on the host.
+void
+putchar(int8 ch) {
+}
+
+void
+LCDSendBuf(puint8 pstr) {
+}
+
+// Big numbers come out with an exponent the way the real one gives them.
+void
+floatToAscii(float32 fNumber, char * s, int8 digits, int8 fractions) {
+	Formats++;
+	if (fabs(fNumber) >= 1e7)
+		sprintf(s, "%+.9E", fNumber);
+	else
+		sprintf(s, "%*.*f", digits, fractions, fNumber);
+}
+
+/*
+ *  FUNCTION: Format
+ *
+ *  PARAMETERS:		menu, value	-- As for MenuFloatToAscii().
+ *					formats		-- floatToAscii() calls there should have been.
+ *					name		-- What's being checked.
+ *
+ *  DESCRIPTION:	Puts the value through MenuFloatToAscii() and checks it's the string
+ *					floatToAscii() gives and whether the cache was used.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+static void
+Format(uint8 menu, float32 value, int formats, const char * name) {
+  char s[32], expect[32];
+  int before;
+
+	before = Formats;
+	floatToAscii(value, expect, 7, 4);
+	Formats = before;
+	MenuFloatToAscii(menu, value, (int8 *)s, 7, 4);
+	if ((Formats != formats) || (strcmp(s, expect) != 0)) {
+		printf("FAIL: %s: menu %u, %g gave \"%s\" after %d floatToAscii() calls, expected \"%s\" after %d\n",
+				name, menu, value, s, Formats, expect, formats);
+		Failures++;
+	}
+}
+
+/*
+ *  FUNCTION: Fixed
+ *
+ *  PARAMETERS:		value, len, fractions	-- As for SFixedToDec().
+ *					expect					-- The string it should give.
+ *
+ *  DESCRIPTION:	Checks SFixedToDec() gives expect and doesn't write past its null.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+static void
+Fixed(int32 value, uint8 len, uint8 fractions, const char * expect) {
+  char s[32];
+
+	memset(s, '#', sizeof(s));
+	SFixedToDec((int8 *)s, value, len, fractions);
+	if ((strcmp(s, expect) != 0) || (s[strlen(expect) + 1] != '#')) {
+		printf("FAIL: SFixedToDec(%ld, %u, %u) gave \"%s\", expected \"%s\"\n", (long)value, len, fractions,
+				s, expect);
+		Failures++;
+	}
+}
+
+int
+main(void) {
+	Format(5, 1.5, 1, "first look up");
+	Format(5, 1.5, 1, "same menu and value");
+	Format(5, 1.25, 2, "value changed");
+	Format(6, 1.25, 3, "same value on another menu");
+	Format(5, 1.25, 3, "still cached");
+
+	// Four entries hold menus 5, 6, 7 and 8 with 5 used last.  9 replaces 6.
+	Format(7, 2.0, 4, "third entry");
+	Format(8, 3.0, 5, "fourth entry");
+	Format(5, 1.25, 5, "touch the oldest");
+	Format(9, 4.0, 6, "fifth value");
+	Format(5, 1.25, 6, "touched entry kept");
+	Format(7, 2.0, 6, "third entry kept");
+	Format(8, 3.0, 6, "fourth entry kept");
+	Format(6, 1.25, 7, "least recently used replaced");
+
+	Format(10, 1.0e10, 8, "exponent");
+	Format(10, 1.0e10, 9, "exponent not cached");
+
+	Fixed(1234, 7, 3, "  1.234");
+	Fixed(-1234, 7, 3, " -1.234");
+	Fixed(0, 7, 3, "  0.000");
+	Fixed(-50, 7, 3, " -0.050");
+	Fixed(5, 6, 2, "  0.05");
+	Fixed(-5, 6, 2, " -0.05");
+	Fixed(254, 6, 2, "  2.54");
+	Fixed(200, 5, 1, " 20.0");
+	Fixed(40, 4, 0, "  40");
+	Fixed(-12345678, 7, 3, "-12345.678");		// Wider than len takes the width it needs.
+	Fixed(123456789, 7, 2, " 1234567.89");
+	Fixed(2147483647, 7, 0, " 2147483647");
+	Fixed(-2147483647, 7, 3, "-2147483.647");
+
+	printf("MenuFloatToAscii, SFixedToDec: %d failures\n", Failures);
+	return(Failures ? 1 : 0);
+}
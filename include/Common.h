@@ -35,6 +35,7 @@
 // Common.h -- Common definitions and constants used in all files.
 #define 	MEM_MODEL	far
 
+#ifndef HOST_BUILD
 #define     BYTE unsigned char
 #define 	WORD unsigned int
 #define 	ULONG unsigned long
@@ -58,6 +59,33 @@
 #define 	puint8	unsigned char *
 #define		puint16	unsigned int *
 #define		puint32	unsigned long *
+#else
+// C18 int is 16 bits and long is 32 bits.  Keep the same widths when the
+// interrupt and motor code is compiled natively on a 64 bit Linux host.
+#define     BYTE unsigned char
+#define 	WORD unsigned short
+#define 	ULONG unsigned int
+#define 	PBYTE BYTE *
+#define 	PWORD WORD *
+
+#define		int8	char
+#define 	int16	short
+#define		int32	int
+#define		float32	float
+
+#define 	uint8	unsigned char
+#define		uint16	unsigned short
+#define		uint32	unsigned int
+
+#define		pint8	char *
+#define 	pint16	short *
+#define		pint32	int *
+#define		pfloat32 float *
+
+#define 	puint8	unsigned char *
+#define		puint16	unsigned short *
+#define		puint32	unsigned int *
+#endif
 
 #define 	TRUE	-1
 #define 	FALSE	0
@@ -80,7 +108,7 @@ typedef union tag_bits
 
 typedef union  {
 	float f;
-	long l;
+	int32 l;
 	WORD w;
 	BYTE b;
 } PARAMETERS;	
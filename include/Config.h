@@ -258,6 +258,97 @@
 			--	During tracking in interrupt code change to >= so SpinAddr doesn't slowly accumulate
 			--  Use Average values for clocks per rev rather than the last accumulated one so that 
 				base threading RPM starts from average rather than an outlying point.
+	1.10j
+			--  Step pulses are timed by the CCP1 (Z) and ECCP1 (X) compares on a free running Timer1
+				instead of being polled every 50uS.  Timer2 is the pulse clock.  MAX_STEP_RATE raised to 30000.
+	1.10k
+			--  Acceleration ramps walk a table of step periods built by MotorMoveDistance() and MotorJog()
+				from the acceleration.  No velocity math or divide left in the pulse clock interrupt.
+	1.10l
+			--  JERK_RATE_Z_NDX and JERK_RATE_X_NDX select an S-curve ramp when not 0.  The deceleration
+				point of an S-curve move is calculated up front and short moves peak at a lower speed.
+	1.10m
+			--  Electronic gearbox.  When ENCODER_LINES_NDX is more than 1 the spindle input is an encoder
+				and threading takes one Z step per GearDenominator of accumulated GearNumerator per line.
+				Z ramps up from the index and catches up with the lines before they step it.
+	1.10n
+			--  SPINDLE_PULSE_REV_NDX slots per rev.  Revolution time, RPM and spindle tracking are updated
+				on every slot.  Threading starts on the slot after the one missing from the disk.  A disk
+				without a gap gives MSG_SPINDLE_INDEX_ERROR when threading.
+	1.10o
+			--  SPINDLE_CAPTURE (MotorDriver.h) times spindle edges from Timer1 in the INT0 interrupt.
+				Spindle periods are 32 bit SPINDLE_CLOCK_RATE (625kHz) clocks and the threading step period
+				comes straight from the averaged spindle period.
+	1.10p
+			--  Spindle speed is an alpha-beta estimate of the period and its rate of change instead of
+				the 16 bucket average.  SPINDLE_PREDICT_START threads at the period predicted for the
+				index the move starts on.  The estimate steps over every spindle update the interrupt
+				counted in SpindleUpdates, even if the main loop missed some.
+	1.10q
+			--  THREAD_PHASE_START.  A threading pass slews Z on along the thread to where the helix will
+				be shortly and starts at that spindle phase instead of waiting for the index.
+	1.10r
+			--  CLEARANCE_X_NDX.  Once an automatic X retract is that far off the cut Z heads back to the
+				start, and X comes back in to that far off the next cut while Z is still returning.
+	1.10s
+			--  MOTION_QUEUE.  MotorQueueMove() queues segments for each axis and plans where each one
+				meets the next so the interrupt routine runs them back to back without stopping in between.
+	1.10t
+			--  Tapers steeper than one X step per Z step.  TaperTangent is a 32 bit fraction and X is the
+				master with Z following it when fTaperSteep is set.  The X move is sized from the
+				taper's Z length so a pure face (TaperTangent 0) isn't a taper and is refused.
+	1.10u
+			--  CIRCULAR_INTERPOLATION.  The pulse clock steps X and Z round a quarter circle,
+				choosing X, Z or both by the smallest circle error.  MotorArcMove() sets it up and the
+				feed along the arc follows TURN_PITCH_NDX per revolution.  BALL_RADIUS_NDX on the
+				X RUN PARAMETERS menu turns each turning pass into a ball cut in the threading passes.
+	1.10v
+			--  RATIONAL_GEARING.  Thread pitch, leadscrew pitch and motor steps are recovered as
+				fractions so steps per spindle rev are exact, e.g. 120000/127 for 1.5mm on 10 TPI.
+				Encoder gearing uses the exact fraction per line.  A timed thread counts its Z steps
+				against the revolutions and trims the step period so the pitch doesn't drift.
+	1.10w
+			--  Multi-start threads.  THREAD_STARTS_NDX (STRT on the THREADING menu) sets the number
+				of starts and THREAD_SIZE_NDX is the lead.  Each depth is cut on every start, each
+				starting a further lead/starts back from the work on the same index.
+	1.10x
+			--  Constant area infeed.  With CONSTANT AREA INFEED ON each thread pass removes the
+				chip area of the first pass.  Pass depths are tabled when the cycle starts.  A thread
+				needing more than 24 passes gives MSG_AREA_PASSES_ERROR.
+	1.10y
+			--  THREAD_RUN_UP.  With AUTO THREAD RUN-UP ON, THREAD BEGIN is where the thread starts.  Each
+				pass starts back by ThreadRunUpSteps(), the ramp distance at the present RPM less whole
+				leads, so Z is up to speed there and on the same helix at any RPM.
+	1.10z
+			--  FEED_HOLD.  STOP held during an automatic threading pass that's up to speed holds it.  Z stops,
+				X comes out and the display shows Feed Hold.  START backs Z up by MotorResumeAt() and starts it at
+				the spindle phase that puts it back on the helix, then X goes back in.  A STOP tap gives up.
+	1.11
+			--  THREAD_PULL_OUT.  X RUN PARAMETERS, POS, PULL sets PULL-OUT LEADS and ANGL.  Over that many
+				leads from the end of a threading pass X comes out at that angle to the thread axis, stepped off
+				Z in the interrupt like a taper while Z still follows the spindle.  0 leads stops Z first as before.
+	1.11a
+			--  Spindle tracking follows a spindle slowing to a fifth of its speed, where it used to stop
+				at a third, and speeding up till Z would pass MAX_STEP_RATE.  The correction is slew limited to
+				Z's acceleration.  Each threading pass reports its tracking statistics on the serial port, as
+				does the 't' command.
+	1.11b
+			--  LCD shadow buffer.  LCDSendBuf() and friends only send characters that changed
+				and only set the address where a changed run starts.  Run time display now every 100mS.
+	1.11c
+			--  LCD queue.  What the LCD routines send is queued and CheckLCDDevice() in the main
+				loop sends one byte a pass when the LCD isn't busy.  LCDFlush() before the EEROM monitor.
+	1.11d
+			--  Fixed point DRO.  SetupDisplayScale() with UpdateDistances() turns the distance divisors
+				into display digits per step, and the pitch into DisplayPitch digits and DisplayTPI.  The
+				run time display converts Z and X with StepsToDisplay() and shows all of them with
+				SFixedToDec().  No floating point for them.
+	1.11e
+			--  Menu value cache.  GetMenu() keeps the last MENU_CACHE_SIZE floatToAscii() results keyed
+				by menu number and value so going back to a menu doesn't format it again.
+	1.11f
+			--  Added host/MenuCheck.c ("make menucheck") to check the MenuData[] links, GIndex,
+				field widths, flags and EEROM layout.  Fixed the three bad records it found.
 
 */
 // Config.h -- Project specific definitions like Crystal frequencies, Port allocations.
@@ -269,13 +360,13 @@
 // Deal with processors differences between board revisions.
 #if defined(__18F4620)
 	// Through Hole Processor for boards above Rev 0.30	
-#define pstrSignOn  "     E-LEADSCREW    Ver PIC18F4620 1.10i"
+#define pstrSignOn  "     E-LEADSCREW    Ver PIC18F4620 1.11f"
 #elif defined(__18F4680)
 	//	QFP processor for boards Rev 0.20 or lower and Rev. 0.30 Through Hole processors
-#define pstrSignOn  "     E-LEADSCREW    Ver PIC18F4680 1.10i"
+#define pstrSignOn  "     E-LEADSCREW    Ver PIC18F4680 1.11f"
 #elif defined(__18F4685)
 	//	QFP processor for boards Rev 0.20 or lower and Rev. 0.30 Through Hole processors
-#define pstrSignOn  "     E-LEADSCREW    Ver PIC18F4685 1.10i"
+#define pstrSignOn  "     E-LEADSCREW    Ver PIC18F4685 1.11f"
 #endif
 
 // #define FULL_DIAGNOSTICS			1		// Makes DEBUGSTR into printf so diagnostics show up on serial port.
@@ -384,6 +475,7 @@
 
 #define EM_MOTOR_OFF_DELAY  8	// Number of heartbeats to wait before shutting down motor.
 #define EM_MOTOR_HOLD_VALUE 9	// value between 0 and 15 to send out as hold current. Normally 0 or 1
+#define EM_GLOBAL_COUNT		10	// How many GlobalVars[] the EEROM holds.  Erased if saved before it was kept.
 
 #define EM_GLOBAL_VARS		48	// Where in EEROM the global array starts.
 //---------------------------------------------------------------------------------------------------------//
@@ -394,10 +486,10 @@ extern float XDistanceDivisor, ZDistanceDivisor;
 extern char ZEncoderCounter, OldZEncoderCounter;
 
 extern float TrackingRatio;			// LeadscrewRatio * PULSE_POINT.
-extern long iTrackingRatio;			// Integer version
+extern int32 iTrackingRatio;			// Integer version
 
-extern long CurrentZPosition;	// Position of carriage
-extern long CurrentXPosition;	// Position of cross Slide.
+extern int32 CurrentZPosition;	// Position of carriage
+extern int32 CurrentXPosition;	// Position of cross Slide.
 
 extern char DisplayModeMenuIndex;
 
@@ -492,7 +584,7 @@ extern char SystemError;	// If a system wide error occurs, this variable holds t
 extern BYTE HB_OnTime, HB_OffTime;		// Timer values for context sensitive Heartbeat.
 
 // Serial and I/O conversion variables.
-extern int DecArg;		// Holds value to manipulate or output.
+extern int16 DecArg;		// Holds value to manipulate or output.
 
 // Definitions of what is displayed on the LCD.
 enum DISPLAY_MODES {
@@ -519,7 +611,10 @@ enum DISPLAY_MODES {
 	MSG_MOTOR_DISTANCE_ERROR,
 	MSG_TAPER_TOO_BIG_ERROR,
 	MSG_CHANGE_JOG_DISTANCE_MODE,
-	MSG_START_EQUALS_END_ERROR 
+	MSG_START_EQUALS_END_ERROR,
+	MSG_FEED_HOLD_MODE,
+	MSG_SPINDLE_INDEX_ERROR,
+	MSG_AREA_PASSES_ERROR
 };
 
 /*
@@ -542,6 +637,15 @@ extern enum SYSTEM_STATES SystemState;
 	compiled with this off as it just adds space and lots of extra processing time that impacts keypad
 	reaction time.
 */
+#ifdef HOST_BUILD
+// gcc insists on the argument count matching so the host build uses variadic macros.
+#ifdef FULL_DIAGNOSTICS
+#define DEBUGSTR(...) printf(__VA_ARGS__)
+#else
+#define DEBUGSTR(...)
+#endif
+#define DEBUG_MENU(...)
+#else
 #ifdef FULL_DIAGNOSTICS
 #define DEBUGSTR(s) printf((MEM_MODEL  rom char *)s)
 #else
@@ -553,6 +657,7 @@ extern enum SYSTEM_STATES SystemState;
 #else
 #define DEBUG_MENU(s) 
 #endif
+#endif
 
 
 // Functions in ELeadscrew.c needed in other files.
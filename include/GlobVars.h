@@ -40,7 +40,8 @@
 #define __GLOBVARS	1
 
 // External Global Variable External Declarations:
-#define GLOBAL_VAR_SIZE		41
+#define GLOBAL_VAR_SIZE		48
+#define GLOBAL_VAR_SIZE_OLD	41		// What an EEROM without EM_GLOBAL_COUNT holds.
 
 #define METRIC_PITCH_NDX			0			//	0 == Imperial, 1 == Metric
 #define LEADSCREW_IPITCH_NDX		1			//	FLOAT_TYPE PITCH in INCHES
@@ -83,6 +84,13 @@
 #define CUSTOM_TAPER4_NDX			38			//	FLOAT_TYPE Taper in inches per inch.
 #define X_DIAMETER_NDX				39			//  FLOAT_TYPE location of tool bit tip expressed as diameter
 #define DEPTH_MULTIPLIER_NDX		40			//  FLOAT_TYPE location of tool bit tip expressed as diameter
+#define JERK_RATE_Z_NDX				41			//	LONG_TYPE Change in acceleration per second.  0 for a linear ramp.
+#define JERK_RATE_X_NDX				42			//	LONG_TYPE Change in acceleration per second.  0 for a linear ramp.
+#define CLEARANCE_X_NDX				43			//	FLOAT_TYPE X distance off the cut before Z may move.  0 waits for X.
+#define BALL_RADIUS_NDX				44			//	FLOAT_TYPE Radius of a ball turned in passes.  0 turns straight.
+#define THREAD_STARTS_NDX			45			//	uint8_TYPE Number of starts.  THREAD_SIZE_NDX is the lead.
+#define PULL_OUT_LEADS_NDX			46			//	FLOAT_TYPE Leads from the end X pulls out over.  0 stops Z first.
+#define PULL_OUT_ANGLE_NDX			47			//	FLOAT_TYPE Degrees off the thread axis X pulls out at.
  
 extern PARAMETERS GlobalVars[GLOBAL_VAR_SIZE];
 extern rom float GlobalMinimums[GLOBAL_VAR_SIZE];
@@ -95,8 +103,8 @@ float32 GetGlobalVarFloat(int16 ndx);
 int32 GetGlobalVarLong(int16 ndx);
 uint16 GetGlobalVarWord(int16 ndx);
 uint8 GetGlobalVarByte(int16 ndx);
-void SetGlobalVarFloat(int16 ndx, float var);
-void SetGlobalVarLong(int16 ndx, long var);
+void SetGlobalVarFloat(int16 ndx, float32 var);
+void SetGlobalVarLong(int16 ndx, int32 var);
 void SaveGlobalVar(int16 ndx);
 void LoadGlobalVar(int16 ndx);
 void SaveFlagVar(PTMENU_DATA pMenu);
@@ -38,6 +38,115 @@
 #define TAPERING				1
 #define	TRACK_SPINDLE_SPEED		1
 
+/*
+	Step timing.  Timer1 free runs at Fosc/4 and the CCP1 (Z) and ECCP1 (X) compares interrupt
+	at the time of the next step.  Step periods are Timer1 counts with STEP_FRACTION_BITS of
+	fraction so rounding doesn't add up over a long move.
+*/
+#define STEP_TIMER_RATE			10000000L	// Timer1 counts per second.
+#define STEP_FRACTION_BITS		8
+#define STEP_PERIOD(speed)		((((uint32)STEP_TIMER_RATE) << STEP_FRACTION_BITS) / (uint16)(speed))
+#define STEP_WAIT_MAX			(10000L << STEP_FRACTION_BITS)	// 1mS.  Longest wait for one compare.
+#define STEP_LEAD_MIN			50			// Timer1 counts.  A compare closer than this might be missed.
+
+/*
+	Acceleration ramps.  MotorDriver cuts the ramp from a stop to MAX_STEP_RATE, or to the
+	move's speed for an S-curve, into RAMP_TABLE_SIZE levels of RampTicks pulse clocks each and
+	keeps the step period of every level in a table so the interrupt routine only has to count
+	and look up.
+*/
+#define RAMP_TABLE_SIZE			64
+
+/*
+	Motion queue.  MotorQueueMove() plans segments into a ring of SEGMENT_QUEUE_SIZE for each axis
+	and the interrupt routine loads the next one on the last step of the one before.  A segment
+	that carries on the same way is given an End level so the axis only slows down to the speed
+	the next one starts at instead of stopping.  The queue runs on the linear ramp table.
+*/
+#define MOTION_QUEUE			1
+#ifdef MOTION_QUEUE
+#define SEGMENT_QUEUE_SIZE		4			// Power of 2.
+#define SEGMENT_QUEUE_MASK		(SEGMENT_QUEUE_SIZE - 1)
+
+#define SEGMENT_FREE			0			// Runs as soon as the segment before it is done.
+#define SEGMENT_INDEX			1			// Waits for the spindle index and tracks the spindle.
+
+typedef struct {
+	int32 Steps;				// Steps in the segment including any X backlash.
+	int32 DownSteps;			// Steps from the end to start slowing down to End.
+	int32 Backlash;				// X backlash steps at the start.  Z takes up its own.
+	uint32 TopPeriod;			// Exact step period at Top.
+	uint8 Top;					// Ramp level to run at.
+	uint8 End;					// Ramp level to leave at.  0 stops.
+	uint8 Dir;					// fZDirectionCmd or fXDirection.
+	uint8 Sync;					// SEGMENT_FREE or SEGMENT_INDEX.
+} MOTION_SEGMENT;
+#endif
+
+/*
+	Circular interpolation.  MotorArcMove() sets up an arc of up to a quarter circle and the
+	pulse clock steps it.  Each time ArcFeed has added up to the length of the next step it
+	steps X, Z or both, whichever leaves ArcError, the weighted x^2 + z^2 - r^2, nearest 0.
+	The weights make it a circle in inches when the axes have different steps per inch and
+	are scaled so no error term is bigger than ARC_TERM_MAX and a sum of three fits in 32 bits.
+*/
+#define CIRCULAR_INTERPOLATION	1
+#ifdef CIRCULAR_INTERPOLATION
+#define ARC_X					1			// ArcNext steps X
+#define ARC_Z					2			// and or Z.
+#define ARC_TERM_MAX			0x20000000L
+#endif
+
+/*
+	Electronic gearbox.  When ENCODER_LINES_NDX is more than 1 the spindle input on INT0 is an
+	encoder and every line adds GearNumerator to a Bresenham accumulator.  Each time it passes
+	GearDenominator the Z axis takes one step so the lead screw is locked to the spindle.
+	Steps per spindle rev are kept to 1/GEAR_SCALE of a step.
+	A geared pass can't start at the spindle's speed so it ramps up on the step timer as a timed
+	thread does while the lines it should have stepped are counted as owed.  It catches up at
+	1/GEAR_CATCH_UP over the geared speed, comes back down when the owed steps are what the ramp
+	down will make up, then creeps 1/(1 << GEAR_CREEP_SHIFT) fast until none are owed and the
+	encoder takes over.  Every pass is still in the same place on the thread.
+*/
+#define GEAR_SCALE				4096L
+#define GEAR_CATCH_UP			4
+#define GEAR_CREEP_SHIFT		6
+
+/*
+	RATIONAL_GEARING.  Thread pitch, leadscrew pitch and motor steps are turned back into the
+	fractions they were entered as so the steps per spindle rev are an exact GearNumerator over
+	GearDenominator.  Gearing off an encoder uses them per line.  A timed thread owes GearNumerator
+	each revolution, pays GearDenominator with each Z step and makes up half of PitchError over the
+	next revolution so the pitch is exact however long the thread.  GEAR_SCALE is the fallback
+	when a fraction doesn't fit in 31 bits.
+*/
+#define RATIONAL_GEARING		1
+#define RATIONAL_DEN_MAX		10000L		// Largest denominator looked for in a pitch.
+#define RATIONAL_MAX			0x7FFFFFFFL	// GearNumerator and GearDenominator stay below this.
+
+/*
+	THREAD_PULL_OUT.  Armed with ZPullOutSteps to go in a threading pass, X is stepped off the Z
+	steps like a taper, PullOutTangent being a 32 bit fraction of an X step per Z step, so the tool
+	comes out of the thread along a chamfer while Z is still on the helix.  Pulling out usually
+	reverses X after the infeed so PullOutBacklash steps are taken first, one per Z step, and
+	the pull out is armed that many Z steps earlier to make up for them.
+*/
+#ifdef TAPERING
+#define THREAD_PULL_OUT			1
+#endif
+
+// Fraction bits in ZPeriodPerClock, the change in step period per spindle clock of spindle tracking.
+#define TRACK_FRACTION_BITS		8
+
+/*
+	A slot sensor can have up to SPINDLE_SLOTS_MAX slots per revolution.  The revolution is timed
+	over the last SpindleSlots slots on every slot.  One slot position has to be left out and the
+	slot after the gap is the index.  A disk that's shown no gap for SPINDLE_INDEX_MISSES
+	revolutions can't start a thread.
+*/
+#define SPINDLE_SLOTS_MAX		16
+#define SPINDLE_INDEX_MISSES	2
+
 // Set Interrupt rate for 10ms.
 #define		RTC_DIVISOR	(65535-TXTAL_CPU)+1
 
@@ -72,7 +181,6 @@ extern rom uint8 MicroStepBTableBkwd[MSTEPTABLESIZE];
 
 
 extern volatile int32 MaxZVel;
-extern volatile int32 ZVel;  //current velocity * 2048
 extern volatile int32 ZAcc; //acceleration * 2048
 extern volatile int32 StepsToZVel; 
 extern volatile int32 NewZVel;
@@ -80,16 +188,59 @@ extern volatile int32 ZMotorPosition; // absolute Motor Position as a signed # o
 extern volatile int32 SystemZBackLashCount;		// Filled from EEROM takes into account half nut backlash.
 extern volatile int32 ZStepCount;					// Number of steps to turn Leadscrew.
 extern volatile int32 ZHalfwayPoint;					// Number of steps to turn Leadscrew.
+extern volatile int32 ZDecelSteps;		// Steps an S-curve needs to stop.  0 for a linear ramp.
+extern volatile uint32 ZStepPeriod;		// Time between Z steps.  0 when stopped.
+extern uint32 ZCruisePeriod;			// Step period at the threading speed.
+extern uint32 ZPeriodPerClock;			// ZCruisePeriod / SpinRate for spindle tracking.
+extern uint32 ZStartPhase;				// Spindle clocks after the index a threading pass starts.
+extern uint8 ZPhaseArmed;				// Cleared with each request for a ZStartPhase start.
+extern uint16 ZRampTable[RAMP_TABLE_SIZE];	// Step period in Timer1 counts of each ramp level.
+extern uint16 ZRampTicks;				// Pulse clocks spent at each level.
+extern volatile uint8 ZRampTop;			// Level to ramp to.
+extern volatile uint32 ZTopPeriod;		// Exact step period at ZRampTop.
+#ifdef MOTION_QUEUE
+extern MOTION_SEGMENT ZQueue[SEGMENT_QUEUE_SIZE];	// Z segments waiting to run.
+extern volatile uint8 ZQueueHead;		// Next free entry.
+extern volatile uint8 ZQueueTail;		// Next segment to run.  The queue is empty when it's ZQueueHead.
+extern volatile uint8 ZRampEnd;			// Level the running segment slows down to.  0 to stop.
+#endif
+
 
+extern uint8 SpindleSlots;				// Slots per spindle rev for a slot sensor.
+extern BITS SpindleFlags;
+#define fSpindleIndexed					SpindleFlags.Bit.Bit0	// SlotCount is on the index.
+extern uint8 IndexMisses;				// Index slots in a row that didn't follow a gap.
+extern volatile uint8 SpindleUpdates;	// Slots or revolutions timed since MotorDevice() took the last one.
+extern uint16 SpindleLines;			// Encoder lines per spindle rev.  1 for a single slot sensor.
+extern uint32 GearNumerator;			// Steps per line, or per rev for a timed thread, is
+extern uint32 GearDenominator;			// GearNumerator / GearDenominator.
+extern uint8 ZGearTop;					// Ramp level a geared pass creeps at.
+extern uint32 ZGearPeriod;				// Step period it creeps at.  ZTopPeriod is 0 once geared.
+extern int32 ZGearDownSteps;			// Steps the ramp down to ZGearTop makes up.
+#ifdef RATIONAL_GEARING
+extern BITS PitchFlags;
+#define fPitchLock						PitchFlags.Bit.Bit0	// Hold this timed thread to GearNumerator/GearDenominator.
+#define fPitchLocked					PitchFlags.Bit.Bit1	// Steps are being counted against the revolutions.
+extern volatile int32 PitchError;		// Revolutions * GearNumerator - Z steps * GearDenominator.
+extern int32 PitchClip;					// Largest PitchError the correction is worked out for.
+extern uint32 ZPeriodPerPitch;			// ZCruisePeriod / (2 * GearNumerator) << TRACK_FRACTION_BITS.
+#endif
 
-extern int16 SpinRate;				// Spindle Speed at start of threading
-extern int16 NegSpinRate;			// Negative of Spindle Speed at start of threading
-extern int16 SpinClip;				// Half of SpinRate calculated outside interrupt routine for speed.
+extern int32 SpinRate;				// Spindle Speed at start of threading
+extern int32 SpinClip;				// Slowest spindle tracked, as a change in spindle clocks per rev.
+#ifdef TRACK_SPINDLE_SPEED
+extern int32 SpinFloor;				// Fastest, where Z would pass MAX_STEP_RATE.  Negative.
+extern int32 SpinSlew;				// Most the correction moves in one spindle update.
+extern uint16 TrackUpdates;			// Spindle updates during this move.
+extern uint16 TrackSlewed;			// Of those held back by SpinSlew.
+extern uint16 TrackClipped;			// Of those past SpinClip or SpinFloor.
+extern int32 TrackCorrMin, TrackCorrMax;	// Range of SpinCorrection applied up to speed.
+extern int32 TrackPitchMax;			// Largest PitchError seen at an index.
+#endif
 
 #ifdef X_AXIS
 
 extern volatile int32 MaxXVel;	// Target Velocity * 2048
-extern volatile int32 XVel;  		// Current velocity * 2048
 extern volatile int32 XAcc; 		// Acceleration
 extern volatile int32 StepsToXVel;	// Number of steps it took to get to maximum speed.
 extern volatile int32 NewXVel;	// Maximum RPM when a distance move is requested with fZMoveRQ
@@ -97,6 +248,17 @@ extern volatile int32 XMotorRelPosition; // Relative Motor Position as a signed
 extern volatile int32 XMotorAbsPosition; // Absolute Motor Position as a signed # of encoder steps.
 extern volatile int16 XMotorIncrement;		// Used to track steps for absolute rather than relative X motion.
 extern volatile int32 XBackLashCount;
+extern volatile uint32 XStepPeriod;		// Time between X steps.  0 when stopped.
+extern uint16 XRampTable[RAMP_TABLE_SIZE];
+extern uint16 XRampTicks;
+extern volatile uint8 XRampTop;
+extern volatile uint32 XTopPeriod;
+#ifdef MOTION_QUEUE
+extern MOTION_SEGMENT XQueue[SEGMENT_QUEUE_SIZE];
+extern volatile uint8 XQueueHead;
+extern volatile uint8 XQueueTail;
+extern volatile uint8 XRampEnd;
+#endif
 #endif
 
 
@@ -108,18 +270,42 @@ extern BITS ActiveFlags;
 #define fXAxisActive					ActiveFlags.Bit.Bit1
 #define fUseLimits						ActiveFlags.Bit.Bit2
 #define fThreading						ActiveFlags.Bit.Bit3
+#define fZSCurve						ActiveFlags.Bit.Bit4	// Move knows its deceleration point.
+#define fXSCurve						ActiveFlags.Bit.Bit5
+#define fGearing						ActiveFlags.Bit.Bit6	// Z steps come from the spindle encoder.
+#define fZGearStep						ActiveFlags.Bit.Bit7	// Encoder line asked for a Z step.
 
 #ifdef TAPERING
-extern union BRESENHAM {
-  int32	Bresenham;
-  struct {
-	uint16  Low;
-	uint16  High;
-  };
-} TAccumulator;
-
-extern int32 TaperTangent;
+extern uint32 TAccumulator;
+extern uint32 TaperTangent;
+#endif
+
+extern BITS ArcFlags;
+#define fArcing							ArcFlags.Bit.Bit0	// The pulse clock is stepping an arc.
+
+#ifdef THREAD_PULL_OUT
+extern BITS PullOutFlags;
+#define fPullOutArmed					PullOutFlags.Bit.Bit0	// Pull out with ZPullOutSteps to go.
+#define fPullingOut						PullOutFlags.Bit.Bit1	// X steps off Z.
+#define fPullOutDir						PullOutFlags.Bit.Bit2	// MOVE_OUT or MOVE_IN.
+extern volatile int32 ZPullOutSteps;
+extern int32 PullOutBacklash;
+extern uint32 PullOutTangent;
+#endif
+
+#ifdef CIRCULAR_INTERPOLATION
+extern volatile int32 ArcError;				// Weighted x^2 + z^2 - r^2 in steps from the centre.
+extern volatile int32 ArcXTerm, ArcZTerm;	// What a step on each axis adds to ArcError.
+extern int32 ArcXInc, ArcZInc;				// What a step adds to its own term.
+extern volatile int32 ArcXLeft, ArcZLeft;	// Steps to the end of the arc.
+extern volatile int16 ArcXLead, ArcZLead;	// Backlash steps before the arc starts.
+extern volatile uint32 ArcFeed;				// Length fed per pulse clock.
+extern uint32 ArcXCost, ArcZCost, ArcXZCost;// Length of each kind of step.
+extern uint32 ArcDistance;					// Length fed since the last step.
+extern uint32 ArcCost;						// Length of the next step.
+extern uint8 ArcNext;						// ARC_X and or ARC_Z for the next step.
 #endif
 
 void InitInterruptVariables(void);
+int32 GetSpindlePhase(void);
 
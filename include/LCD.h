@@ -57,6 +57,10 @@ enum LCDStates {
 
 #define LCD_INIT_BYTES	6
 
+// Characters and Set DD RAM Address commands waiting for CheckLCDDevice().
+#define LCD_QUEUE_SIZE	64
+#define LCD_QUEUE_MASK	LCD_QUEUE_SIZE-1
+
 
 
 // Each parameter has a value, a minimum, a maximum and 
@@ -75,3 +79,4 @@ void LCDSetPosition(uint8 x, uint8 y);
 void LCDSendBuf(puint8 pstr);
 void LCDSendStr(const rom char *pstr);
 void CheckLCDDevice(void);
+void LCDFlush(void);
@@ -144,6 +144,14 @@ typedef struct tlist_data {
 
 typedef TMENU_LIST * PTMENU_LIST;
 
+// A LIST_TYPE menu keeps the ROM address of its list in Data.LongValue.  A 64 bit host
+// address doesn't fit there so the host build (host/MenuCheck.c) leaves it zero.
+#ifndef HOST_BUILD
+#define MENU_LIST_ADDR(list)	((long)(list))
+#else
+#define MENU_LIST_ADDR(list)	0
+#endif
+
 typedef struct tbool_strings {
 	 far rom pint8  ptrOn_text;
 	 far rom pint8  ptrOff_text;
@@ -151,10 +159,28 @@ typedef struct tbool_strings {
 
 typedef TBOOL_STRINGS * PTBOOL_STRINGS;
 
+/*
+	Menu value cache.
+	floatToAscii() is the slow part of putting up a FLOAT_TYPE or LIST_TYPE menu so the
+	last few results are kept.  An entry is only used again if it's for the same menu and
+	the value, after the ReadValue() conversion, has exactly the same bits.  A change to 
+	the global variable, the metric flag or anything else a conversion uses misses.
+*/
+#define MENU_CACHE_SIZE	4
+#define MENU_CACHE_TEXT	16			// Longest floatToAscii() result kept, with the null.
+
+typedef struct tmenu_cache {
+	uint8 Menu;						// Menu number.  0 (sign on menu has no value) if empty.
+	uint8 Used;						// MenuCacheClock when last used.
+	uint32 Value;					// Bits of the float that was formatted.
+	int8 Text[MENU_CACHE_TEXT];
+} TMENU_CACHE;
+
 extern TMENU_DATA CurrentMenu;
 extern signed int8 CurrentMenuNumber, LastMenuNumber;
 
 int8 GetMenu(uint8 menu, PTMENU_DATA pMenu, PBYTE keybuf);
+void MenuFloatToAscii(uint8 menu, float32 fNumber, int8 * s, int8 digits, int8 fractions);
 
 uint8 DisplayFlagText(PTMENU_DATA pMenu, pint8  pStrDest,  const rom TBOOL_STRINGS *src);
 void DumpMenu(void);
@@ -163,4 +189,5 @@ uint32 SGetULong( pint8 s );
 int32 SGetLong(int8 *s);
 void SuLongToDec(pint8 pDecBuf, int32 decArg, uint8 len, uint8 zeros);
 void SLongToDec(pint8 pDecBuf, int32 decArg, uint8 len, uint8 zeros);
+void SFixedToDec(pint8 pDecBuf, int32 decArg, uint8 len, uint8 fractions);
 #endif
@@ -36,7 +36,7 @@
 */			 
 
 
-#define MENU_ITEMS						87  // Number of entries in Menu Array.
+#define MENU_ITEMS						97  // Number of entries in Menu Array.
 #define NUMBER_OF_MORSE_TAPERS			8
 #define NUMBER_OF_JACOB_TAPERS			9
 #define NUMBER_OF_ASSORTED_TAPERS		5
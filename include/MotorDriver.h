@@ -77,7 +77,8 @@ enum MOTOR_TYPES {
 /*
 	The PULSE_CLOCK_xxx constants are fundamental to the operation of the ELS.  Based on the processor
 	Crystal Frequency and divisors the PULSE_CLOCK_RATE determines how often the interrupt routine is 
-	called which in turn determines the fastest step rate.
+	called to accelerate the motors, time the spindle and read the MPG.  Timer2 makes the pulse clock
+	so PULSE_CLOCK_DIVISOR has to be even and no more than 512.
 	As stated in the comments below the project started at 25kHz and 43uS per clock tic and is now 
 	at 20kHz and 50uS per clock tick.  That's in order to handle the increased number of 'features' 
 	that the ELS has so that the interrupt routine doesn't take up more than about 75% of the interrupt
@@ -87,6 +88,56 @@ enum MOTOR_TYPES {
 											// Now 500 for 20kHz and 50 uS tick
 #define PULSE_CLOCK_RATE  		((uint16)(10000000L/PULSE_CLOCK_DIVISOR))
 
+/*
+	Spindle times are counted in SPINDLE_CLOCK_RATE clocks.  With SPINDLE_CAPTURE the INT0 interrupt
+	reads Timer1 at each spindle edge so a revolution is timed to 1.6uS rather than to the 50uS
+	pulse clock.  Without it the pulse clock polls the sensor.
+*/
+#define SPINDLE_CAPTURE			1
+#ifdef SPINDLE_CAPTURE
+#define SPINDLE_CLOCK_SHIFT		4			// Timer1 counts per spindle clock as a shift.
+#define SPINDLE_CLOCK_RATE		(10000000L >> SPINDLE_CLOCK_SHIFT)
+#else
+#define SPINDLE_CLOCK_RATE		((int32)PULSE_CLOCK_RATE)
+#endif
+
+/*
+	The spindle speed estimator keeps a rate of change as well as a period.  With
+	SPINDLE_PREDICT_START a thread is started at the period predicted for the next index
+	rather than the period measured so far.
+*/
+#define SPINDLE_PREDICT_START	1
+
+/*
+	With THREAD_PHASE_START the interrupt routine keeps track of how far the spindle is past the
+	index.  A threading pass moves Z on along the thread to where the helix will be shortly and
+	starts at that phase instead of waiting up to a revolution for the index.
+*/
+#define THREAD_PHASE_START		1
+#define PHASE_START_SETTLE		0.05		// Seconds allowed on top of the Z move itself.
+
+/*
+	With THREAD_RUN_UP and fRunUp set a threading pass starts from rest far enough back from the
+	start of the thread for Z to be up to speed there and on the helix a full speed start on the
+	index would have cut, whatever the RPM.
+*/
+#define THREAD_RUN_UP			1
+
+/*
+	With FEED_HOLD, STOP held during a threading pass that's up to speed holds the pass instead of
+	throwing it away.  Z stops and X retracts.  START backs Z up by its run-up and starts it again
+	at the spindle phase that puts it back on the same helix.  Needs THREAD_PHASE_START and
+	THREAD_RUN_UP.
+*/
+#define FEED_HOLD				1
+
+/*
+	Step pulses are timed by the CCP compares rather than the pulse clock so they can go faster
+	than PULSE_CLOCK_RATE.  The limit is set by the interrupt time for a micro-stepped Z step with
+	the pulse clock still running and by velocity being held as speed << 16 in an int32.
+*/
+#define MAX_STEP_RATE			30000
+
 /*
  *	EEROM BIT FLAGS
  *		Bits are define with a constant for the bit position.  It's this bit position that is used
@@ -98,16 +149,20 @@ extern BITS ZMotorFlags;
 #define	fBITPOS_MZInvertDirMotor		0 // 0x01 If set, inverts Motor direction.
 #define	fBITPOS_MZInvertedStepPulse		1 // 0x02 If Set invert Step pulse.
 #define fBITPOS_MZMetric1				2	// 0x04 If set use millimetres for Z axis.
+#define fBITPOS_ConstantArea			3	// 0x08 Thread passes remove equal chip area.
 #define fBITPOS_TrackSpindle			4	// 0x10 Real time update of stepper relative to spindle.
 #define fBITPOS_HalfNut					5	// 0x20 Electronic Half nut control on AtoD Channel 0 enable
 #define fBITPOS_TaperInwards			6	// 0x20 Electronic Half nut control on AtoD Channel 0 enable
+#define fBITPOS_RunUp					7	// 0x80 Threading passes start back by the run-up.
 
 #define	fMZInvertDirMotor			ZMotorFlags.Bit.Bit0 // 0x01 If set, inverts Motor direction.
 #define	fMZInvertedStepPulse		ZMotorFlags.Bit.Bit1 // 0x02 If Set invert Step pulse.
 #define fMZMetric1					ZMotorFlags.Bit.Bit2	// 0x04 If set use millimetres for Z axis.
+#define fConstantArea				ZMotorFlags.Bit.Bit3	// 0x08 Thread passes remove equal chip area.
 #define fTrackSpindle				ZMotorFlags.Bit.Bit4	// 0x10 Real time update of stepper relative to spindle.
 #define fHalfNut					ZMotorFlags.Bit.Bit5	// 0x20 Electronic Half nut control on AtoD Channel 0 enable
 #define fTaperInwards				ZMotorFlags.Bit.Bit6	// 0x20 Electronic Half nut control on AtoD Channel 0 enable
+#define fRunUp						ZMotorFlags.Bit.Bit7	// 0x80 Threading passes start back by the run-up.
 
 // Hardware specific X Motor information loaded from EEROM.
 extern BITS XMotorFlags;
@@ -160,6 +215,8 @@ extern BITS TaperFlags;
 #define fMovingOut					TaperFlags.Bit.Bit1		// X axis just moved Out
 #define	fTaperIn					TaperFlags.Bit.Bit2		// Tapering towards headstock.
 #define fCrossFeed					TaperFlags.Bit.Bit3		// X moves and Z doesn't
+#define fTaperXMaster				TaperFlags.Bit.Bit4		// Z steps off X for this X move.
+#define fTaperSteep					TaperFlags.Bit.Bit5		// More than one X step per Z step so X is the master.
 
 extern enum MOTOR_STATES MotorState;
 
@@ -172,13 +229,20 @@ extern volatile int32 ZMotorPosition;			// Absolute Motor Position.
 
 extern volatile int32 XStepCount;
 
-extern  volatile uint16 SpindleClocksPerRevolution;	// Holds last accumulated number of clocks per Rev.
+extern  volatile uint32 SpindleClocksPerRevolution;	// Holds last accumulated number of clocks per Rev.
 
-extern int32 RPMAverage[16];		// Holds the last 16 SpindleClocksPerRevolution
-extern int32 AveragedClocksPerRev;	// Average of RPMAverage[] array
-extern int AverageRPM;				// Average RPM
-extern int TargetRPM;				// 
+extern float32 SpindlePeriodRate;	// Change in spindle clocks per rev each spindle update.
+extern int32 AveragedClocksPerRev;	// Filtered SpindleClocksPerRevolution
+extern int16 AverageRPM;				// Average RPM
+extern int16 TargetRPM;			// 
 extern int32 LastSpindleClocks;
+extern float32 LeadScrewRatio;		// Z steps per spindle rev of the last threading move.
+extern uint32 ZDisplayScale, XDisplayScale;	// Display digits per step in fixed point.
+extern uint8 ZDisplayShift, XDisplayShift;		// and where its binary point is.
+extern uint8 DisplayScaleMetric;
+extern int32 DisplayPitch, DisplayTPI;	// Pitch in display digits and tenths of TPI.
+extern char DisplayPitchIndex;
+extern uint32 DisplayPitchBits;
 
 void InitMotorDevice(void);
 void MotorDevice(void);
@@ -191,6 +255,10 @@ int32 ZDistanceToSteps( float32 distance);
 float32 StepsToXDistance( int32 steps );
 int32 XDistanceToSteps( float32 distance);
 
+void SetupDisplayScale(void);
+uint8 DisplayScale(float32 s, puint32 pScale);
+int32 StepsToDisplay(int32 steps, uint32 scale, uint8 shift);
+
 int32 CalculateMotorDistance( float32 dist, float32 divisor, int8 units ); 
 
 void MotorStop(int8 device);
@@ -206,4 +274,34 @@ int8 MotorMoveTo( int8 device, 	// Motor X or Z
 		   /* int8 track */		// Track spindle speed 
 		   );
 
-int PrintRPM(int8 showSerial, int8 fShowSFM);
+#ifdef THREAD_PHASE_START
+int32 ThreadPhaseSteps(uint16 speed, int32 length);
+#endif
+#ifdef THREAD_RUN_UP
+int32 ThreadRunUpSteps(int32 length);
+#endif
+#ifdef FEED_HOLD
+int8 MotorFeedHold(void);
+int32 MotorResumeAt(int32 length, int32 xSteps, uint16 xSpeed);
+#endif
+#ifdef MOTION_QUEUE
+int8 MotorQueueMove(int8 device, int32 distance, uint16 speed, uint8 dir);
+#endif
+#ifdef TAPERING
+int8 MotorTaperMove(int32 position);
+#endif
+#ifdef RATIONAL_GEARING
+int8 SetupGearRatio(int8 ndx, puint32 pNum, puint32 pDen);
+#endif
+#ifdef CIRCULAR_INTERPOLATION
+int8 MotorArcMove(int32 zEnd, int32 xEnd, int32 zCentre, int32 xCentre);
+int8 ArcFeedRate(void);
+#endif
+#ifdef THREAD_PULL_OUT
+void MotorPullOut(int32 zSteps, int32 xSteps, uint8 dir);
+#endif
+
+int16 PrintRPM(int8 showSerial, int8 fShowSFM);
+#ifdef TRACK_SPINDLE_SPEED
+void PrintTracking(void);
+#endif
@@ -57,11 +57,15 @@ enum MOVEMENT_STATES  {
 	MOVE_WAIT_X_DONE,
 	MOVE_WAIT_X_BACKLASH_DONE,
 	MOVE_WAIT_X_RDY,
+	MOVE_TO_PHASE,
 	MOVE_TO_END,
 	MOVE_AT_END,
 	MOVE_WAIT_END_OUT,
 	MOVE_WAIT_END,
-	MOVE_WAIT_TO_START
+	MOVE_WAIT_TO_START,
+	MOVE_HOLD,
+	MOVE_HOLD_BACK,
+	MOVE_RESUME
 };
 
 extern enum MOVEMENT_STATES MovementState;
@@ -71,6 +75,7 @@ enum PASS_STATES {
 	ADJUST_PASS,
 	EACH_PASS,
 	LAST_PASS,
+	AREA_PASS,
 	SPRING_PASSES,
 	FINISHED_PASSES
 };
@@ -84,13 +89,20 @@ extern BITS MovementRunFlags;
 #define fMovementThreadMode			MovementRunFlags.Bit.Bit2	
 #define fExternalThreading			MovementRunFlags.Bit.Bit3
 #define fBallCutting				MovementRunFlags.Bit.Bit4
+#define fXApproach					MovementRunFlags.Bit.Bit5	// X on its way to the clearance point.
 
 
 void InitMovementThread(void);
 void SetCalculatePositionState( enum PASS_STATES state );
 void CalculatePasses(void);
+#ifdef CIRCULAR_INTERPOLATION
+void CalculateBallPosition(void);
+#endif
 
 void MoveHome(uint8 mtr, WORD spd);
 void MovementStartThread(void);
 void MovementStopThread(void);
+#ifdef FEED_HOLD
+int8 MovementFeedHold(void);
+#endif
 void MovementThread(void);
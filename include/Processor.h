@@ -34,7 +34,12 @@
 */
 
 // Custom includes for specific processors
+#ifdef HOST_BUILD
+// Linux build of the step interrupt and motor driver.  See host/HostShim.h
+#include "HostShim.h"
+#else
 #include <p18cxxx.h>
 //#include <p18F4680.h>
 #include <delays.h>
+#endif
 
@@ -96,8 +96,8 @@ InitIO(void) {
 	INTCON2 = 0x00;	// PORTB Pullup, Falling Edge INT0, Falling Edge INT1, 
 					// Low priority Interrupts for INT1,2 TMR0
 	INTCON3 = 0x00;	// All low priority, clear and disable INT2, INT1
-	IPR1 = 0x04;	// Pulse Clock Interrupt is the only high priority Int.
-	IPR2 = 0x00;
+	IPR1 = 0x06;	// Pulse Clock (TMR2) and Z step (CCP1) Interrupts are high priority.
+	IPR2 = 0x01;	// So is the X step (ECCP1).
 	RCON = 0x80;	// Allow priority interrupts.
 }
 
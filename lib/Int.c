@@ -85,6 +85,62 @@
 		Spindle tracking for spindle speed decrease.
 		1.10a
 		Spindle tracking for spindle speed increase too.
+		1.10j
+		Step pulses are no longer polled from the pulse clock.  Timer1 free runs and the CCP1 (Z) and
+		ECCP1 (X) compares are programmed with the time of the next step so pulses come out exactly
+		when they are due instead of on the next 50uS tick.  Timer2 now makes the 20KHz pulse clock
+		which still does the acceleration, spindle sensor and MPG.  Spindle tracking changes the step
+		period once per revolution rather than skipping Bresenham additions.
+		1.10k
+		Acceleration walks a table of step periods built by MotorDriver instead of adding the
+		acceleration to a 32 bit velocity and dividing it into a step period on every pulse clock.
+		1.10l
+		S-curve tables.  fZSCurve and fXSCurve moves are given their deceleration point rather than
+		counting steps to velocity.
+		1.10m
+		Electronic gearbox.  With an encoder on the spindle input every INT0 edge is a line and the
+		Z steps come straight from a Bresenham accumulator of steps per line.  The lines are counted
+		into a revolution so the index is only used to start the pass and measure RPM.
+		The pass ramps up on the step timer counting the lines' steps as GearOwed and each timed
+		step pays one.  It comes down to ZGearTop once GearOwed is ZGearDownSteps and when none
+		are owed there ZTopPeriod goes to 0 and the lines step Z.  Steps it got ahead by are
+		paid back by lines that don't step.
+		1.10n
+		The slot sensor can have SPINDLE_PULSE_REV_NDX slots.  Each slot's time is kept and the
+		revolution time is the sum of the last SpindleSlots of them so RPM and spindle tracking are
+		updated on every slot.  Threading still starts on the index slot.  The index is the slot
+		after a missing one, found by its period being over 5/4 of the average slot.  SlotCount is
+		put back on it whenever it's seen so a missed or noise edge only costs a revolution.
+		1.10o
+		SPINDLE_CAPTURE times the spindle edges with Timer1 in the INT0 interrupt instead of polling
+		the sensor on the pulse clock.  Spindle times are in SPINDLE_CLOCK_RATE clocks.  Slots,
+		encoder revolutions, RPM, spindle tracking and the threading start share one block of code.
+		The edge time is read first thing in __INTH so the step code doesn't delay it.
+		1.10q
+		THREAD_PHASE_START keeps the spindle clocks from the index to the last slot edge.  A threading
+		pass with a ZStartPhase starts when the spindle gets that far round instead of on the index.
+		1.10s
+		MOTION_QUEUE.  On the last step of a distance move the next queued segment is loaded without
+		stopping.  A segment with a ZRampEnd (XRampEnd) only slows down to that level.  A segment
+		that has to wait for the index stops and requests the move.
+		1.10t
+		TAccumulator and TaperTangent are a 32 bit fraction and the X step is taken on the carry.
+		With fTaperXMaster set each X step does the same sum and the carry steps Z through fZGearStep.
+		1.10u
+		CIRCULAR_INTERPOLATION.  The pulse clock steps an arc set up by MotorArcMove().  Z steps go
+		through fZGearStep and X is stepped in line like a taper.
+		1.10v
+		RATIONAL_GEARING.  GearNumerator and GearDenominator are exact.  A timed thread with
+		fPitchLock counts its Z steps against the revolutions in PitchError from the first index
+		up to speed and trims the step period by half the error each revolution.
+		1.11
+		THREAD_PULL_OUT.  Once a threading pass with fPullOutArmed gets to ZPullOutSteps from the
+		end X steps off Z on the carry of TAccumulator + PullOutTangent, as a taper does.
+		PullOutBacklash X steps come first, one per Z step, when X reverses to pull out.
+		1.11a
+		Spindle tracking follows the spindle period down to a fifth of the speed and up to the
+		MAX_STEP_RATE, moving SpinCorrection at most SpinSlew per update so a sudden change
+		doesn't ask more of Z than its acceleration.  Tracking statistics are kept for each move.
 	
 */
 
@@ -107,17 +163,53 @@
 // *** PRIVATE VARIABLES ***
 // Spindle Tracking variables.
 #ifdef TRACK_SPINDLE_SPEED
-int16 SpinRate;				// Spindle Speed at start of threading
-int16 NegSpinRate;			// Negative of Spindle Speed at start of threading
-int16 SpinClip;				// Half of SpinRate calculated outside interrupt routine for speed.
-int16 SpinAdder;
-int16 SpinCorrection;		// Difference between Spindle Speed at start of threading and during threading
+int32 SpinRate;				// Spindle Speed at start of threading
+int32 SpinClip;				// Slowest spindle tracked, calculated outside interrupt routine for speed.
+int32 SpinFloor;			// Fastest.  Negative.
+int32 SpinSlew;				// Most SpinCorrection moves in one update.
+int32 SpinCorrection;		// Difference between Spindle Speed at start of threading and during threading
+static int32 SpinTarget;	// What SpinCorrection is headed for.
+uint16 TrackUpdates;		// Statistics for the move.
+uint16 TrackSlewed;
+uint16 TrackClipped;
+int32 TrackCorrMin, TrackCorrMax;
+int32 TrackPitchMax;
 #endif
 
 static int16 IndexDebounce = 0;		// Used to count Pulse clocks before re-enabling spindle interrupt.
+static uint16 EncoderCount;			// Encoder lines since the last revolution.
+static uint8 SlotCount;				// Slots since the index slot.
+static int8 SlotsFilled;			// Slots timed since the spindle started.  -1 until the first edge.
+static uint32 SlotClocks[SPINDLE_SLOTS_MAX];	// Spindle clocks of each slot in the last revolution.
+static uint32 SpindleRevClocks;		// Sum of SlotClocks.
+static uint32 SlotPeriod;			// Spindle clocks of the slot that just went by.
+static uint8 SpindleEdge;			// Set when SlotPeriod is new.
+static uint8 SpindleGap;			// SlotPeriod followed the missing slot.
+volatile uint8 SpindleUpdates;		// Slots or revolutions timed since MotorDevice() took the last one.
+BITS SpindleFlags;
+uint8 IndexMisses;					// Index slots in a row that didn't follow a gap.
+#ifdef SPINDLE_CAPTURE
+static uint16 Timer1High;			// Timer1 overflows.
+static uint32 SpindleTime;			// Timer1 time of this INT0 edge.
+static uint8 SpindleEdgeLatched;	// SpindleTime was read as the interrupt came in.
+static uint32 SpindleEdgeTime;		// Timer1 time of the last slot or revolution.
+static uint32 SpindleEdgeMin;		// Edges sooner than this after the last are noise.
+#endif
+static uint32 GearAccumulator;		// Bresenham accumulator for the electronic gearbox.
+static int32 GearOwed;				// Lines' steps Z hasn't made while ramping on to the encoder.
+#ifdef THREAD_PHASE_START
+static uint32 IndexPhase;			// Spindle clocks from the index to the last slot edge.
+static uint32 PhaseNow;				// Spindle clocks since the index.
+#endif
+static uint8 ZStart;				// Start the requested Z move now.
 
-static uint16 Zholder = 0;			// Bresenham accumulator
-static int32 tempZvel;				// Temp to speed up the math.
+// Step scheduling.  All times are Timer1 counts << STEP_FRACTION_BITS.
+static uint16 StepTimer;			// Timer1 snapshot.
+static uint32 ZStepClock;			// Time CCP1 is set to interrupt at.
+static uint32 ZStepElapsed;			// Time since the last Z step.
+static uint32 ZStepWait;			// Length of the wait programmed into CCP1.
+static uint8 ZRampLevel;			// Ramp table level the motor is at.  0 is stopped.
+static uint16 ZRampCount;			// Pulse clocks left at this level.
 
 // Spindle Sensor state machine.
 enum SPINDLE_INT_STATES {
@@ -125,14 +217,15 @@ enum SPINDLE_INT_STATES {
 	SPINDLE_INT_LEVEL_HI,
 	SPINDLE_INT_LEVEL_LO,
 	SPINDLE_INT_FEDGE_CHECK,
-	SPINDLE_INT_REDGE_CHECK
+	SPINDLE_INT_REDGE_CHECK,
+	SPINDLE_INT_COUNTING			// INT0 times the spindle.
 } SpindleIntState;
 
 #define INDEX_DEBOUNCE	4			// Number of pulse clocks that a new spindle sensor value must be active.
+#define SPINDLE_EDGE_MIN	(SPINDLE_CLOCK_RATE / 5000)	// 200uS.  Shortest slot INT0 will time.
 
 // *** PUBLIC VARIABLES ***
 volatile int32 MaxZVel;				// Target Velocity * 2048
-volatile int32 ZVel;  				// Current velocity * 2048
 volatile int32 ZAcc; 				// Acceleration
 volatile int32 NewZVel;				// Maximum RPM when a distance move is requested with fZMoveRQ
 int32 ZBackLashCount;		// Used inside interrupt routine.
@@ -141,22 +234,76 @@ volatile int32 ZStepCount;			// Number of steps to turn Leadscrew.
 volatile int32 StepsToZVel;			// Number of steps it took to get to maximum speed.
 volatile int32 ZMotorPosition; 		// absolute Motor Position as a signed # of encoder steps.
 volatile int32 ZHalfwayPoint;		// Point at which we must start slowing down even if target velocity not reached.
+volatile int32 ZDecelSteps;			// Steps an S-curve needs to stop.  0 for a linear ramp.
 
 volatile uint16 SpindleClockValue;	// Accumulates Pulse Clocks per Spindle Revolution
+uint8 SpindleSlots;					// Slots per spindle rev for a slot sensor.
+uint16 SpindleLines;				// Encoder lines per spindle rev.  1 for a single slot sensor.
+uint32 GearNumerator;				// Steps per line, or per rev for a timed thread, is
+uint32 GearDenominator;				// GearNumerator / GearDenominator.
+uint8 ZGearTop;						// Ramp level a geared pass creeps at.
+uint32 ZGearPeriod;					// Step period it creeps at.  ZTopPeriod is 0 once geared.
+int32 ZGearDownSteps;				// Steps the ramp down to ZGearTop makes up.
+#ifdef RATIONAL_GEARING
+BITS PitchFlags;
+volatile int32 PitchError;			// Revolutions * GearNumerator - Z steps * GearDenominator.
+int32 PitchClip;					// Largest PitchError the correction is worked out for.
+uint32 ZPeriodPerPitch;				// ZCruisePeriod / (2 * GearNumerator) << TRACK_FRACTION_BITS.
+static int32 PitchCorrection;		// Taken off the tracked step period.
+#endif
+
+volatile uint32 ZStepPeriod;		// Time between Z steps.  0 when stopped.
+uint32 ZCruisePeriod;				// Step period at the threading speed.
+uint32 ZPeriodPerClock;				// ZCruisePeriod / SpinRate << TRACK_FRACTION_BITS for spindle tracking.
+uint32 ZStartPhase;					// Spindle clocks after the index a threading pass starts.  0 on the index.
+uint8 ZPhaseArmed;					// Spindle seen short of ZStartPhase since the request.
+
+// Acceleration ramp.  MotorDriver fills in the table and the set point.
+uint16 ZRampTicks;					// Pulse clocks spent at each table level.
+volatile uint8 ZRampTop;			// Level to ramp to.
+volatile uint32 ZTopPeriod;			// Exact step period at ZRampTop.
+#ifdef MOTION_QUEUE
+MOTION_SEGMENT ZQueue[SEGMENT_QUEUE_SIZE];	// Filled by MotorQueueMove().
+volatile uint8 ZQueueHead;			// Next free entry.
+volatile uint8 ZQueueTail;			// Next segment to run.
+volatile uint8 ZRampEnd;			// Level the running segment slows down to.  0 to stop.
+#endif
 
 // Run time flags not loaded from EEROM.
 BITS ActiveFlags;		// Used to control access to stepper interrupt code.
+BITS ArcFlags;
+#ifdef THREAD_PULL_OUT
+BITS PullOutFlags;
+volatile int32 ZPullOutSteps;		// Steps from the end of the pass X starts pulling out.
+int32 PullOutBacklash;				// X backlash steps to take up first.
+uint32 PullOutTangent;				// Fraction of an X step per Z step pulling out.
+#endif
+#ifdef CIRCULAR_INTERPOLATION
+volatile int32 ArcError;
+volatile int32 ArcXTerm, ArcZTerm;
+int32 ArcXInc, ArcZInc;
+volatile int32 ArcXLeft, ArcZLeft;
+volatile int16 ArcXLead, ArcZLead;
+volatile uint32 ArcFeed;
+uint32 ArcXCost, ArcZCost, ArcXZCost;
+uint32 ArcDistance;
+uint32 ArcCost;
+uint8 ArcNext;
+static int32 ArcTry, ArcBest;		// Error after each choice of step.
+#endif
 
 
 
 #ifdef X_AXIS
 // *** PRIVATE VARIABLES ***
-static uint16 Xholder = 0;			// Bresenham accumulator
-static int32 tempXvel;				// Temp to speed up the math.
+static uint32 XStepClock;			// Time ECCP1 is set to interrupt at.
+static uint32 XStepElapsed;			// Time since the last X step.
+static uint32 XStepWait;			// Length of the wait programmed into ECCP1.
+static uint8 XRampLevel;			// Ramp table level the motor is at.  0 is stopped.
+static uint16 XRampCount;			// Pulse clocks left at this level.
 
 // *** PUBLIC VARIABLES ***
 volatile int32 MaxXVel;				// Target Velocity * 2048
-volatile int32 XVel;  				// Current velocity * 2048
 volatile int32 XAcc; 				// Acceleration
 volatile int32 NewXVel;				// Maximum RPM when a distance move is requested with fZMoveRQ
 
@@ -165,8 +312,26 @@ volatile int32 XMotorAbsPosition; 		// Absolute Motor Position as a signed # of
 volatile int16 XMotorIncrement;		// Used to track steps for absolute rather than relative X motion.
 volatile int32 XBackLashCount;
 volatile int32 StepsToXVel;			// Number of steps it took to get to maximum speed.
+volatile uint32 XStepPeriod;		// Time between X steps.  0 when stopped.
+uint16 XRampTicks;					// Pulse clocks spent at each table level.
+volatile uint8 XRampTop;			// Level to ramp to.
+volatile uint32 XTopPeriod;			// Exact step period at XRampTop.
+#ifdef MOTION_QUEUE
+MOTION_SEGMENT XQueue[SEGMENT_QUEUE_SIZE];
+volatile uint8 XQueueHead;
+volatile uint8 XQueueTail;
+volatile uint8 XRampEnd;
+#endif
 #endif
 
+// The ramp tables fill a bank of their own.
+#pragma udata RAMP_TABLES
+uint16 ZRampTable[RAMP_TABLE_SIZE];	// Step periods in Timer1 counts.  Entry 0 is level 1.
+#ifdef X_AXIS
+uint16 XRampTable[RAMP_TABLE_SIZE];
+#endif
+#pragma udata
+
 #define X4_ENCODER	1
 
 #ifdef X4_ENCODER
@@ -179,36 +344,31 @@ static int8 EncoderCounter;
 #ifdef TAPERING
 /*
  For every Z step we step X tan(taperangle).  To get reasonable accuracy
- TaperTangent is 65536 * tan(taperangle).  This assumes the X moves the same distance per step
- as the Z.
+ TaperTangent is 2^32 * tan(taperangle), a fraction of a step.  This assumes the X moves the same 
+ distance per step as the Z.
    For example:
-		If the taper angle was 45 degrees then for very Z step we have an X step since tan(45) == 1
-		So TaperTangent has the value tan(45) * 65536 which == 65536.
-		On every step, adding 65536 (0x10000) to the accumulator results in an overflow but nothing
-		in the low word.  Perfect 45 degree tracking.
 		For a Morse #2 which is 0.04995"/inch = tan(theta).  (Theta is 1/2 the included angle)
-			so 0.04995 * 65536 == 3274.
-		For every step on Z we accumulate 3274 in the TAccumulator.Bresenham.
-		When it rolls over into the High word we step X once and clear the High Word leaving the low word
-		alone.
+			so 0.04995 * 2^32 == 214533616.
+		For every step on Z we add 214533616 to TAccumulator.
+		When it carries out of the 32 bits we step X once.  What's left over is the fraction of the 
+		next X step.
+		A taper steeper than one X step per Z step can't be done that way round.  Then X is the
+		master and the same sum done on each X step steps Z, with TaperTangent being Z steps per
+		X step.  fTaperSteep says which way round it is.  The X move is still sized from the Z
+		length of the taper so it stops short of facing; a taper so steep TaperTangent rounds to
+		0 has no X distance and MotorTaperMove() refuses it.
 		In fact, the value of the TaperTangent is based on what fraction of an inch that Z moves per 
 		step and what fraction X moves.
 		So if the ratios are such that if Z moves one step it moves the carriage 0.0005" and each X 
 		step moves the cross slide 0.00025" then Z/X * TaperTangent is the amount that X really adds 
 		to the bresenham accumulator; in this example, X needs to step twice as much or the 
-		TaperTangent is 6547 (2 * 3273.53)
+		TaperTangent is 429067232 (2 * 214533616)
 		These constants are all worked out before any motion takes place.
 
 */
-union BRESENHAM {
-  int32	Bresenham;
-  struct {
-	uint16  Low;
-	uint16  High;
-  };
-} TAccumulator;
-
-int32 TaperTangent;
+uint32 TAccumulator;
+
+uint32 TaperTangent;
  
 #endif
 
@@ -410,10 +570,41 @@ InitInterruptVariables(void) {
 	OldEnc = NewEnc;
 	// Tapering Variables initialization.
 #ifdef TAPERING
-	TAccumulator.Bresenham = 0;
+	TAccumulator = 0;
 #endif
 	ZBackLashCount = 0;
-	SpindleIntState = SPINDLE_INT_NOT_TURNING;
+	// An encoder on the spindle input has more than one line.  It times whole revolutions.
+	SpindleLines = GetGlobalVarWord(ENCODER_LINES_NDX);
+	SpindleSlots = GetGlobalVarByte(SPINDLE_PULSE_REV_NDX);
+	if ((SpindleSlots < 1) || (SpindleLines > 1))
+		SpindleSlots = 1;
+	else if (SpindleSlots > SPINDLE_SLOTS_MAX)
+		SpindleSlots = SPINDLE_SLOTS_MAX;
+#ifdef SPINDLE_CAPTURE
+	SpindleIntState = SPINDLE_INT_COUNTING;
+	SpindleEdgeMin = SPINDLE_EDGE_MIN;
+#else
+	if (SpindleLines > 1)
+		SpindleIntState = SPINDLE_INT_COUNTING;
+	else
+		SpindleIntState = SPINDLE_INT_NOT_TURNING;
+#endif
+	EncoderCount = 0;
+	GearAccumulator = 0;
+#ifdef RATIONAL_GEARING
+	PitchFlags.Byte = 0;
+	PitchError = 0;
+	PitchCorrection = 0;
+#endif
+	SlotCount = 0;
+	SlotsFilled = -1;
+	SpindleEdge = 0;
+	SpindleFlags.Byte = 0;
+	fSpindleIndexed = (SpindleSlots == 1);
+	IndexMisses = 0;
+	SpindleUpdates = 0;
+	ZStart = 0;
+	ZStartPhase = 0;
 
 	ZEncoderCounter = 0;
 
@@ -424,14 +615,85 @@ InitInterruptVariables(void) {
 
 	SpindleClocksPerRevolution = 0;	// Don't know if the spindle is turning yet so spindle RPM is 0.
 
+	ZStepPeriod = 0;
+	ZRampLevel = 0;
+	ZRampTop = 0;
+	ZTopPeriod = 0;
+	XStepPeriod = 0;
+	XRampLevel = 0;
+	XRampTop = 0;
+	XTopPeriod = 0;
+#ifdef MOTION_QUEUE
+	ZQueueHead = ZQueueTail = 0;
+	ZRampEnd = 0;
+	XQueueHead = XQueueTail = 0;
+	XRampEnd = 0;
+#endif
+#ifdef THREAD_PULL_OUT
+	PullOutFlags.Byte = 0;
+	ZPullOutSteps = 0;
+	PullOutBacklash = 0;
+	PullOutTangent = 0;
+#endif
+#ifdef CIRCULAR_INTERPOLATION
+	ArcFlags.Byte = 0;
+	ArcFeed = 0;
+	ArcDistance = 0;
+	ArcCost = 0;
+	ArcNext = 0;
+#endif
+
 #ifdef TRACK_SPINDLE_SPEED
-	SpinAdder = 0;
 	SpinRate = 0;
 	SpinCorrection = 0;
 	SpinClip = 0;
+	SpinFloor = 0;
+	SpinSlew = 0;
+	TrackUpdates = TrackSlewed = TrackClipped = 0;
+	TrackCorrMin = TrackCorrMax = 0;
+	TrackPitchMax = 0;
 #endif
 }
 
+#ifdef THREAD_PHASE_START
+/*
+ *  FUNCTION: GetSpindlePhase
+ *
+ *  PARAMETERS:		None
+ *
+ *  USES GLOBALS:	IndexPhase, SpindleEdgeTime, Timer1High, SpindleClockValue
+ *
+ *  DESCRIPTION:	How far the spindle has turned since the index.  The slots timed since
+ *					the index plus the time since the last slot edge.
+ *
+ *  RETURNS: 		Spindle clocks since the index.  -1 until the spindle has done a whole
+ *					revolution.
+ *
+ */
+int32
+GetSpindlePhase(void) {
+  uint16 t;
+  uint32 now;
+  int32 phase = -1;
+
+	INTCON &= 0x3F;
+	if ((SlotsFilled >= (int8)SpindleSlots) && fSpindleIndexed) {
+#ifdef SPINDLE_CAPTURE
+		t = TMR1L;
+		t |= (uint16)TMR1H << 8;
+		now = ((uint32)Timer1High << 16) | t;
+		if (PIR1bits.TMR1IF && !(t & 0x8000))
+			now += 0x10000L;
+		phase = IndexPhase + ((now - SpindleEdgeTime) >> SPINDLE_CLOCK_SHIFT);
+#else
+		phase = IndexPhase + SpindleClockValue;
+#endif
+	}
+	INTCON |= 0xC0;
+	return(phase);
+}
+#endif
+
 // *** PRIVATE FUNCTIONS ***
 
 /*
@@ -443,6 +705,7 @@ InitInterruptVariables(void) {
 void __INTH(void);
 void high_vector_branch (void);
 
+#ifndef HOST_BUILD
 #ifdef BOOTLOADER
 #pragma code high_vector=0x808
 #else
@@ -455,20 +718,30 @@ CALL high_vector_branch, 1
 _endasm
 }
 #pragma code /* return to the default code section */
+#endif
 
 /*
-	High Priority interrupt which is called for the 20KHz Pulse clock (CCP1) and the index pulse 
-	on the spindle (INT0).
+	High Priority interrupt which is called for the step compares (CCP1 for Z, ECCP1 for X), the
+	20KHz Pulse clock (Timer2) and the index pulse on the spindle (INT0).
+
+	Timer1 free runs at 10MHz.  Each axis keeps the time of its next step and the compare for that
+	axis is loaded with it, so the step interrupt only happens when a step is due and the pulse
+	comes out when it is due rather than on the next pulse clock.  Times are kept in 1/256ths of a
+	Timer1 count (STEP_FRACTION_BITS) so the fraction of a count left over from one step carries
+	into the next and the average step rate is exact.  A step further away than STEP_WAIT_MAX is
+	reached in several compares so a velocity change is seen at least every millisecond.
 
-	SpindleClockValue is incremented on each CCP1 event and saved and cleared on each index pulse 
+	SpindleClockValue is incremented on each Pulse clock and saved and cleared on each index pulse
     providing a value from RPM and step rates can be calculated.
 
 	The speed argument to the stepper is in either NewVel or MaxVel and is the stepping rate.
 
-	The variable Vel holds the current stepper speed.  
-	
-	To accelerate or decelerate, the accelertion value Acc is added	or subtracted from the Vel variable
-	depending on the fDeccel flag.  Once Vel is equal to MaxVel, Acc is no longer used.
+	The variable Vel holds the current stepper speed.
+
+	To accelerate or decelerate, the ramp level moves up or down one entry of the RampTable every
+	RampTicks Pulse clocks depending on the fDeccel flag.  The table holds the step period for each
+	level so there's no velocity math or divide here.  RampTop is the level of the set point and
+	TopPeriod its exact step period.  Once at RampTop the Pulse clock leaves the axis alone.
 
 
     There are two ways to make the stepper turn:
@@ -481,12 +754,13 @@ _endasm
 
 	    The application requests a move by setting fZMoveRQ.  When an Index pulse occurs, this function
 		ACKs the command by clearing the fZMoveRQ and setting the fZMoveBSY. It also copies NewVel into MaxVel
-		which starts the motor. 
-		
-	Normal elapsed time for each 50uS interrupt is about 23uS.  It jumps to about at least 40uS during deeper nesting for 
-	a single step. 
-		
+		which starts the motor.
+
+	Normal elapsed time for each 50uS interrupt is about 23uS.  It jumps to about at least 40uS during deeper nesting for
+	a single step.
+
 */
+#ifndef HOST_BUILD
 // From the errata sheet to save clock cycles
 void high_vector_branch (void)
 {
@@ -495,318 +769,656 @@ POP
 GOTO __INTH
 _endasm
 }
+#endif
 
 // Note!! Due to PIC Microprocessor errata, we have to tell the compiler not to make a
 // RETFIE FAST hence the interruptlow __INTH.
+// The spindle tracking multiply uses the math library so its scratch area has to be saved as well.
 //#pragma interruptlow __INTH
-#pragma interrupt __INTH
+#pragma interrupt __INTH save=section(".tmpdata"), section("MATH_DATA")
 
-void 
+void
 __INTH(void) {
+#ifdef SPINDLE_CAPTURE
+	/*
+		Time a spindle edge before anything else.  The step and pulse clock code below can
+		spend tens of microseconds waiting on the micro-step SPI.  An edge that comes in
+		while this runs leaves INT0F set and is timed as soon as the interrupt comes back.
+		Timer1High only changes in here so the overflow test is the same as it is below.
+	*/
+	SpindleEdgeLatched = INTCONbits.INT0E && INTCONbits.INT0F;
+	if (SpindleEdgeLatched) {
+		StepTimer = TMR1L;
+		StepTimer |= (uint16)TMR1H << 8;
+		SpindleTime = ((uint32)Timer1High << 16) | StepTimer;
+		if (PIR1bits.TMR1IF && !(StepTimer & 0x8000))
+			SpindleTime += 0x10000L;
+	}
+#endif
+	/*
+		Z axis step.  CCP1 matched Timer1 either at the time of the next step or at the end of
+		a STEP_WAIT_MAX wait on the way there.  When gearing the spindle encoder sets the flag
+		instead and ZStepPeriod stays 0 once the pass has ramped on to it.
+	*/
 	if (PIE1bits.CCP1IE && PIR1bits.CCP1IF) {
-	    PIR1bits.CCP1IF = 0;
+		PIR1bits.CCP1IF = 0;
+		ZStepElapsed += ZStepWait;			// Time since the last step.
 
-		if (bESTOP ^ fEStop) {
-			SystemError = MSG_ESTOP_INPUT_ACTIVE;
-			// Kill any motion in progress so when ESTOP button is released motion doesn't restart.
-			// Z Axis (Lead Screw)
-			ZVel = MaxZVel = 0;	// Clear out velocity.
-			fZAxisActive = 0;	// Disable Axis.
-			fZMoveBSY = 0;  	// No move in progress.
-			// X Axis (Cross Slide)
-			XVel = MaxXVel = 0;	// Clear out velocity.
-			fXAxisActive = 0;	// Disable Axis.
-			fXMoveBSY = 0;  	// No move in progress.
-			// Now return which ends up also stopping charge pump output since the bit is never set.
-			// That should drop power off devices like Servo motors.
-			return;
-		}
-
-		// For motor drivers with simple enable lines we don't use a charge pump.
-		bCHARGE_Pump = 1;	// Also a good way to see approximately how long int32 interrupt routine takes.
-
-		// Now the actual stepping code.
-		if (fZAxisActive) {	// Jogging or Programmed Move.
-			// MaxVel is the velocity set point.
-			if (fZDeccel) {
-				ZVel -= ZAcc;  				// if we're decelerating, subtract the acceleration
-				if (ZVel < MaxZVel) { 		// Don't allow velocity to go negative
-					fZDeccel = 0;			// We've reached our set point so no longer decelerating.
-					ZVel = MaxZVel;			// In case we underflowed set it to the proper value.
-					if (ZVel == 0) {		// With the velocity value now zero, ZHolder won't increment and
-						fZAxisActive = 0;	// therefore no more steps so prevent access to this code now.
-						fZMoveBSY = 0;  	// But do tell the world we've finished our move.
-					}
-				}
-	   	 	}
+		if (fZGearStep || ((ZStepPeriod != 0) && (ZStepElapsed >= ZStepPeriod))) {
+			if (fZGearStep)
+				fZGearStep = 0;				// Encoder line's step.  No timing to keep.
 			else {
-				tempZvel = ZVel+ZAcc;
-	    		if( tempZvel <= MaxZVel ) // LT or EQ allows us to reach set point.
-					ZVel = tempZvel;   // otherwise accelerate if need be.
-	        	else {
-					ZVel = MaxZVel;  	//  to clip to max velocity
-					fZUpToSpeed = 1;	// Reached maximum speed so stop counting distance to maximum speed.
+				ZStepElapsed -= ZStepPeriod;	// Leave the fraction for the next step.
+				if (ZStepElapsed >= ZStepPeriod)	// Period got a lot shorter while we waited so
+					ZStepElapsed = 0;				// don't try and catch up.
+				if (fGearing) {					// Ramping on to the encoder.
+					if ((--GearOwed <= 0) && (ZTopPeriod == ZGearPeriod) && fZUpToSpeed) {
+						ZTopPeriod = 0;			// Caught up so the lines step it from here.
+						ZStepPeriod = 0;
+					}
+					else if ((GearOwed <= ZGearDownSteps) && (ZTopPeriod != ZGearPeriod)
+							&& ((ZRampLevel > ZGearTop) || fZUpToSpeed)) {
+						ZTopPeriod = ZGearPeriod;	// Nearly there so come down to creep.
+						if (ZRampTop > ZGearTop) {
+							ZRampTop = ZGearTop;
+							fZDeccel = 1;
+							fZUpToSpeed = 0;
+						}
+						else if (fZUpToSpeed)
+							ZStepPeriod = ZGearPeriod;
+					}
 				}
-	    	}
-			
-#ifdef TRACK_SPINDLE_SPEED
-			if ( fThreading && fZUpToSpeed ) {	// If up to speed allow adding in of ZVel into ZHolding register.
-				SpinAdder += SpinCorrection;	// 
-// 16MAR12 -- jcd -- Change to >= so SpinAddr doesn't slowly accumulate
-				if (SpinAdder >= SpinRate) 		// If we've overflowed, then don't allow the addition which is like skipping one clock period.
-				//if (SpinAdder > SpinRate) 		// If we've overflowed, then don't allow the addition which is like skipping one clock period.
-					SpinAdder -= SpinRate;
-				else
-			    	Zholder += (ZVel >> 16); // holder is the main Bresenham variable count, it rolls over PULSE_CLOCK_RATE when a pulse is necessary.
+			}
 
-// 16MAR12 -- jcd -- Change to <= so SpinAddr doesn't slowly accumulate
-				if (SpinAdder <= NegSpinRate) { // If Spindle is turning faster, than this will make the step happen sooner.
-				//if (SpinAdder < NegSpinRate) { // If Spindle is turning faster, than this will make the step happen sooner.
-					SpinAdder += SpinRate; 		
-			    	Zholder += (ZVel >> 16); // holder is the main Bresenham variable count, it rolls over PULSE_CLOCK_RATE when a pulse is necessary.
+			// In the following code we potentially invert the direction bit but only do that once. (faster interrupt routine)
+			// Then determine if direction has changed and also set the new direction
+			if ((fZDirectionCmd ^ fMZInvertDirMotor) == MOVE_RIGHT)  { // Test possible new direction of motor.
+				 if ( !bMZDirectionMotor ) {	// if current direction also not a 1 then direction has changed.
+					ZBackLashCount = SystemZBackLashCount;	// So first do backlash motion.
+					ZStepCount += ZBackLashCount;	// Increase distance by backlash.
 				}
-
-
-			}
-			else	// Not up to speed so just allow acceleration to happen.
-#endif
-	    		Zholder += (ZVel >> 16); // holder is the main Bresenham variable count, it rolls over PULSE_CLOCK_RATE when a pulse is necessary.
-	
-	    	if( Zholder >= PULSE_CLOCK_RATE ) { // PULSE_CLOCK_RATE = inverse of our interrupt period -- maximum step frequency.
-				// In the following code we potentially invert the direction bit but only do that once. (faster interrupt routine)
-				// Then determine if direction has changed and also set the new direction
-				if ((fZDirectionCmd ^ fMZInvertDirMotor) == MOVE_RIGHT)  { // Test possible new direction of motor.
-					 if ( !bMZDirectionMotor ) {	// if current direction also not a 1 then direction has changed.
-						ZBackLashCount = SystemZBackLashCount;	// So first do backlash motion.
-						ZStepCount += ZBackLashCount;	// Increase distance by backlash.
-					}
-					bMZDirectionMotor = MOVE_RIGHT;		// This is faster than doing the XOR on the direction bit to change
-				}										// the polarity since we know it's 1 at this point.				
-				else { // Direction of motor is LEFT
-					 if (bMZDirectionMotor) {	// if not also a 0 then direction has changed.
-						ZBackLashCount = SystemZBackLashCount;
-						ZStepCount += ZBackLashCount;
-					}
-					bMZDirectionMotor = MOVE_LEFT;
+				bMZDirectionMotor = MOVE_RIGHT;		// This is faster than doing the XOR on the direction bit to change
+			}										// the polarity since we know it's 1 at this point.
+			else { // Direction of motor is LEFT
+				 if (bMZDirectionMotor) {	// if not also a 0 then direction has changed.
+					ZBackLashCount = SystemZBackLashCount;
+					ZStepCount += ZBackLashCount;
 				}
+				bMZDirectionMotor = MOVE_LEFT;
+			}
 
 #ifdef MICRO_STEPPING
-				if (fZLocalMicroStep) {	// Send out first byte which will end up at PhaseB device U5
-					// Since direction may have changed we have to point to the new location after 
-					// the direction has been set up.
-					PhaseBIndex = PhaseAIndex;	// Set new location.
-					if (fZDirectionCmd ^ fMZInvertDirMotor) 
-						SSPBUF = MicroStepBTableBkwd[PhaseBIndex];
-					else
-						SSPBUF = MicroStepBTableFwd[PhaseBIndex];
-				}
-				else {
-					bMZStepMotor = 1 ^ fMZInvertedStepPulse;  // STEP
-				}  
+			if (fZLocalMicroStep) {	// Send out first byte which will end up at PhaseB device U5
+				// Since direction may have changed we have to point to the new location after
+				// the direction has been set up.
+				PhaseBIndex = PhaseAIndex;	// Set new location.
+				if (fZDirectionCmd ^ fMZInvertDirMotor)
+					SSPBUF = MicroStepBTableBkwd[PhaseBIndex];
+				else
+					SSPBUF = MicroStepBTableFwd[PhaseBIndex];
+			}
+			else {
+				bMZStepMotor = 1 ^ fMZInvertedStepPulse;  // STEP
+			}
 #else
-					bMZStepMotor = 1 ^ fMZInvertedStepPulse;  // STEP
+				bMZStepMotor = 1 ^ fMZInvertedStepPulse;  // STEP
 #endif
-	  
-	        	Zholder -= PULSE_CLOCK_RATE;  // wait for next one;  //then subtract PULSE_POINT from the accumulator..
-				// Any overflow stays in accumulator resulting in the next pulse coming sooner.
-	
-				// Update DRO only if we're not doing backlash compensation.
-				if (ZBackLashCount == 0) {
-					if (fZDirectionCmd == MOVE_RIGHT) 	// Test if MOVE_RIGHT	
-						ZMotorPosition++; 	// MOVE_RIGHT
-					else 
-						ZMotorPosition--;	// MOVE_LEFT
+
+			// Update DRO only if we're not doing backlash compensation.
+			if (ZBackLashCount == 0) {
+				if (fZDirectionCmd == MOVE_RIGHT) 	// Test if MOVE_RIGHT
+					ZMotorPosition++; 	// MOVE_RIGHT
+				else
+					ZMotorPosition--;	// MOVE_LEFT
+	#ifdef RATIONAL_GEARING
+				if (fPitchLocked)
+					PitchError -= GearDenominator;	// Paid for one step.
+	#endif
 	#ifdef TAPERING
-					// Only taper on X when we're _not_ doing backlash compensation.
-					if (fTapering) {
-						// This particular bit of addition lends itself better to assembler where
-						// we could just add the low 16 bits and check the carry flag.
-						TAccumulator.Bresenham += TaperTangent;		// Add in tangent.	
-						if (TAccumulator.High > 0) {				// Overflow?
-							TAccumulator.High = 0;					// clear overflow
-							// remainder of overflow is still in Low. Now step.
-							// MOVE_LEFT makes fZDirectionCmd 0.  fTaperDirection is 1 if moving inwards to headstock
-							//		decrement X position
-							// MOVE_RIGHT makes fXDirectionCmd 1.  fTaperDirection is 1 if moving inwards to headstock
-							// 		Increment X position.
-							// MOVE_LEFT makes fZDirectionCmd 0.  fTaperDirection is 0 if moving outwards to headstock
-							//		increment X position
-							// MOVE_RIGHT makes fXDirectionCmd 1.  fTaperDirection is 0 if moving outwards to headstock
-							// 		deccrement X position.
-							// So update DRO and step.
-							if ((fZDirectionCmd ^ fTaperDirection) == 1) { //MOVE_IN) {
-								bMXDirectionMotor = MOVE_IN ^ fMXInvertDirMotor; 
-								XMotorRelPosition--; 	// decrement X position.
-								XMotorIncrement--;		// External thread will track absolute position using this variable.
+				// Only taper on X when we're _not_ doing backlash compensation.
+				if (fTapering && !fTaperSteep) {
+					TAccumulator += TaperTangent;				// Add in tangent.
+					if (TAccumulator < TaperTangent) {			// Carried out?
+						// The remainder is the fraction of the next X step. Now step.
+						// MOVE_LEFT makes fZDirectionCmd 0.  fTaperDirection is 1 if moving inwards to headstock
+						//		decrement X position
+						// MOVE_RIGHT makes fXDirectionCmd 1.  fTaperDirection is 1 if moving inwards to headstock
+						// 		Increment X position.
+						// MOVE_LEFT makes fZDirectionCmd 0.  fTaperDirection is 0 if moving outwards to headstock
+						//		increment X position
+						// MOVE_RIGHT makes fXDirectionCmd 1.  fTaperDirection is 0 if moving outwards to headstock
+						// 		deccrement X position.
+						// So update DRO and step.
+						if ((fZDirectionCmd ^ fTaperDirection) == 1) { //MOVE_IN) {
+							bMXDirectionMotor = MOVE_IN ^ fMXInvertDirMotor;
+							XMotorRelPosition--; 	// decrement X position.
+							XMotorIncrement--;		// External thread will track absolute position using this variable.
+						}
+						else {
+							bMXDirectionMotor = MOVE_OUT ^ fMXInvertDirMotor;
+							XMotorRelPosition++;	// So increment X position.
+							XMotorIncrement++;
+						}
+						bMXStepMotor = 1 ^ fMXInvertedStepPulse;  // STEP
+					}
+				}
+	#endif
+	#ifdef THREAD_PULL_OUT
+				// Same again for a pull out.  The direction was set when it started.
+				else if (fPullingOut) {
+					// X turns round coming out so its backlash goes first, a step per Z step.
+					if (XBackLashCount > 0) {
+						XBackLashCount--;
+						bMXStepMotor = 1 ^ fMXInvertedStepPulse;  // STEP
+					}
+					else {
+						TAccumulator += PullOutTangent;
+						if (TAccumulator < PullOutTangent) {
+							if (fPullOutDir == MOVE_OUT) {
+								XMotorRelPosition++;
+								XMotorIncrement++;
 							}
 							else {
-								bMXDirectionMotor = MOVE_OUT ^ fMXInvertDirMotor; 
-								XMotorRelPosition++;	// So increment X position.
-								XMotorIncrement++;
+								XMotorRelPosition--;
+								XMotorIncrement--;
 							}
 							bMXStepMotor = 1 ^ fMXInvertedStepPulse;  // STEP
 						}
 					}
-	#endif
 				}
-				else
-					ZBackLashCount--;
+	#endif
+			}
+			else
+				ZBackLashCount--;
+
 
-							
 #ifdef MICRO_STEPPING
-				// Another Step Done
-				if (fZLocalMicroStep) {
-					// Make sure SPI byte has been completely transmitted.
-					while (!SSPSTATbits.BF) 
-						;
-					// Now send out second byte for phase A coil which ends up in U4
-					// Then increment or decrement pointer
-		  			// to set up for next table entry while Phase A is being shifted out.
-					if (fZDirectionCmd ^ fMZInvertDirMotor) {
-						SSPBUF = MicroStepATableBkwd[PhaseAIndex];  		// Get second Byte
-						--PhaseAIndex;
-					}
-					else {
-						SSPBUF = MicroStepATableFwd[PhaseAIndex];  		// Get second Byte
-						++PhaseAIndex;
-					}
-					// wrap it.
-					PhaseAIndex &= MSTEPTABLEMASK;
-
-					// Should be done sending via 10Mhz SPI but check anyway.
-					while (!SSPSTATbits.BF) 
-						;
-					// Transfer data from serial shift register to parallel outputs
-					// on 74HC595.
-					bMOTOR_LATCH = 1;
-					fStepHappened = 1;	// Tell world a step occurred.
-					bMOTOR_LATCH = 0;
+			// Another Step Done
+			if (fZLocalMicroStep) {
+				// Make sure SPI byte has been completely transmitted.
+				while (!SSPSTATbits.BF)
+					;
+				// Now send out second byte for phase A coil which ends up in U4
+				// Then increment or decrement pointer
+	  			// to set up for next table entry while Phase A is being shifted out.
+				if (fZDirectionCmd ^ fMZInvertDirMotor) {
+					SSPBUF = MicroStepATableBkwd[PhaseAIndex];  		// Get second Byte
+					--PhaseAIndex;
 				}
-				else 
-	       			bMZStepMotor = 0 ^ fMZInvertedStepPulse; // Finish step pulse.
+				else {
+					SSPBUF = MicroStepATableFwd[PhaseAIndex];  		// Get second Byte
+					++PhaseAIndex;
+				}
+				// wrap it.
+				PhaseAIndex &= MSTEPTABLEMASK;
+
+				// Should be done sending via 10Mhz SPI but check anyway.
+				while (!SSPSTATbits.BF)
+					;
+				// Transfer data from serial shift register to parallel outputs
+				// on 74HC595.
+				bMOTOR_LATCH = 1;
+				fStepHappened = 1;	// Tell world a step occurred.
+				bMOTOR_LATCH = 0;
+			}
+			else
+       			bMZStepMotor = 0 ^ fMZInvertedStepPulse; // Finish step pulse.
 #else
-	       			bMZStepMotor = 0 ^ fMZInvertedStepPulse; // Finish step pulse.	       			
+       			bMZStepMotor = 0 ^ fMZInvertedStepPulse; // Finish step pulse.
 #endif
 
 #ifdef TAPERING
-				if (fTapering) {
-		   			bMXStepMotor = 0 ^ fMXInvertedStepPulse; // Finish step pulse.
+			if (fTapering) {
+	   			bMXStepMotor = 0 ^ fMXInvertedStepPulse; // Finish step pulse.
+			}
+#endif
+#ifdef THREAD_PULL_OUT
+			if (fPullingOut) {
+	   			bMXStepMotor = 0 ^ fMXInvertedStepPulse; // Finish step pulse.
+			}
+#endif
+			if (fZMoveBSY) {	// We're doing a distance move rather than a jog.
+				// Check if we're trying to move off a limit switch or accidentally ran into it.
+				if (fUseLimits && (bLIMIT_Switch ^ fLimitSwitch)) {
+					ZStepCount = 0;
+					ZEncoderCounter = 0;	// Trash any MPG counts
+					fZMoveRQ = 0;
+					fZMoveBSY = 0;
+					SystemError = MSG_LIMIT_INPUT_ACTIVE;
 				}
-#endif	
-				if (fZMoveBSY) {	// We're doing a distance move rather than a jog.
-					// Check if we're trying to move off a limit switch or accidentally ran into it.
-					if (fUseLimits && (bLIMIT_Switch ^ fLimitSwitch)) {
-						ZStepCount = 0;
-						ZEncoderCounter = 0;	// Trash any MPG counts
-						fZMoveRQ = 0;
-						fZMoveBSY = 0;
-						SystemError = MSG_LIMIT_INPUT_ACTIVE;
-					}
-					if (ZStepCount-- <= StepsToZVel) {
-						StepsToZVel = -1;	// Cancel this so we only do it once.
-						MaxZVel = 0; 		// Start decelerating down to 0.
-						fZDeccel = 1;
-						fZUpToSpeed = 1;		// Fake out up to speed even if we're deccelerating
-											// before we reach it.
-						// Turn off automatic tracking of spindle speed.
-						fThreading = 0;
-						MotorState = MOTOR_STOPPED;	
+#ifdef THREAD_PULL_OUT
+				// Start pulling X out.  Setting the direction now gives it a step to settle.
+				if (fPullOutArmed && (ZStepCount <= ZPullOutSteps)) {
+					fPullOutArmed = 0;
+					fPullingOut = 1;
+					TAccumulator = 0;
+					bMXDirectionMotor = fPullOutDir ^ fMXInvertDirMotor;
+					fXDirection = fPullOutDir ^ fMXInvertDirMotor;	// So the retract after has no backlash.
+					XBackLashCount = PullOutBacklash;				// The infeed went the other way.
+				}
+#endif
+				if (ZStepCount-- <= StepsToZVel) {
+					StepsToZVel = -1;	// Cancel this so we only do it once.
+#ifdef MOTION_QUEUE
+					if (ZRampEnd != 0) {	// The next segment carries on so only slow down to its speed.
+						if (ZRampTop > ZRampEnd) {
+							ZRampTop = ZRampEnd;
+							ZTopPeriod = (uint32)ZRampTable[ZRampEnd - 1] << STEP_FRACTION_BITS;
+						}
 					}
-					else if (ZStepCount <= 0) {
-						ZVel = 0;
-						MaxZVel = 0;		// Now stop.
-						Zholder = 0;		// And don't come back in until new MaxVel set.
-						// Turn off automatic tracking of spindle speed.
-						fThreading = 0;
-						MotorState = MOTOR_STOPPED;	
-						fZMoveBSY = 0;
+					else
+#endif
+					if (ZRampTop > 1) {	// Start decelerating down to the first ramp level.
+						ZRampTop = 1;	// It stops dead from there on its last step.
+						ZTopPeriod = (uint32)ZRampTable[0] << STEP_FRACTION_BITS;
 					}
+					fZDeccel = 1;
+					fZUpToSpeed = 1;		// Fake out up to speed even if we're deccelerating
+										// before we reach it.
+					// Turn off automatic tracking of spindle speed.
+					fThreading = 0;
+					MotorState = MOTOR_STOPPED;
 				}
-	
-				// Test whether time to decelerate to next velocity based on distance travelled.
-				if (!fZUpToSpeed) {  //  Up to speed?  
-					StepsToZVel++;	// No.  Keep counting steps.  Used for determining when to decelerate for fixed moves.
+#ifdef MOTION_QUEUE
+				else if ((ZStepCount <= 0) && (ZQueueTail != ZQueueHead) && (ZQueue[ZQueueTail].Sync == SEGMENT_FREE)) {
+					// Straight on into the next segment from whatever level this one got down to.
+					fZDirectionCmd = ZQueue[ZQueueTail].Dir;
+					ZStepCount = ZQueue[ZQueueTail].Steps;
+					StepsToZVel = ZQueue[ZQueueTail].DownSteps;
+					ZRampTop = ZQueue[ZQueueTail].Top;
+					ZTopPeriod = ZQueue[ZQueueTail].TopPeriod;
+					ZRampEnd = ZQueue[ZQueueTail].End;
+					ZQueueTail = (ZQueueTail + 1) & SEGMENT_QUEUE_MASK;
+					fZDeccel = (ZRampLevel > ZRampTop);
+					fZUpToSpeed = 0;
+					fZSCurve = 1;			// Planned so it knows where to slow down.
 				}
-	   		}
+#endif
+				else if (ZStepCount <= 0) {
+					MaxZVel = 0;		// Now stop.
+					ZStepPeriod = 0;	// And don't come back in until new MaxVel set.
+					ZRampLevel = 0;
+					ZRampTop = 0;
+					ZTopPeriod = 0;
+					// Turn off automatic tracking of spindle speed.
+					fThreading = 0;
+					fGearing = 0;
+#ifdef RATIONAL_GEARING
+					fPitchLock = 0;
+					fPitchLocked = 0;
+#endif
+#ifdef THREAD_PULL_OUT
+					PullOutFlags.Byte = 0;
+#endif
+					MotorState = MOTOR_STOPPED;
+					fZMoveBSY = 0;
+					fZAxisActive = 0;
+#ifdef MOTION_QUEUE
+					if (ZQueueTail != ZQueueHead) {	// A threading segment waits for the index.
+						fZDirectionCmd = ZQueue[ZQueueTail].Dir;
+						ZStepCount = ZQueue[ZQueueTail].Steps;
+						ZDecelSteps = ZQueue[ZQueueTail].DownSteps;
+						ZRampTop = ZQueue[ZQueueTail].Top;
+						ZTopPeriod = ZQueue[ZQueueTail].TopPeriod;
+						ZRampEnd = 0;
+						ZQueueTail = (ZQueueTail + 1) & SEGMENT_QUEUE_MASK;
+						fZSCurve = 1;
+						fThreading = 1;
+						ZStartPhase = 0;
+						fZMoveRQ = 1;
+					}
+#endif
+				}
+			}
+
+			// Test whether time to decelerate to next velocity based on distance travelled.
+			// An S-curve was given its deceleration point.
+			if (!fZUpToSpeed && !fZSCurve) {  //  Up to speed?
+				StepsToZVel++;	// No.  Keep counting steps.  Used for determining when to decelerate for fixed moves.
+			}
 		}
 
+		// Set up the compare for the next step.
+		if (!fZAxisActive || (ZStepPeriod == 0)) {
+			ZStepWait = 0;
+			PIE1bits.CCP1IE = 0;			// Stopped.  Pulse clock turns it back on.
+		}
+		else {
+			ZStepWait = ZStepPeriod - ZStepElapsed;
+			if (ZStepWait > STEP_WAIT_MAX)
+				ZStepWait = STEP_WAIT_MAX;
+			ZStepClock += ZStepWait;
+			CCPR1 = ZStepClock >> STEP_FRACTION_BITS;
+			// If another interrupt held us up past the new compare time then Timer1
+			// won't match it again for 6.5mS so step as soon as we can instead.
+			StepTimer = TMR1L;				// Read low byte first to latch the high byte.
+			StepTimer |= (uint16)TMR1H << 8;
+			if ((int16)(CCPR1 - StepTimer) < STEP_LEAD_MIN)
+				CCPR1 = StepTimer + STEP_LEAD_MIN;
+		}
+	}
+
 #ifdef X_AXIS_INTERRUPT
-		// MaxVel is the velocity set point.
-		if (fXAxisActive /*|| fXMoveBSY*/) {	// Jogging or programmed move.
-			if (fXDeccel) {
-				XVel -= XAcc;  //if we're decelerating, subtract the acceleration
-				if (XVel < MaxXVel) { 		// Don't allow velocity to go negative
-					fXDeccel = 0;			// We've reached our set point so no longer decelerating.
-					XVel = MaxXVel;			// In case we underflowed set it to the proper value.
-					if (XVel == 0) {		// Our velocity was zero and we've reached it.
-						fXAxisActive = 0;	// So motor isn't moving anymore.
-						fXMoveBSY = 0; 		// And if we were busy moving, we're not anymore.
+	/*
+		X axis step from ECCP1.  Same scheme as the Z axis.
+	*/
+	if (PIE2bits.ECCP1IE && PIR2bits.ECCP1IF) {
+		PIR2bits.ECCP1IF = 0;
+		XStepElapsed += XStepWait;
+
+		if ((XStepPeriod != 0) && (XStepElapsed >= XStepPeriod)) {
+			XStepElapsed -= XStepPeriod;
+			if (XStepElapsed >= XStepPeriod)
+				XStepElapsed = 0;
+
+			bMXDirectionMotor = fXDirection;	// Set direction.
+			bMXStepMotor = 1 ^ fMXInvertedStepPulse;  // STEP
+
+			if (--XBackLashCount < 0) {
+				if (fXDirection ^ fMXInvertDirMotor) {
+					XMotorRelPosition++;
+					XMotorIncrement++;		// External thread will track absolute position using this variable.
+
+				}
+				else {
+					XMotorRelPosition--;
+					XMotorIncrement--;		// External thread will track absolute position using this variable.
+				}
+				XBackLashCount = 0;
+	#ifdef TAPERING
+				// A steep taper steps Z off X.  The Z step code does Z's backlash, micro
+				// stepping and DRO the same as for an encoder line.
+				if (fTaperXMaster) {
+					TAccumulator += TaperTangent;
+					if (TAccumulator < TaperTangent) {
+						fZGearStep = 1;
+						PIR1bits.CCP1IF = 1;
+						PIE1bits.CCP1IE = 1;
 					}
 				}
-	   	 	}
-			else {
-				tempXvel = XVel+XAcc;
-	    		if( tempXvel <= MaxXVel ) // LT or EQ allows us to reach set point.
-					XVel = tempXvel;   // otherwise accelerate if need be.
-	        	else {
-					XVel = MaxXVel;  //  to clip to max veleocity
-					fXUpToSpeed = 1;
+	#endif
+			}
+			// Test whether time to decelerate to next velocity based on distance travelled.
+			if (!fXUpToSpeed && !fXSCurve)  //  Up to speed?
+				StepsToXVel++;	// No.  Keep counting steps.  Used for determining when to decelerate for fixed moves.
+
+
+			if (fXMoveBSY) {	// We're doing a distance move rather than a jog.
+				if (fUseLimits && (bLIMIT_Switch ^ fLimitSwitch)) {
+					XStepCount = 0;
+					ZEncoderCounter = 0;	// Trash any MPG counts
+					SystemError = MSG_LIMIT_INPUT_ACTIVE;
 				}
-	    	}
-			
-	    	Xholder += (XVel >> 16); // holder is the main Bresenham variable count, it rolls over 25000 when a pulse is necessary.
-	
-	    	if( Xholder >= PULSE_CLOCK_RATE ) { // pulse point = 25000hz.
-	
-				bMXDirectionMotor = fXDirection;	// Set direction.
-				bMXStepMotor = 1 ^ fMXInvertedStepPulse;  // STEP
-	
-	  
-				// Done test of 32 bits
-	        	Xholder -= PULSE_CLOCK_RATE;  // wait for next one;  //then subtract 25000 from the accumulator..
-		
-				if (--XBackLashCount < 0) {
-					if (fXDirection ^ fMXInvertDirMotor) {
-						XMotorRelPosition++; 
-						XMotorIncrement++;		// External thread will track absolute position using this variable.
+				if (XStepCount-- == StepsToXVel) {
+#ifdef MOTION_QUEUE
+					if (XRampEnd != 0) {	// Only slow down to the next segment's speed.
+						if (XRampTop > XRampEnd) {
+							XRampTop = XRampEnd;
+							XTopPeriod = (uint32)XRampTable[XRampEnd - 1] << STEP_FRACTION_BITS;
+						}
+					}
+					else
+#endif
+					if (XRampTop > 1) {	// Start decelerating down to the first ramp level.
+						XRampTop = 1;
+						XTopPeriod = (uint32)XRampTable[0] << STEP_FRACTION_BITS;
+					}
+					fXDeccel = 1;
+					fXUpToSpeed = 1;		// Fake out up to speed even if we're deccelerating
+											// before we reach it.
+				}
+#ifdef MOTION_QUEUE
+				else if ((XStepCount <= 0) && (XQueueTail != XQueueHead)) {
+					fXDirection = XQueue[XQueueTail].Dir;
+					XStepCount = XQueue[XQueueTail].Steps;
+					XBackLashCount = XQueue[XQueueTail].Backlash;
+					StepsToXVel = XQueue[XQueueTail].DownSteps;
+					XRampTop = XQueue[XQueueTail].Top;
+					XTopPeriod = XQueue[XQueueTail].TopPeriod;
+					XRampEnd = XQueue[XQueueTail].End;
+					XQueueTail = (XQueueTail + 1) & SEGMENT_QUEUE_MASK;
+					fXDeccel = (XRampLevel > XRampTop);
+					fXUpToSpeed = 0;
+					fXSCurve = 1;
+				}
+#endif
+				else if (XStepCount <= 0) {
+					MaxXVel = 0;		// Now stop.
+					XStepPeriod = 0;	// And don't come back in until new MaxVel set.
+					XRampLevel = 0;
+					XRampTop = 0;
+					XTopPeriod = 0;
+					fXMoveBSY = 0;
+					fXAxisActive = 0;
+#ifdef TAPERING
+					fTaperXMaster = 0;	// Z only follows the one move.
+#endif
+				}
+			}
+   			bMXStepMotor = 0 ^ fMXInvertedStepPulse; // Finish step pulse.
+		}
+
+		if (!fXAxisActive || (XStepPeriod == 0)) {
+			XStepWait = 0;
+			PIE2bits.ECCP1IE = 0;
+		}
+		else {
+			XStepWait = XStepPeriod - XStepElapsed;
+			if (XStepWait > STEP_WAIT_MAX)
+				XStepWait = STEP_WAIT_MAX;
+			XStepClock += XStepWait;
+			ECCPR1 = XStepClock >> STEP_FRACTION_BITS;
+			StepTimer = TMR1L;
+			StepTimer |= (uint16)TMR1H << 8;
+			if ((int16)(ECCPR1 - StepTimer) < STEP_LEAD_MIN)
+				ECCPR1 = StepTimer + STEP_LEAD_MIN;
+		}
+	}
+#endif
+
+	/*
+		20KHz Pulse clock from Timer2.
+	*/
+	if (PIE1bits.TMR2IE && PIR1bits.TMR2IF) {
+	    PIR1bits.TMR2IF = 0;
+
+		if (bESTOP ^ fEStop) {
+			SystemError = MSG_ESTOP_INPUT_ACTIVE;
+			// Kill any motion in progress so when ESTOP button is released motion doesn't restart.
+			// Z Axis (Lead Screw)
+			MaxZVel = 0;		// Clear out velocity.
+			fZAxisActive = 0;	// Disable Axis.
+			fZMoveBSY = 0;  	// No move in progress.
+			ZStepPeriod = 0;	// No more steps.
+			ZRampLevel = 0;
+			ZRampTop = 0;
+			PIE1bits.CCP1IE = 0;
+			// X Axis (Cross Slide)
+			MaxXVel = 0;		// Clear out velocity.
+			fXAxisActive = 0;	// Disable Axis.
+			fXMoveBSY = 0;  	// No move in progress.
+			XStepPeriod = 0;
+			XRampLevel = 0;
+			XRampTop = 0;
+			PIE2bits.ECCP1IE = 0;
+#ifdef TAPERING
+			fTaperXMaster = 0;
+#endif
+#ifdef CIRCULAR_INTERPOLATION
+			fArcing = 0;
+#endif
+#ifdef MOTION_QUEUE
+			ZQueueTail = ZQueueHead;	// Throw away the queued segments too.
+			XQueueTail = XQueueHead;
+#endif
+			// Now return which ends up also stopping charge pump output since the bit is never set.
+			// That should drop power off devices like Servo motors.
+			return;
+		}
 
+		// For motor drivers with simple enable lines we don't use a charge pump.
+		bCHARGE_Pump = 1;	// Also a good way to see approximately how long int32 interrupt routine takes.
+
+		// Now the velocity profile.  The steps themselves happen in the CCP1 code above so
+		// there's nothing to do here once the motor is running at a steady speed.
+		if (fZAxisActive && (fZDeccel || !fZUpToSpeed)) {	// Jogging or Programmed Move.
+			// Starting from a stop moves to the first level straight away.  After that, one
+			// level every ZRampTicks pulse clocks.
+			if ((ZRampLevel == 0) || (--ZRampCount == 0)) {
+				ZRampCount = ZRampTicks;
+				if (fZDeccel && (ZRampLevel > ZRampTop))
+					ZRampLevel--;
+				else if (ZRampLevel < ZRampTop)
+					ZRampLevel++;
+
+				if (ZRampLevel == ZRampTop) {	// Reached the set point.
+					ZStepPeriod = ZTopPeriod;
+					fZDeccel = 0;
+					fZUpToSpeed = 1;			// Stop counting distance to maximum speed.
+					if (ZRampTop == 0) {		// With the velocity now zero, there are
+						fZAxisActive = 0;		// no more steps so prevent access to this code now.
+						fZMoveBSY = 0;			// But do tell the world we've finished our move.
 					}
-					else {
-						XMotorRelPosition--;
-						XMotorIncrement--;		// External thread will track absolute position using this variable.
+				}
+				else
+					ZStepPeriod = (uint32)ZRampTable[ZRampLevel - 1] << STEP_FRACTION_BITS;
+
+				// Starting from a stop so set up Timer1 time and let the CCP1 code program the compare.
+				if (!PIE1bits.CCP1IE && (ZStepPeriod != 0)) {
+					StepTimer = TMR1L;
+					StepTimer |= (uint16)TMR1H << 8;
+					ZStepClock = (uint32)StepTimer << STEP_FRACTION_BITS;
+					ZStepElapsed = 0;
+					ZStepWait = 0;
+					PIR1bits.CCP1IF = 1;
+					PIE1bits.CCP1IE = 1;
+				}
+			}
+		}
+
+#ifdef X_AXIS_INTERRUPT
+		if (fXAxisActive && (fXDeccel || !fXUpToSpeed)) {	// Jogging or programmed move.
+			if ((XRampLevel == 0) || (--XRampCount == 0)) {
+				XRampCount = XRampTicks;
+				if (fXDeccel && (XRampLevel > XRampTop))
+					XRampLevel--;
+				else if (XRampLevel < XRampTop)
+					XRampLevel++;
+
+				if (XRampLevel == XRampTop) {	// Reached the set point.
+					XStepPeriod = XTopPeriod;
+					fXDeccel = 0;
+					fXUpToSpeed = 1;
+					if (XRampTop == 0) {		// Our velocity was zero and we've reached it.
+						fXAxisActive = 0;		// So motor isn't moving anymore.
+						fXMoveBSY = 0; 			// And if we were busy moving, we're not anymore.
 					}
-					XBackLashCount = 0;
-				}				
-				// Test whether time to decelerate to next velocity based on distance travelled.
-				if (!fXUpToSpeed)  //  Up to speed?  
-					StepsToXVel++;	// No.  Keep counting steps.  Used for determining when to decelerate for fixed moves.
-	
-				
-				if (fXMoveBSY) {	// We're doing a distance move rather than a jog.
-					if (fUseLimits && (bLIMIT_Switch ^ fLimitSwitch)) {
-						XStepCount = 0;
-						ZEncoderCounter = 0;	// Trash any MPG counts
-						SystemError = MSG_LIMIT_INPUT_ACTIVE;
+				}
+				else
+					XStepPeriod = (uint32)XRampTable[XRampLevel - 1] << STEP_FRACTION_BITS;
+
+				if (!PIE2bits.ECCP1IE && (XStepPeriod != 0)) {
+					StepTimer = TMR1L;
+					StepTimer |= (uint16)TMR1H << 8;
+					XStepClock = (uint32)StepTimer << STEP_FRACTION_BITS;
+					XStepElapsed = 0;
+					XStepWait = 0;
+					PIR2bits.ECCP1IF = 1;
+					PIE2bits.ECCP1IE = 1;
+				}
+			}
+		}
+#endif
+#ifdef CIRCULAR_INTERPOLATION
+		// Arc.  Take the next step once enough has been fed for its length.
+		if (fArcing) {
+			ArcDistance += ArcFeed;
+			if (ArcDistance >= ArcCost) {
+				ArcDistance -= ArcCost;
+				if ((ArcXLead != 0) || (ArcZLead != 0)) {	// Backlash first.  No DRO or arc.
+					if (ArcXLead != 0) {
+						ArcXLead--;
+						bMXDirectionMotor = fXDirection;
+						bMXStepMotor = 1 ^ fMXInvertedStepPulse;	// STEP
+					}
+					if (ArcZLead != 0) {
+						ArcZLead--;
+						fZGearStep = 1;			// The Z step code takes up its own backlash.
+						PIR1bits.CCP1IF = 1;
+						PIE1bits.CCP1IE = 1;
+					}
+				}
+				else {
+					if (ArcNext & ARC_X) {
+						bMXDirectionMotor = fXDirection;
+						bMXStepMotor = 1 ^ fMXInvertedStepPulse;	// STEP
+						if (fXDirection ^ fMXInvertDirMotor) {
+							XMotorRelPosition++;
+							XMotorIncrement++;
+						}
+						else {
+							XMotorRelPosition--;
+							XMotorIncrement--;
+						}
+						ArcError += ArcXTerm;
+						ArcXTerm += ArcXInc;
+						ArcXLeft--;
+					}
+					if (ArcNext & ARC_Z) {
+						fZGearStep = 1;
+						PIR1bits.CCP1IF = 1;
+						PIE1bits.CCP1IE = 1;
+						ArcError += ArcZTerm;
+						ArcZTerm += ArcZInc;
+						ArcZLeft--;
 					}
-					if (XStepCount-- == StepsToXVel) {
-						MaxXVel = 0; 		// Start decelerating down to 0.
-						fXDeccel = 1;
-						fXUpToSpeed = 1;		// Fake out up to speed even if we're deccelerating
-												// before we reach it.
+					// Pick the step that leaves the error nearest 0.  An axis that has got
+					// to the end doesn't step again.
+					ArcNext = 0;
+					if (ArcXLeft > 0) {
+						ArcBest = ArcError + ArcXTerm;
+						if (ArcBest < 0)
+							ArcBest = -ArcBest;
+						ArcNext = ARC_X;
+						ArcCost = ArcXCost;
 					}
-					else if (XStepCount <= 0) {
-						XVel = 0;
-						MaxXVel = 0;		// Now stop.
-						Xholder = 0;		// And don't come back in until new MaxVel set.
-						fXMoveBSY = 0;
+					if (ArcZLeft > 0) {
+						ArcTry = ArcError + ArcZTerm;
+						if (ArcTry < 0)
+							ArcTry = -ArcTry;
+						if ((ArcNext == 0) || (ArcTry < ArcBest)) {
+							ArcBest = ArcTry;
+							ArcNext = ARC_Z;
+							ArcCost = ArcZCost;
+						}
+						if (ArcXLeft > 0) {
+							ArcTry = ArcError + ArcXTerm + ArcZTerm;
+							if (ArcTry < 0)
+								ArcTry = -ArcTry;
+							if (ArcTry < ArcBest) {
+								ArcNext = ARC_X | ARC_Z;
+								ArcCost = ArcXZCost;
+							}
+						}
 					}
+					if (ArcNext == 0)
+						fArcing = 0;			// At the end.
 				}
 	   			bMXStepMotor = 0 ^ fMXInvertedStepPulse; // Finish step pulse.
-	   		}
+			}
+		}
+#endif
+#ifdef SPINDLE_CAPTURE
+		// Timer1 overflows make the top 16 bits of the spindle edge times.
+		if (PIR1bits.TMR1IF) {
+			PIR1bits.TMR1IF = 0;
+			Timer1High++;
 		}
 #endif
 		// We time in Pulse Clocks how long it takes for one revolution.
 		// The time is from rising edge to rising edge for a one slot per rev counter.
+		// With more slots each slot is timed and the revolution is the sum of the last
+		// SpindleSlots of them.
 		// New Levels need to be active for INDEX_DEBOUNCE pulse clocks before the state change
 		// is considered valid.  At 50uS per PULSE_CLOCK the default is 4 so noise glitches
 		// less than 200uS are ignored.
@@ -846,35 +1458,9 @@ __INTH(void) {
 			SpindleClockValue++;
 			if (bSPINDLE == 1) {
 				if (--IndexDebounce < 0) {
-					SpindleClocksPerRevolution = SpindleClockValue;
+					SlotPeriod = SpindleClockValue;
 					SpindleClockValue = INDEX_DEBOUNCE;
-					// Let Device Driver know there's a new RPM.
-					fUpdatedRPM = 1;
-					// And that we saw the sensor.
-					fSpindleInterrupt = 1;
-					fSpindleTurning = 1;
-#ifdef TRACK_SPINDLE_SPEED
-					// If there's a move in progress then track spindle.
-					if (fZMoveBSY) {						// If we've got a move going, calculate SpindCorrection
-						SpinCorrection = SpindleClocksPerRevolution - SpinRate;
-						if (SpinCorrection > SpinClip)
-							SpinCorrection = SpinClip;
-					}
-#endif
-					if ( fZMoveRQ ) {	   					// Always start threading at index pulse.
-						fZMoveRQ = 0;						
-						fZMoveBSY = 1;						// Ack Request	
-						fZAxisActive = 1;					// Allow Z axis movement.
-		
-#ifdef TRACK_SPINDLE_SPEED
-						SpinCorrection = 0;  SpinAdder = 0;	// Restart accumulators
-#endif
-						MaxZVel = NewZVel;					// NewVel is already shifted 16 bits.
-						fZDeccel = 0;
-						StepsToZVel = 0;		// Keep track of how far to get to velocity.
-						fZUpToSpeed = 0;
-						fZStopping = 0;
-					}
+					SpindleEdge = 1;			// Slot is timed below.
 					SpindleIntState = SPINDLE_INT_LEVEL_HI;
 				}
 			}
@@ -883,17 +1469,250 @@ __INTH(void) {
 			}
 			break;
 
+		  // INT0 times the edges.  Pulse clocks since the last one tell when the spindle stopped.
+		  case SPINDLE_INT_COUNTING :
+			if (++SpindleClockValue == 0)
+				SlotsFilled = -1;
+			break;
+
 			case SPINDLE_INT_NOT_TURNING :
 			break;
 		}
 	}
 
+#ifdef SPINDLE_CAPTURE
+	if (SpindleEdgeLatched) {		// Spindle Encoder Interrupt timed on the way in.
+#else
 	if (INTCONbits.INT0E && INTCONbits.INT0F) {		// Spindle Encoder Interrupt
+#endif
 		INTCONbits.INT0F = 0;
-		// Falling edge occurred.  Let State machine sort out RPM
-		INTCONbits.INT0E = 0;
-		SpindleIntState = SPINDLE_INT_LEVEL_HI;
+		if (SpindleLines > 1) {
+			// Encoder line.  INT0 stays enabled and the lines are counted into revolutions.
+			if (fGearing && fZMoveBSY) {
+				GearAccumulator += GearNumerator;
+				if (GearAccumulator >= GearDenominator) {
+					GearAccumulator -= GearDenominator;
+					if ((ZTopPeriod != 0) || (GearOwed < 0))
+						GearOwed++;					// Still ramping on, or Z got ahead.
+					else {
+						fZGearStep = 1;
+						PIR1bits.CCP1IF = 1;		// Step on the way out of here.
+						PIE1bits.CCP1IE = 1;
+					}
+				}
+			}
+			if (++EncoderCount >= SpindleLines) {
+				EncoderCount = 0;
+#ifdef SPINDLE_CAPTURE
+				SlotPeriod = (SpindleTime - SpindleEdgeTime) >> SPINDLE_CLOCK_SHIFT;
+				SpindleEdgeTime = SpindleTime;
+#else
+				SlotPeriod = SpindleClockValue;
+#endif
+				SpindleClockValue = 0;
+				SpindleEdge = 1;
+			}
+		}
+		else {
+#ifdef SPINDLE_CAPTURE
+			// Falling edge of a slot.  INT0 stays enabled.  An edge that comes too soon after
+			// the last one or doesn't leave the input low is noise.
+			SlotPeriod = (SpindleTime - SpindleEdgeTime) >> SPINDLE_CLOCK_SHIFT;
+			if ((bSPINDLE == 0) && ((SlotPeriod >= SpindleEdgeMin) || (SlotsFilled < 0))) {
+				SpindleEdgeTime = SpindleTime;
+				SpindleEdgeMin = SlotPeriod >> 2;
+				if ((SpindleEdgeMin < SPINDLE_EDGE_MIN) || (SlotsFilled < 0))	// First one isn't a whole slot.
+					SpindleEdgeMin = SPINDLE_EDGE_MIN;
+				SpindleClockValue = 0;
+				SpindleEdge = 1;
+			}
+#else
+			// Falling edge occurred.  Let State machine sort out RPM
+			INTCONbits.INT0E = 0;
+			SpindleIntState = SPINDLE_INT_LEVEL_HI;
+			// Spindle was stopped so the slot times are stale.  SlotCount carries on so the
+			// index stays on the same slot.
+			SlotsFilled = -1;
+#endif
+		}
+	}
+
+	/*
+		A slot or a revolution of encoder lines went by in SlotPeriod spindle clocks.
+	*/
+	if (SpindleEdge) {
+		SpindleEdge = 0;
+		// The slot after the missing one is the index.  It's the one that's over 5/4 of the
+		// average slot once a revolution has been timed.
+		SpindleGap = (SpindleSlots > 1) && (SlotsFilled >= (int8)SpindleSlots)
+						&& (SlotPeriod * SpindleSlots > SpindleRevClocks + (SpindleRevClocks >> 2));
+		if (SlotsFilled < 0) {					// First edge since the spindle started.
+			SlotsFilled = 0;
+			SpindleRevClocks = 0;
+			SpindleClocksPerRevolution = SlotPeriod;	// MotorDevice throws this one away.
+		}
+		else if (SlotsFilled < SpindleSlots) {	// Less than a revolution so far.
+			SlotClocks[SlotCount] = SlotPeriod;
+			SpindleRevClocks += SlotPeriod;
+			SlotsFilled++;
+			SpindleClocksPerRevolution = SlotPeriod * SpindleSlots;
+		}
+		else {
+			SpindleRevClocks += SlotPeriod - SlotClocks[SlotCount];
+			SlotClocks[SlotCount] = SlotPeriod;
+			SpindleClocksPerRevolution = SpindleRevClocks;
+		}
+		if (++SlotCount >= SpindleSlots)
+			SlotCount = 0;						// Next slot is the index again.
+		if (SpindleGap) {						// Back on the index after a missed or extra edge.
+			SlotCount = 0;
+			fSpindleIndexed = 1;
+			IndexMisses = 0;
+		}
+		else if ((SlotCount == 0) && (SpindleSlots > 1)) {
+			fSpindleIndexed = 0;				// Counted round but no gap.  Not sure where we are.
+			if (IndexMisses < 0xFF)
+				IndexMisses++;
+		}
+#ifdef THREAD_PHASE_START
+		IndexPhase = (SlotCount == 0) ? 0 : IndexPhase + SlotPeriod;
+#endif
 
+		// Let Device Driver know there's a new RPM and how many it missed.
+		fUpdatedRPM = 1;
+		if (SpindleUpdates < 0xFF)
+			SpindleUpdates++;
+		// And that we saw the sensor.
+		fSpindleInterrupt = 1;
+		fSpindleTurning = 1;
+#ifdef TRACK_SPINDLE_SPEED
+		// If there's a move in progress then track spindle.
+		if (fZMoveBSY) {						// If we've got a move going, calculate SpindCorrection
+			// Head for the new spindle period but no more than SpinSlew at a time.
+			SpinTarget = SpindleClocksPerRevolution - SpinRate;
+			if (SpinTarget > SpinClip) {
+				SpinTarget = SpinClip;
+				TrackClipped++;
+			}
+			else if (SpinTarget < SpinFloor) {
+				SpinTarget = SpinFloor;
+				TrackClipped++;
+			}
+			if (SpinTarget > SpinCorrection + SpinSlew) {
+				SpinCorrection += SpinSlew;
+				TrackSlewed++;
+			}
+			else if (SpinTarget < SpinCorrection - SpinSlew) {
+				SpinCorrection -= SpinSlew;
+				TrackSlewed++;
+			}
+			else
+				SpinCorrection = SpinTarget;
+			TrackUpdates++;
+			if (fThreading && fZUpToSpeed) {	// The range that was applied.
+				if (SpinCorrection > TrackCorrMax)
+					TrackCorrMax = SpinCorrection;
+				else if (SpinCorrection < TrackCorrMin)
+					TrackCorrMin = SpinCorrection;
+			}
+#ifdef RATIONAL_GEARING
+			// Each revolution up to speed owes the exact steps per rev.  The first one only
+			// marks where the counting starts.
+			if (fPitchLock && fThreading && fZUpToSpeed && (SlotCount == 0)) {
+				if (fPitchLocked) {
+					PitchError += GearNumerator;
+					if (PitchError > TrackPitchMax)
+						TrackPitchMax = PitchError;
+					else if (-PitchError > TrackPitchMax)
+						TrackPitchMax = -PitchError;
+					if (PitchError > PitchClip)
+						PitchCorrection = (PitchClip * (int32)ZPeriodPerPitch) >> TRACK_FRACTION_BITS;
+					else if (PitchError < -PitchClip)
+						PitchCorrection = -((PitchClip * (int32)ZPeriodPerPitch) >> TRACK_FRACTION_BITS);
+					else
+						PitchCorrection = (PitchError * (int32)ZPeriodPerPitch) >> TRACK_FRACTION_BITS;
+				}
+				else {
+					PitchError = 0;
+					PitchCorrection = 0;
+					fPitchLocked = 1;
+				}
+			}
+			// Once up to speed stretch or shrink the step period by the amount the
+			// spindle period changed since the start of threading and shorten it
+			// for steps still owed.
+			if (fThreading && fZUpToSpeed)
+				ZStepPeriod = ZCruisePeriod + ((SpinCorrection * (int32)ZPeriodPerClock) >> TRACK_FRACTION_BITS)
+								- PitchCorrection;
+#else
+			// Once up to speed stretch or shrink the step period by the amount the
+			// spindle period changed since the start of threading.
+			if (fThreading && fZUpToSpeed)
+				ZStepPeriod = ZCruisePeriod + ((SpinCorrection * (int32)ZPeriodPerClock) >> TRACK_FRACTION_BITS);
+#endif
+		}
+#endif
+		if (fZMoveRQ && (SlotCount == 0) && (ZStartPhase == 0)		// Start threading at index pulse.
+				&& (fSpindleIndexed || !fXThreading))
+			ZStart = 1;
+	}
+
+	/*
+		Start a requested Z move on the index or at ZStartPhase.
+	*/
+	if (fZMoveRQ) {
+#ifdef THREAD_PHASE_START
+		// A pass that doesn't start on the index waits for the spindle to come round to
+		// ZStartPhase.  The spindle has to be seen short of it first so a request made just
+		// after that phase waits for the next time round.
+		if ((ZStartPhase != 0) && (SlotsFilled >= (int8)SpindleSlots) && fSpindleIndexed) {
+#ifdef SPINDLE_CAPTURE
+			StepTimer = TMR1L;
+			StepTimer |= (uint16)TMR1H << 8;
+			PhaseNow = ((uint32)Timer1High << 16) | StepTimer;
+			if (PIR1bits.TMR1IF && !(StepTimer & 0x8000))
+				PhaseNow += 0x10000L;
+			PhaseNow = IndexPhase + ((PhaseNow - SpindleEdgeTime) >> SPINDLE_CLOCK_SHIFT);
+#else
+			PhaseNow = IndexPhase + SpindleClockValue;
+#endif
+			if (PhaseNow < ZStartPhase)
+				ZPhaseArmed = 1;
+			else if (ZPhaseArmed)
+				ZStart = 1;
+		}
+#endif
+		if (ZStart) {
+			ZStart = 0;
+			fZMoveRQ = 0;						
+			fZMoveBSY = 1;						// Ack Request	
+			fZAxisActive = 1;					// Allow Z axis movement.
+
+#ifdef TRACK_SPINDLE_SPEED
+			SpinCorrection = 0;					// Restart tracking
+			TrackUpdates = TrackSlewed = TrackClipped = 0;
+			TrackCorrMin = TrackCorrMax = 0;
+			TrackPitchMax = 0;
+#endif
+#ifdef RATIONAL_GEARING
+			fPitchLocked = 0;					// Counting starts once up to speed.
+#endif
+			MaxZVel = NewZVel;					// NewVel is already shifted 16 bits.
+			fZDeccel = 0;
+			fZStopping = 0;
+			if (fGearing) {
+				// Gearing counts from right on the line so every pass is in the same place on
+				// the thread.  Z ramps up and catches up to it.  It stops dead on its last step.
+				GearAccumulator = 0;
+				GearOwed = 0;
+				StepsToZVel = -1;
+				fZUpToSpeed = 0;
+			}
+			else {
+				StepsToZVel = ZDecelSteps;	// 0 keeps track of how far to get to velocity.
+				fZUpToSpeed = 0;
+			}
+		}
 	}
 
 	
@@ -954,6 +1773,7 @@ __INTH(void) {
 
 void __INTL(void);
 
+#ifndef HOST_BUILD
 #ifdef BOOTLOADER
 #pragma code low_vector=0x818
 #else
@@ -966,6 +1786,7 @@ interrupt_at_low_vector(void) {
 }
 
 #pragma code /* return to the default code section */
+#endif
 #pragma interruptlow __INTL
 /*
 	Low priority interrupt which deals with the serial port and the 10mS Thread timer to be
@@ -33,6 +33,10 @@
    	Initial Version: 0.00a
 
    	Version changes: 
+	1.11b	-- LCDShadow[] holds what's on the glass.  Characters that already match are
+			   skipped and the address is only set again where a changed run starts.
+	1.11c	-- LCDQueue[].  Characters and addresses are queued and CheckLCDDevice() sends
+			   one per pass of the main loop when the LCD isn't busy.  LCDFlush() waits.
 
 */
 
@@ -69,6 +73,19 @@
  *  are on PORTD, E is on RE2, R/W is on RE0,           
  *  RS is on RE1.  
  *                                                                      
+ *  Every character goes through LCDShadow[], a RAM copy of the display.
+ *  LCDCursor is where the next character is meant to go and LCDAddress
+ *  is where the LCD's own address counter is.  A character that's already
+ *  on the glass only moves LCDCursor so a screen rewritten with mostly the
+ *  same text costs one Set DD RAM Address per changed run.
+ *
+ *  What does have to go out is put in LCDQueue[].  A byte with bit 7 set
+ *  is a Set DD RAM Address command and anything else is a character.
+ *  CheckLCDDevice() is called from the main loop and sends one byte each
+ *  time through if the LCD isn't busy so nothing waits on the display.
+ *  LCDShadow[] and LCDAddress describe the display as it will be once the
+ *  queue is empty.  LCDFlush() empties it for code that has to wait.
+ *                                                                      
  * ********************************************************************* */
 
 BITS LCDStatus;
@@ -78,6 +95,13 @@ uint8 Pos_y;  // @
 
 uint8 LCDByte;
 
+uint8 LCDShadow[DISPLAY_SIZE];	// What's on the glass.  Line 0 then line 1.
+uint8 LCDCursor;				// DD RAM address the next character is for.
+uint8 LCDAddress;				// DD RAM address the LCD's address counter is at.
+
+uint8 LCDQueue[LCD_QUEUE_SIZE];	// Characters and addresses waiting for the LCD.
+uint8 LCDQueueFront, LCDQueueBack;
+
 uint8 LCDDataIndex;
 uint8 LCDCounter;
 puint8 pLCDBuffer;
@@ -105,8 +129,12 @@ const uint8 LCDInitData[LCD_INIT_BYTES] = {
 #define LCD_MAX_X2  0x40+LCD_MAX_X1
 
 int16 LCDBusy(void);   
-void LCDSendData(uint8 ch);
+void LCDWrite(uint8 ch, uint8 rs);
+void LCDQueueByte(uint8 ch);
 void LCDSendBackSpace(void);
+void LCDPutShadow(uint8 ch);
+void LCDPutChar(uint8 ch);
+void LCDSync(void);
 
 
 /*
@@ -138,32 +166,100 @@ LCDBusy(void) {
 }
 
 /*
- *  FUNCTION: LCDSendData
+ *  FUNCTION: LCDWrite
  *
- *  PARAMETERS:			ch -- Character to send to LCD
+ *  PARAMETERS:			ch -- Byte to send to LCD
+ *						rs -- 1 for a character, 0 for a command.
  *
  *  USES GLOBALS:	
  *
- *  DESCRIPTION:		Writes data byte to LCD.
+ *  DESCRIPTION:		Writes a byte to the LCD.  Doesn't wait for it to
+ *						finish so LCDBusy() has to be checked before the next.
  *
  *  RETURNS: 			Nothing.
  *
  */
 void 
-LCDSendData(uint8 ch) {
-	while (LCDBusy())
-		;
-    LCDDATA = ch & 0x7F;    // load LCDDATA with byte
-  	bLCD_RW = 0;            // send character to LCD
+LCDWrite(uint8 ch, uint8 rs) {
+    LCDDATA = ch;    		// load LCDDATA with byte
+  	bLCD_RW = 0;            // send byte to LCD
     Delay10TCYx(5);
-  	bLCD_RS = 1;
+  	bLCD_RS = rs;
     Delay10TCYx(5);
     bLCD_E = 1;
     Delay10TCYx(5);
     bLCD_E = 0;
-	Delay10TCYx(200);
-	while (LCDBusy())		// Update LCD Cursor position.
-		;
+}
+
+/*
+ *  FUNCTION: CheckLCDDevice
+ *
+ *  PARAMETERS:			None
+ *
+ *  USES GLOBALS:		LCDQueue, LCDQueueFront, LCDQueueBack, LCDState
+ *
+ *  DESCRIPTION:		Called from the main loop.  Sends the next queued byte
+ *						if there is one and the LCD isn't busy with the last.
+ *
+ *  RETURNS: 			Nothing.
+ *
+ */
+void 
+CheckLCDDevice(void) {
+  uint8 ch;
+	if ((LCDState == LCD_OUT) && !LCDBusy()) {
+		ch = LCDQueue[LCDQueueFront];
+		LCDQueueFront = (LCDQueueFront + 1) & LCD_QUEUE_MASK;
+		if (ch & 0x80)
+			LCDWrite(ch, 0);		// Set DD RAM address.
+		else
+			LCDWrite(ch, 1);		// Character.
+		if (LCDQueueFront == LCDQueueBack)
+			LCDState = LCD_RDY;
+	}
+}
+
+/*
+ *  FUNCTION: LCDQueueByte
+ *
+ *  PARAMETERS:			ch -- Character, or Set DD RAM Address if bit 7 is set.
+ *
+ *  USES GLOBALS:		LCDQueue, LCDQueueFront, LCDQueueBack, LCDState
+ *
+ *  DESCRIPTION:		Queues ch for CheckLCDDevice().  If the queue is full
+ *						it sends from the front until there's room.
+ *
+ *  RETURNS: 			Nothing.
+ *
+ */
+void 
+LCDQueueByte(uint8 ch) {
+  uint8 ndx;
+	ndx = (LCDQueueBack + 1) & LCD_QUEUE_MASK;
+	while (ndx == LCDQueueFront)	// Full so let the LCD catch up.
+		CheckLCDDevice();
+	LCDQueue[LCDQueueBack] = ch;
+	LCDQueueBack = ndx;
+	LCDState = LCD_OUT;
+}
+
+/*
+ *  FUNCTION: LCDFlush
+ *
+ *  PARAMETERS:			None
+ *
+ *  USES GLOBALS:		LCDState
+ *
+ *  DESCRIPTION:		Waits until everything queued is on the LCD.  For
+ *						code that won't be back to the main loop for a while.
+ *
+ *  RETURNS: 			Nothing.
+ *
+ */
+void 
+LCDFlush(void) {
+	while (LCDState != LCD_RDY)
+		CheckLCDDevice();
 }
 
 /*
@@ -171,9 +267,12 @@ LCDSendData(uint8 ch) {
  *
  *  PARAMETERS:			ch	-- What to send to Command Register
  *
- *  USES GLOBALS:
+ *  USES GLOBALS:		LCDAddress
  *
- *  DESCRIPTION:		This routine sends the command in byte to the LCD.
+ *  DESCRIPTION:		This routine sends the command in byte to the LCD
+ *						after anything queued and waits for it to finish.
+ *						Follows the address counter for Set DD RAM Address,
+ *						Clear Display and Return Home.
  *
  *  RETURNS: 			Nothing
  *
@@ -181,19 +280,38 @@ LCDSendData(uint8 ch) {
 void 
 LCDSendCmd(uint8 ch)
 {
+	LCDFlush();
 	while (LCDBusy())
 		;
-	LCDDATA = ch;          // load LCDDATA with byte
-    bLCD_RW = 0;            // send command byte to LCD
-    Delay10TCYx(5);
-    bLCD_RS = 0;
-    Delay10TCYx(5);
-    bLCD_E = 1;
-    Delay10TCYx(5);
-    bLCD_E = 0;
+	LCDWrite(ch, 0);		// send command byte to LCD
 	Delay10TCYx(200);
 	while (LCDBusy())		// Update LCD Cursor position.
 		;
+	if (ch & 0x80)
+		LCDAddress = ch & 0x7F;	// Set DD RAM address.
+	else if (ch < 0x04)
+		LCDAddress = 0;			// Clear Display or Return Home.
+}
+
+/*
+ *  FUNCTION: LCDSync
+ *
+ *  PARAMETERS:		None
+ *
+ *  USES GLOBALS:	LCDCursor, LCDAddress
+ *
+ *  DESCRIPTION:	Queues a move of the LCD's cursor to LCDCursor if skipped
+ *					characters left it somewhere else.
+ *
+ *  RETURNS: 		Nothing
+ *
+ */
+void
+LCDSync(void) {
+	if (LCDAddress != LCDCursor) {
+		LCDQueueByte(0x80 | LCDCursor);
+		LCDAddress = LCDCursor;
+	}
 }
 
 /*
@@ -201,7 +319,7 @@ LCDSendCmd(uint8 ch)
  *
  *  PARAMETERS:		X and Y position on LCD screen
  *
- *  USES GLOBALS:
+ *  USES GLOBALS:	LCDCursor
  *
  *  DESCRIPTION:	Sets the X,Y position for LCD.
  *
@@ -215,7 +333,8 @@ LCDSetPosition(uint8 x, uint8 y) {
     else 
         LCDByte = 0x80;   // Just command bit.
     LCDByte += x;
-    LCDSendCmd(LCDByte);     // Set DD ram address
+    LCDCursor = LCDByte & 0x7F;
+    LCDSync();     // Set DD ram address
  }
 
 
@@ -224,61 +343,98 @@ LCDSetPosition(uint8 x, uint8 y) {
  *
  *  PARAMETERS:			None
  *
- *  USES GLOBALS:
+ *  USES GLOBALS:		LCDCursor
  *
- *  DESCRIPTION:		Backspace LCD cursor one place.
+ *  DESCRIPTION:		Backspace LCD cursor one place.  The LCD itself
+ *						is moved by the next character or LCDSync().
  *
  *  RETURNS: 			Nothing
  *
  */
 void 
 LCDSendBackSpace(void) {
-	LCDStatus.Byte--;
-	if (LCDStatus.Byte >= 0x40) {
-		LCDSetPosition((LCDStatus.Byte - 0x40),1);
-	}
-	else {
-		if (LCDStatus.Byte > 19) 
-			LCDSetPosition(19,0);	
-		else if (LCDStatus.Byte == 0xFF) 
-			LCDSetPosition(0,0);
-		else
-			LCDSetPosition(LCDStatus.Byte, 0);
-	}
+	LCDCursor--;
+	if (LCDCursor == 0xFF) 
+		LCDCursor = 0;
+	else if ((LCDCursor > LCD_MAX_X1) && (LCDCursor < 0x40))
+		LCDCursor = LCD_MAX_X1;		// Back from line 1 to end of line 0.
 }
 
+/*
+ *  FUNCTION: LCDPutShadow
+ *
+ *  PARAMETERS:			ch 	-- character to send.
+ *
+ *  USES GLOBALS:		LCDShadow, LCDCursor, LCDAddress
+ *
+ *  DESCRIPTION:		Puts ch at LCDCursor.  Only queues it if it's not
+ *						already there and only sets the address first if the
+ *						LCD's address counter isn't already at LCDCursor.
+ *
+ *  RETURNS: 			Nothing
+ *
+ */
+void 
+LCDPutShadow(uint8 ch) {
+  uint8 i;
+	if (LCDCursor > LCD_MAX_X2)		// at end of screen
+		LCDCursor = 0;				// Home Position
+	else if ((LCDCursor > LCD_MAX_X1) && (LCDCursor < 0x40))	// next line
+		LCDCursor = 0x40;
+	i = LCDCursor;
+	if (i >= 0x40)
+		i -= 0x40 - DISPLAY_COLUMNS;
+	ch &= 0x7F;
+	if (LCDShadow[i] != ch) {
+		LCDSync();
+		LCDQueueByte(ch);
+		LCDAddress++;			// Display increments after each character.
+		LCDShadow[i] = ch;
+	}
+	LCDCursor++;
+}
 
 /*
- *  FUNCTION: LCDSendChar
+ *  FUNCTION: LCDPutChar
  *
  *  PARAMETERS:			ch 	-- character to send.
  *
  *  USES GLOBALS:
  *
- *  DESCRIPTION:		This routine sends the character in byte to the LCD.
+ *  DESCRIPTION:		Puts ch or a backspace through the shadow.
  *
  *  RETURNS: 			Nothing
  *
  */
 void 
-LCDSendChar(uint8 ch) {
-	while (LCDBusy())
-		;
-	
+LCDPutChar(uint8 ch) {
 	if (ch == '\b') {
 		LCDSendBackSpace();
-		LCDSendData(' ');
+		LCDPutShadow(' ');
 		LCDSendBackSpace();
 	}		
-	else {		 
-	    if  (LCDStatus.Byte > LCD_MAX_X2 ) {     // at end of screen
-    	    LCDSetPosition(0,0);   // Home Position
-	    }     
-    	else if ((LCDStatus.Byte > LCD_MAX_X1) && (LCDStatus.Byte < 40)) { // next line
-        	LCDSetPosition(0,1);
-	    };
-		LCDSendData(ch);
-	}
+	else
+		LCDPutShadow(ch);
+}
+
+
+/*
+ *  FUNCTION: LCDSendChar
+ *
+ *  PARAMETERS:			ch 	-- character to send.
+ *
+ *  USES GLOBALS:
+ *
+ *  DESCRIPTION:		This routine sends the character in byte to the LCD
+ *						and leaves the LCD's cursor after it.
+ *
+ *  RETURNS: 			Nothing
+ *
+ */
+void 
+LCDSendChar(uint8 ch) {
+	LCDPutChar(ch);
+	LCDSync();
 }
 
 
@@ -309,6 +465,7 @@ PositionCursor(int  MenuIndex) {
  *  USES GLOBALS:
  *
  *  DESCRIPTION:		Puts string to LCD and interprets ESC=RowCol sequence.
+ *						Only characters that changed are sent.
  *
  *  RETURNS: 
  *
@@ -316,8 +473,6 @@ PositionCursor(int  MenuIndex) {
 void 
 LCDSendBuf(puint8 pstr) {
 	while (*pstr) {  
-		while (LCDBusy())
-			; 
 		LCDByte = *pstr++;
         if (LCDByte) {    // All characters sent?
 			// Check for embedded commands
@@ -327,15 +482,15 @@ LCDSendBuf(puint8 pstr) {
 				pstr++;	// Past '='
 				Pos_y = *pstr++ - 0x20;
 				Pos_x = *pstr++ - 0x20;
-				LCDSetPosition(Pos_x, Pos_y); 
-				Delay10TCYx(50);
+				LCDCursor = (Pos_y == 1) ? 0x40 + Pos_x : Pos_x;	// Set when something changes.
 				break;
 			  default:
-				LCDSendChar(LCDByte);
+				LCDPutChar(LCDByte);
 				break;
 			}
         }
 	}
+	LCDSync();		// Leave the cursor at the end of the string.
 }
 
 /*
@@ -346,6 +501,7 @@ LCDSendBuf(puint8 pstr) {
  *  USES GLOBALS:
  *
  *  DESCRIPTION:		Puts ROM string to LCD interpretting ESC=RowCol
+ *						Only characters that changed are sent.
  *
  *  RETURNS: 
  *
@@ -353,8 +509,6 @@ LCDSendBuf(puint8 pstr) {
 void 
 LCDSendStr(const rom char * pstr) {
 	while (*pstr) {  
-		while (LCDBusy())
-			; 
 		LCDByte = *pstr++;
         if (LCDByte) {    // All characters sent?
 			// Check for embedded commands
@@ -364,15 +518,15 @@ LCDSendStr(const rom char * pstr) {
 				pstr++;	// Past '='
 				Pos_y = *pstr++ - 0x20;
 				Pos_x = *pstr++ - 0x20;
-				LCDSetPosition(Pos_x, Pos_y); 
-				Delay10TCYx(50);
+				LCDCursor = (Pos_y == 1) ? 0x40 + Pos_x : Pos_x;	// Set when something changes.
 				break;
 			  default:
-				LCDSendChar(LCDByte);
+				LCDPutChar(LCDByte);
 				break;
 			}
         }
 	}
+	LCDSync();		// Leave the cursor at the end of the string.
 }
 
 /*
@@ -389,11 +543,17 @@ LCDSendStr(const rom char * pstr) {
  */
 void 
 InitLCD(void) {
+	LCDQueueFront = LCDQueueBack = 0;
+	LCDState = LCD_RDY;
     for (LCDCounter = 0; LCDCounter < LCD_INIT_BYTES; LCDCounter++) { // Init Bytes.
     	LCDByte = LCDInitData[LCDCounter];
         LCDSendCmd(LCDByte);
 		 Delay10KTCYx(50);
 	}
+	// Display was cleared to spaces with the cursor home.
+    for (LCDCounter = 0; LCDCounter < DISPLAY_SIZE; LCDCounter++)
+		LCDShadow[LCDCounter] = ' ';
+	LCDCursor = 0;
     LCDSetPosition(0,0);
 	
 	LCDSendStr((const rom char *)pstrSignOn);
@@ -31,7 +31,8 @@
    	Initial Version: 0.00
 
    	Version changes:
- 
+	1.11d	-- SFixedToDec() for the run time display.
+	1.11e	-- MenuCache[] of formatted menu values.  Menu text copied with strcpy().
 	
 */			 
 
@@ -62,9 +63,57 @@
 TMENU_DATA CurrentMenu;
 signed int8 CurrentMenuNumber, LastMenuNumber;
 
+TMENU_CACHE MenuCache[MENU_CACHE_SIZE] = {0};	// Formatted values of recent menus.
+uint8 MenuCacheClock;					// Counts look ups for least recently used.
+
 
 /* ------------  Public Functions -------------*/
 
+/*
+ *  FUNCTION: MenuFloatToAscii
+ *
+ *  PARAMETERS:			menu				-- Menu the value is for.
+ *						fNumber				-- Number to convert
+ *						s					-- String destination
+ *						digits, fractions 	-- Number of places in string.
+ *
+ *  USES GLOBALS:		MenuCache, MenuCacheClock
+ *
+ *  DESCRIPTION: 		floatToAscii() through MenuCache.  If this menu last showed
+ *						exactly this value the string is copied from the cache.
+ *						Otherwise it's formatted into the least recently used entry.
+ *
+ *  RETURNS: 			Ascii formatted string of float.
+ *
+ */
+void
+MenuFloatToAscii(uint8 menu, float32 fNumber, int8 * s, int8 digits, int8 fractions) {
+  TMENU_CACHE * pCache;
+  uint32 value;
+  uint8 i, oldest;
+	value = *(uint32 *)&fNumber;		// ULONGFloat() is 64 bits on the host.
+	MenuCacheClock++;
+	oldest = 0;
+	for (i = 0; i < MENU_CACHE_SIZE; i++) {
+		pCache = &MenuCache[i];
+		if ((pCache->Menu == menu) && (pCache->Value == value)) {
+			pCache->Used = MenuCacheClock;
+			strcpy((int8 *)s, (const int8 *)pCache->Text);
+			return;
+		}
+		if ((uint8)(MenuCacheClock - pCache->Used) > (uint8)(MenuCacheClock - MenuCache[oldest].Used))
+			oldest = i;
+	}
+	floatToAscii(fNumber, s, digits, fractions);
+	if (strlen(s) < MENU_CACHE_TEXT) {		// Doesn't keep exponents of huge numbers.
+		pCache = &MenuCache[oldest];
+		pCache->Menu = menu;
+		pCache->Used = MenuCacheClock;
+		pCache->Value = value;
+		strcpy((int8 *)pCache->Text, (const int8 *)s);
+	}
+}
+
 /*
 	GetMenu();
 	Pull Menu Text from storage and format variable based on
@@ -121,7 +170,7 @@ GetMenu(uint8 menu, PTMENU_DATA pMenu, puint8 keybuf ) {
 	OutputBuffer[2] = 0x20;		// Line 0.
 	OutputBuffer[3] = 0x20;     // Column 0
 	// Put Text into buffer
-	sprintf(&OutputBuffer[4], (far rom int8 *)"%s", pMenu->Menubuf);
+	strcpy((int8 *)&OutputBuffer[4], (const int8 *)pMenu->Menubuf);
 	DEBUGSTR("%s\n",OutputBuffer);
 	// Then display Menu.
 	LCDSendBuf((puint8)OutputBuffer);
@@ -185,7 +234,7 @@ GetMenu(uint8 menu, PTMENU_DATA pMenu, puint8 keybuf ) {
 
 			pMenu->Data.FloatValue *= pMenu->Conversion;
 			flag_value = pMenu->ReadValue(pMenu);
-			floatToAscii(pMenu->Data.FloatValue, &OutputBuffer[4],fieldLength, fractions);
+			MenuFloatToAscii(menu, pMenu->Data.FloatValue, &OutputBuffer[4],fieldLength, fractions);
 			strcpy((int8 *)keybuf, (const int8 *)&OutputBuffer[4]);
 			OutputBuffer[4+fieldLength] = flag_value;
 			OutputBuffer[5+fieldLength] = 0;
@@ -218,7 +267,7 @@ GetMenu(uint8 menu, PTMENU_DATA pMenu, puint8 keybuf ) {
 			fieldLength = pMenu->Len & 0xf;
 			fractions = (pMenu->Len >> 4) & 0xf;
 			// Display ROM'd value which is already converted to display or entry format.
-			floatToAscii(listptr->Data, &OutputBuffer[13],fieldLength, fractions);
+			MenuFloatToAscii(menu, listptr->Data, &OutputBuffer[13],fieldLength, fractions);
 			// printf((far rom int8 *)"ListValue=%s\n", (int8 *)&OutputBuffer[13]);
 			break;
 
@@ -559,6 +608,54 @@ SLongToDec(int8 * pDecBuf, int32 decArg, uint8 len, uint8 zeros) {
 	SuLongToDec(pDecBuf, decArg, len, zeros);	
 }
 
+/*
+ *  FUNCTION: SFixedToDec
+ *
+ *  PARAMETERS:		pDecBuf		-- Pointer to output string
+ *					decArg		-- Value in units of the last digit shown.
+ *					len			-- Field Length
+ *					fractions	-- Digits after the decimal point.
+ *
+ *  USES GLOBALS:	DecPowers
+ *
+ *  DESCRIPTION:	Lays a fixed point number out the way floatToAscii() does: right
+ *					justified in len with the sign or a blank in front of the first
+ *					digit.  Digits are found by subtracting powers of ten so there's
+ *					no 32 bit division.
+ *
+ *  RETURNS: 		Null terminated buffer with converted value.
+ *
+ */
+const rom uint32 DecPowers[10] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+void 
+SFixedToDec(int8 * pDecBuf, int32 decArg, uint8 len, uint8 fractions) {
+  uint32 workingValue;
+  int8 digits[12];
+  int8 n, i, ch;
+	workingValue = (decArg < 0) ? -decArg : decArg;
+	n = 0;
+	for (i = 9; i >= 0; i--) {
+		ch = '0';
+		while (workingValue >= DecPowers[i]) {
+			workingValue -= DecPowers[i];
+			ch++;
+		}
+		if ((n != 0) || (ch != '0') || (i <= fractions))	// No zeros ahead of the units.
+			digits[n++] = ch;
+		if ((i == fractions) && (fractions != 0))
+			digits[n++] = '.';
+	}
+	for (i = n+1; i < len; i++) 	// Pad in front of the sign.
+		*pDecBuf++ = ' ';
+	*pDecBuf++ = (decArg < 0) ? '-' : ' ';
+	for (i = 0; i < n; i++) 
+		*pDecBuf++ = digits[i];
+	*pDecBuf = '\0'; 				// terminate string.
+}
+
 /*
  ** uIntToDec
  *
@@ -284,6 +284,7 @@ InitHardware(void) {
 		XDistanceDivisor = (float)GlobalVars[MOTOR_STEPS_REV_X_NDX].l / GlobalVars[CROSS_SLIDE_IPITCH_NDX].f;
 	else
 		XDistanceDivisor = 1.0;
+	SetupDisplayScale();
 
 	// Then the Run time display and Menu variables 
 	fRunTimeDisplay = 0;	// No run time display.
@@ -296,7 +297,7 @@ InitHardware(void) {
 	SystemCommand = NO_CMD;
 
 	INTCON = RTC_INTEN;		// Enable Interrupts.
-	PIE1bits.CCP1IE = 1;	// Start it up.
+	PIE1bits.TMR2IE = 1;	// Start the pulse clock.  It turns on the step compares as needed.
 }
 
 /*
@@ -461,16 +462,17 @@ static int32 spc;
   int32 tmp;
   static int32 oldmtrpos;
   int32 mtrZpos, mtrXpos;
-  float32 resZ, resX;
+  int32 dspZ, dspX;			// Positions in display digits.
   int8 FractionWidth;
   int16 mtrXIncr;
   int16 i;
   char sSpeed[4];
   char taperChar;
 
-	// If the Run Time Display is enabled and 250mS have elapsed then update the info
+	// If the Run Time Display is enabled and 100mS have elapsed then update the info
+	// Only the characters that changed go to the LCD so this is quick.
 	if 	(fRunTimeDisplay && TimerDone(RUNDISPLAY_TIMER)) {
-		StartTimer(RUNDISPLAY_TIMER, T_250MS);
+		StartTimer(RUNDISPLAY_TIMER, T_100MS);
 
 		// Set up to start at top left corner of LCD display.
 		OutputBuffer[0] = 0x1b;
@@ -503,13 +505,14 @@ static int32 spc;
 
 		// All display routines need distance in engineering units.
 		// Distances are stored as motor steps.
-		// The distance Divisors are calculated when the Thread or Turn button is pressed
-		// and are based on leadscrew and stepper motor values.
-		resZ = mtrZpos / ZDistanceDivisor;
-		resX = mtrXpos / XDistanceDivisor;
+		// The display scales are calculated with the distance divisors when the Thread or 
+		// Turn button is pressed and turn steps straight into digits without floating point.
+		if ((DisplayScaleMetric != fMetricMode) || (DisplayPitchIndex != MotionPitchIndex)
+				|| (DisplayPitchBits != GlobalVars[MotionPitchIndex].l))
+			SetupDisplayScale();	// Units or pitch changed since then.
+		dspZ = StepsToDisplay(mtrZpos, ZDisplayScale, ZDisplayShift);
+		dspX = StepsToDisplay(mtrXpos, XDisplayScale, XDisplayShift);
 		if (fMetricMode) {
-			resZ *= 25.4;
-			resX *= 25.4;
 			FractionWidth = 2;
 			strcpypgm2ram(sSpeed, (MEM_MODEL rom char *)"SMM");
 		}
@@ -535,7 +538,7 @@ static int32 spc;
 			SuLongToDec(&OutputBuffer[4], PrintRPM(0, fSFMMode), 5, 0);
 			OutputBuffer[9] = ' ';	// Get rid of terminating null;
 			// Then display Z Axis.
-			floatToAscii(resZ, &OutputBuffer[15],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[15], dspZ, 7, FractionWidth);
 			RunTimeUnits(22);
 
 			// Display Feed Pitch
@@ -544,12 +547,12 @@ static int32 spc;
 				sprintf(&OutputBuffer[24], (MEM_MODEL rom char *)"      TPI");
 				OutputBuffer[33] = ' ';
 				// Check if Thread pitch is <= 100 TPI and if so show to one decimal place
-				if (GlobalVars[MotionPitchIndex].f > 0.010) {  // Avoid divide by zero
-					floatToAscii(1/GlobalVars[MotionPitchIndex].f, &OutputBuffer[24],5,1);
+				if (DisplayTPI < 1000) {
+					SFixedToDec(&OutputBuffer[24], DisplayTPI, 5, 1);
 					OutputBuffer[29] = ' ';  // Get rid of terminating null.
 				}
 				else {	// otherwise don't show decimal and print one location to the right to line up with "TPI"
-					floatToAscii(1/GlobalVars[MotionPitchIndex].f, &OutputBuffer[25],4,0);
+					SFixedToDec(&OutputBuffer[25], (DisplayTPI + 5) / 10, 4, 0);
 					OutputBuffer[29] = ' ';  // Get rid of terminating null.
 				}
 			}
@@ -563,15 +566,13 @@ static int32 spc;
 				OutputBuffer[32] = ' ';
 
 				// Show value in format of metric or imperial mode.
+				// DisplayPitch is already in display digits so there's no floating point here.
 				if (fMetricMode) { // Metric mode has two digits after the decimal point and three i front..
-					floatToAscii(GlobalVars[MotionPitchIndex].f * 25.4, &OutputBuffer[25],6,FractionWidth);
+					SFixedToDec(&OutputBuffer[25], DisplayPitch, 6, FractionWidth);
 					RunTimeUnits(31);
 				}
 				else {	// Imperial mode has 3 digits after the decimal and only two in front.
-					if (GlobalVars[MotionPitchIndex].f < 100.0)
-						floatToAscii(GlobalVars[MotionPitchIndex].f, &OutputBuffer[25],7,FractionWidth);
-					else // Most of the time.....  8-(
-						floatToAscii(GlobalVars[MotionPitchIndex].f, &OutputBuffer[25],7,FractionWidth);
+					SFixedToDec(&OutputBuffer[25], DisplayPitch, 7, FractionWidth);
 					RunTimeUnits(32);
 				}
 //			}
@@ -586,7 +587,7 @@ static int32 spc;
 					OutputBuffer[24] = 'T';			// 'T'urning 
 			}
 			// Display X Axis
-			floatToAscii(resX, &OutputBuffer[35],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[35], dspX, 7, FractionWidth);
 			RunTimeUnits(42);
 
 			// Show which axis has MPG active.
@@ -617,7 +618,7 @@ static int32 spc;
 		  case INFO1_MODE:
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"SETPOINTS  Z 0.000  B  0.000   E 0.000  ");
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[16],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[16], dspZ, 7, FractionWidth);
 			RunTimeUnits(23);
 
 			// Display Start Position
@@ -632,7 +633,7 @@ static int32 spc;
 		  case INFO2_MODE:
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"SETPOINTS  X 0.000  B  0.000   R 0.000  ");
 			// Display Current Position
-			floatToAscii(resX, &OutputBuffer[16],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[16], dspX, 7, FractionWidth);
 			RunTimeUnits(23);
 
 			// Display Start Position
@@ -660,10 +661,10 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)" Finding Begin Pos. Z  0.000   X  0.000 ",
 				PassCount);
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[25],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[25], dspZ, 7, FractionWidth);
 			RunTimeUnits(32);
 			// Display X Axis
-			floatToAscii(resX, &OutputBuffer[36],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[36], dspX, 7, FractionWidth);
 			RunTimeUnits(43);
 			break;
 
@@ -700,10 +701,10 @@ static int32 spc;
 			else
 				sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"Turning to End Pos. Z 0.000    X  0.000 ");
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[25],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[25], dspZ, 7, FractionWidth);
 			RunTimeUnits(32);
 			// Display X Axis
-			floatToAscii(resX, &OutputBuffer[36],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[36], dspX, 7, FractionWidth);
 			RunTimeUnits(43);
 			break;
 
@@ -713,10 +714,10 @@ static int32 spc;
 			else				// otherwise show the cross feed value.
 				sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"Insert Tool in work Z  0.000   X  0.000 ");
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[25],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[25], dspZ, 7, FractionWidth);
 			RunTimeUnits(32);
 			// Display X Axis
-			floatToAscii(resX, &OutputBuffer[36],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[36], dspX, 7, FractionWidth);
 			RunTimeUnits(43);
 			break;
 
@@ -724,17 +725,17 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"Insert Tool [P=%2d]  Z  0.000   X  0.000 ",
 				PassCount);
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[25],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[25], dspZ, 7, FractionWidth);
 			RunTimeUnits(32);
 			// Display X Axis
-			floatToAscii(resX, &OutputBuffer[36],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[36], dspX, 7, FractionWidth);
 			RunTimeUnits(43);
 			break;
 
 		  case MSG_RETRACT_TOOL_RQ_MODE :
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"Retract Tool now         Z =   0.000\"   ");
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[33],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[33], dspZ, 7, FractionWidth);
 			RunTimeUnits(40);
 			break;
 
@@ -742,10 +743,10 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"Retracting Tool     Z  0.000   X  0.000 ",
 				PassCount);
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[25],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[25], dspZ, 7, FractionWidth);
 			RunTimeUnits(32);
 			// Display X Axis
-			floatToAscii(resX, &OutputBuffer[36],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[36], dspX, 7, FractionWidth);
 			RunTimeUnits(43);
 			break;
 
@@ -753,7 +754,7 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"ERROR!! Spindle Off 0000  RPM           ");
 			// Now calculate RPM.
 			if (AveragedClocksPerRev > 0) 
-				tmp = (PULSE_CLOCK_RATE * 60L) / AveragedClocksPerRev;
+				tmp = (SPINDLE_CLOCK_RATE * 60L) / AveragedClocksPerRev;
 			else
 				tmp = 0;
 	
@@ -774,10 +775,10 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"Sequence Complete   Z  0.000   X  0.000 ",
 				PassCount);
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[25],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[25], dspZ, 7, FractionWidth);
 			RunTimeUnits(32);
 			// Display X Axis
-			floatToAscii(resX, &OutputBuffer[36],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[36], dspX, 7, FractionWidth);
 			RunTimeUnits(43);
 			break;
 
@@ -785,10 +786,10 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"USER STOPPED MOTOR! Z  0.000   X  0.000 ",
 				PassCount);
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[25],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[25], dspZ, 7, FractionWidth);
 			RunTimeUnits(32);
 			// Display X Axis
-			floatToAscii(resX, &OutputBuffer[36],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[36], dspX, 7, FractionWidth);
 			RunTimeUnits(43);
 			break;
 
@@ -796,7 +797,7 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"SPINDLE TOO FAST    0000 RPM.  TRY 0000");
 			// Now calculate RPM.
 			if (AveragedClocksPerRev > 0) 
-				tmp = (PULSE_CLOCK_RATE * 60L) / AveragedClocksPerRev;
+				tmp = (SPINDLE_CLOCK_RATE * 60L) / AveragedClocksPerRev;
 			else
 				tmp = 0;
 	
@@ -818,6 +819,14 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"TAPER TOO BIG ERROR    MAX              ");
 			break;
 
+		  case MSG_SPINDLE_INDEX_ERROR :
+			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"NO SPINDLE INDEX    LEAVE OUT ONE SLOT  ");
+			break;
+
+		  case MSG_AREA_PASSES_ERROR :
+			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"TOO MANY AREA PASSESDEEPEN FIRST PASS   ");
+			break;
+
 		  case MSG_CHANGE_JOG_DISTANCE_MODE :
 			if (ActiveMotor == MOTOR_Z)
 				sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"NEW JOG DSTZ -0.000 CNCL SELX       ACPT");
@@ -831,10 +840,20 @@ static int32 spc;
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"Begin Position same as End Position ERR.");
 			break;
 
+		  case MSG_FEED_HOLD_MODE :
+			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)" Feed Hold  START=GoZ  0.000   X  0.000 ");
+			// Display Current Position
+			SFixedToDec(&OutputBuffer[25], dspZ, 7, FractionWidth);
+			RunTimeUnits(32);
+			// Display X Axis
+			SFixedToDec(&OutputBuffer[36], dspX, 7, FractionWidth);
+			RunTimeUnits(43);
+			break;
+
 		  default :
 			sprintf(&OutputBuffer[4], (MEM_MODEL rom char *)"SETPOINTS Z  0.000  B  0.000\" E  0.000\" ");
 			// Display Current Position
-			floatToAscii(resZ, &OutputBuffer[15],7,FractionWidth);
+			SFixedToDec(&OutputBuffer[15], dspZ, 7, FractionWidth);
 			RunTimeUnits(22);
 			break;
 		}
@@ -864,6 +883,7 @@ SerialThread(void) {
 		*/
 		case 'e' :
 			#ifdef EEROM_MONITOR
+			LCDFlush();			// Monitor doesn't come back to the main loop till it's done.
 			EEROM_Monitor();
 			#endif
 			break;
@@ -914,7 +934,9 @@ SerialThread(void) {
 
 #ifdef TRACK_SPINDLE_SPEED
 		case 't' :	// Spindle Tracking variables.
-			printf((MEM_MODEL rom char *)"SpinRate\n",SpinRate);
+			printf((MEM_MODEL rom char *)"SpinRate=%ld, Floor=%ld, Clip=%ld, Slew=%ld\n",
+				SpinRate, SpinFloor, SpinClip, SpinSlew);
+			PrintTracking();	// For the last threading move.
 			break;
 #endif			
 
@@ -928,9 +950,8 @@ SerialThread(void) {
 			printf((MEM_MODEL rom char *)" SYS:%d, MV: %d \n", SystemState, MovementState); 
 			printf((MEM_MODEL rom char *)" ZStepFlg:%02X, XStepFlg:%02X \n", ZStepFlags.Byte, XStepFlags.Byte); 
 			printf((MEM_MODEL rom char *)" ActiveFlg:%02X\n",ActiveFlags.Byte); 
-			for (i=0;i<4; i++)
-				printf((MEM_MODEL MEM_MODEL rom char *)"%5ld, ", RPMAverage[i]);
-			printf((MEM_MODEL rom char *)"\n");
+			printf((MEM_MODEL rom char *)" Clocks:%ld, Est:%ld, Rate:%ld\n", LastSpindleClocks, 
+						AveragedClocksPerRev, (int32)SpindlePeriodRate);
 			break;
 		/*
 			'v', '?'
@@ -1004,6 +1025,7 @@ main(void) {
 		BeeperDevice();			// Make a beeping sound
 		KeyDevice();			// scan the keypad
 		MotorDevice();			// Monitor Motor movement.
+		CheckLCDDevice();		// Send the next queued character to the LCD.
 
 #ifndef HALF_NUT_INSTALLED 
 		SpindleDevice();
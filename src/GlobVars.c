@@ -119,7 +119,14 @@ rom float32 GlobalMinimums[GLOBAL_VAR_SIZE] = {
 	0.0,	//  CUSTOM_TAPER3_NDX			FLOAT_TYPE Taper in inches per inch.
 	0.0,	//  CUSTOM_TAPER4_NDX			FLOAT_TYPE Taper in inches per inch.
 	0.0,	//  X_DIAMETER					FLOAT_TYPE location of tool bit tip expressed as diameter
-	0.0		//  DEPTH_MULTIPLIER_NDX		FLOAT_TYPE Used to calculate thread depth from pitch.
+	0.0,	//  DEPTH_MULTIPLIER_NDX		FLOAT_TYPE Used to calculate thread depth from pitch.
+	0.0,	//	JERK_RATE_Z_NDX				LONG_TYPE
+	0.0,	//	JERK_RATE_X_NDX				LONG_TYPE
+	0.0,	//	CLEARANCE_X_NDX				FLOAT_TYPE X distance off the cut before Z may move.
+	0.0,	//	BALL_RADIUS_NDX				FLOAT_TYPE Radius of a ball turned in passes.
+	1.0,	//	THREAD_STARTS_NDX			uint8_TYPE Number of starts.
+	0.0,	//	PULL_OUT_LEADS_NDX			FLOAT_TYPE Leads from the end X pulls out over.
+	1.0		//	PULL_OUT_ANGLE_NDX			FLOAT_TYPE Degrees off the thread axis X pulls out at.
 };
 
 // Global Maximum values tested when a user enters data. 
@@ -164,7 +171,14 @@ rom float32 GlobalMaximums[GLOBAL_VAR_SIZE] = {
 	0.0,		//  CUSTOM_TAPER3_NDX			FLOAT_TYPE Taper in inches per inch.
 	0.0,		//  CUSTOM_TAPER4_NDX			FLOAT_TYPE Taper in inches per inch.
 	0.0,		//  X_DIAMETER					FLOAT_TYPE location of tool bit tip expressed as diameter
-	0.0		//  DEPTH_MULTIPLIER_NDX		FLOAT_TYPE Used to calculate thread depth from pitch.
+	0.0,		//  DEPTH_MULTIPLIER_NDX		FLOAT_TYPE Used to calculate thread depth from pitch.
+	0.0,		//	JERK_RATE_Z_NDX				LONG_TYPE
+	0.0,		//	JERK_RATE_X_NDX				LONG_TYPE
+	1.0,		//	CLEARANCE_X_NDX				FLOAT_TYPE X distance off the cut before Z may move.
+	4.0,		//	BALL_RADIUS_NDX				FLOAT_TYPE Radius of a ball turned in passes.
+	16.0,		//	THREAD_STARTS_NDX			uint8_TYPE Number of starts.
+	4.0,		//	PULL_OUT_LEADS_NDX			FLOAT_TYPE Leads from the end X pulls out over.
+	89.0		//	PULL_OUT_ANGLE_NDX			FLOAT_TYPE Degrees off the thread axis X pulls out at.
 };
 
 int8 SystemError;
@@ -282,12 +296,10 @@ ReadFlags(void) {
 
 
 /*
-	Hardcode EEROM parameters to default values.  Called when user executes a specific key sequence.
+	Default values for all of the global array.  Nothing is saved.
 */
-void
-InitDefaultGlobalVars(void) {
-	int8 i;
-
+static void
+SetDefaultGlobalVars(void) {
 	GlobalVars[LEADSCREW_IPITCH_NDX].f 		=  1.0/10.0; 	// FLOAT_TYPE Leadscrew PITCH in INCHES
 	GlobalVars[ENCODER_LINES_NDX].l 		=  1; 		  	// WORD_TYPE
 	GlobalVars[SPINDLE_PULSE_REV_NDX].l 	=  1; 		  	// uint8_TYPE
@@ -330,10 +342,28 @@ InitDefaultGlobalVars(void) {
 	GlobalVars[CUSTOM_TAPER4_NDX].f			= 0.0;			// FLOAT_TYPE Taper in inches per inch.
 	GlobalVars[X_DIAMETER_NDX].f			= 0.0;			//  FLOAT_TYPE location of tool bit tip expressed as diameter
 	GlobalVars[DEPTH_MULTIPLIER_NDX].f		= 0.5413;		//  FLOAT_TYPE Used to calculate thread depth from pitch.
+	GlobalVars[JERK_RATE_Z_NDX].l			= 0;			// LONG_TYPE 0 is a linear ramp.  S-curve otherwise.
+	GlobalVars[JERK_RATE_X_NDX].l			= 0;			// LONG_TYPE
+	GlobalVars[CLEARANCE_X_NDX].f			= 0.020;		// FLOAT_TYPE 0 runs X and Z one after the other.
+	GlobalVars[BALL_RADIUS_NDX].f			= 0.0;			// FLOAT_TYPE 0 turns straight.
+	GlobalVars[THREAD_STARTS_NDX].l			= 1;			// uint8_TYPE Single start thread.
+	GlobalVars[PULL_OUT_LEADS_NDX].f		= 0.0;			// FLOAT_TYPE 0 stops Z at the end then retracts X.
+	GlobalVars[PULL_OUT_ANGLE_NDX].f		= 45.0;			// FLOAT_TYPE
+}
+
+/*
+	Hardcode EEROM parameters to default values.  Called when user executes a specific key sequence.
+*/
+void
+InitDefaultGlobalVars(void) {
+	int8 i;
+
+	SetDefaultGlobalVars();
 
 	// Now that they are initialized, save them to EEROM.
 	for (i=0; i<GLOBAL_VAR_SIZE; i++)
 		SaveGlobalVar(i);
+	Put_ObEEROM_Byte(EM_GLOBAL_COUNT, GLOBAL_VAR_SIZE);
 
 	// config.h
 	Put_ObEEROM_Byte(EM_SYS_FLAGS,0x0C);	// Default System flags.  See below
@@ -347,9 +377,24 @@ InitDefaultGlobalVars(void) {
 }
 
 
+/*
+	Pull the global array in from EEROM.  Globals added since the EEROM was last saved would be
+	erased EEROM, a NaN or -1, so they get their defaults and are saved.
+*/
 void 
 RestoreGlobalVariables(void) {
   int8 i;
-	for (i=0; i<GLOBAL_VAR_SIZE; i++) 
+  uint8 count;
+	count = Get_ObEEROM_Byte(EM_GLOBAL_COUNT);
+	if ((count < GLOBAL_VAR_SIZE_OLD) || (count > GLOBAL_VAR_SIZE))
+		count = GLOBAL_VAR_SIZE_OLD;		// Saved before EM_GLOBAL_COUNT.
+	if (count < GLOBAL_VAR_SIZE)
+		SetDefaultGlobalVars();
+	for (i=0; i<count; i++) 
 		LoadGlobalVar(i);
+	if (count < GLOBAL_VAR_SIZE) {
+		for (i=count; i<GLOBAL_VAR_SIZE; i++)
+			SaveGlobalVar(i);
+		Put_ObEEROM_Byte(EM_GLOBAL_COUNT, GLOBAL_VAR_SIZE);
+	}
 }
@@ -173,12 +173,13 @@ InitErrorKeyThread(void) {
  *						ZEndPosition
  *						ZEndPositionSteps
  *						XDistanceDivisor
+ *						ZDisplayScale, XDisplayScale
  *						XRetractedPosition
  *						XRetractedPositionSteps
  *						fExternalThreading
  *						fMovingRight, fMovingOut
  *						fTaperIn, fTaperDirection
- *						TaperTangent
+ *						TaperTangent, fTaperSteep
  */
 void 
 UpdateDistances(void) {
@@ -207,6 +208,7 @@ UpdateDistances(void) {
 		XDistanceDivisor = (float32)GlobalVars[MOTOR_STEPS_REV_X_NDX].l / GlobalVars[CROSS_SLIDE_IPITCH_NDX].f;
 	else
 		XDistanceDivisor = 1.0;
+	SetupDisplayScale();		// Steps to display digits for the run time display.
 	
 	XRetractedPosition = (fMetricMode) ? GetGlobalVarFloat(RETRACTED_X_NDX) * 25.4 : GetGlobalVarFloat(RETRACTED_X_NDX);
 	XRetractedPositionSteps = XDistanceToSteps(XRetractedPosition);
@@ -238,13 +240,14 @@ UpdateDistances(void) {
 			The only way around that would be to use toothed belts and pulleys to equalize the motion so the ratios
 			were the same between axis.  
 			The calculation below demonstrates how we handle the different ratios.
+			Past one X step per Z step it's turned round and Z is slaved to X instead.
 		*/
-		TaperTangent = ((temp * 65536.0) * (XDistanceDivisor / ZDistanceDivisor)+0.5);  // Round upwards.
-
-		if (TaperTangent > 0x10000) {
-			DEBUGSTR("ERROR:  Taper too large\n");
-			TaperTangent = 0x10000;				// Force to one X axis step per Z axis step.
-		}
+		temp = temp * (XDistanceDivisor / ZDistanceDivisor);	// X steps per Z step.
+		fTaperSteep = (temp > 1.0);
+		if (fTaperSteep)
+			temp = 1.0 / temp;									// Z steps per X step.
+		temp = temp * 4294967296.0 + 0.5;						// Round upwards.
+		TaperTangent = (temp >= 4294967295.0) ? 0xFFFFFFFF : (uint32)temp;
 
 #ifdef	FULL_DIAGNOSTICS	// Save some code space if we're not doing diagnostics.
 		floatToAscii(temp, OutputBuffer,7,5);
@@ -252,7 +255,7 @@ UpdateDistances(void) {
 
 		floatToAscii((XDistanceDivisor / ZDistanceDivisor), OutputBuffer,7,5);
 		DEBUGSTR(" With Division Ratio: %s\n",OutputBuffer);
-		DEBUGSTR("T=%ld, Move X ",TaperTangent);
+		DEBUGSTR("T=%lu, Move X ",TaperTangent);
 		if (fTaperInwards) 
 			DEBUGSTR("in");
 		else
@@ -262,6 +265,8 @@ UpdateDistances(void) {
 		DEBUGSTR("Taperflags=%02X",TaperFlags.Byte);
 #endif
  	}
+	else
+		fTaperSteep = 0;
 }
 
 /*
@@ -288,6 +293,7 @@ SetThreadingMode(void) {
 		fXThreading = 1;	// Set threading if we weren't.
 		SetCalculatePositionState(CALCULATE_PASSES);
 	}
+	fBallCutting = 0;
 	// Since a user may have been changing parameters, let's update all the run time parameters from
 	// our global data variables.  
 	// We don't update Z start or X start because we may have done a feed hold and the threading code
@@ -323,6 +329,7 @@ SetThreadingMode(void) {
  *						ZBeginPositionSteps
  *						XBeginPosition
  *						XBeginPositionSteps
+ *						fBallCutting			-- BALL_RADIUS_NDX set and X automatic.
  *						MotionPitchIndex		-- Show Turning pitch on display.
  */
 void
@@ -345,6 +352,17 @@ SetTurningMode(void) {
 	// our global data variables.
 	UpdateDistances();
 
+#ifdef CIRCULAR_INTERPOLATION
+	// A ball radius turns the pass into a quarter circle and takes it down in the threading passes.
+	// Only on an automatic X axis turning the outside of the work.
+	fBallCutting = ((GetGlobalVarFloat(BALL_RADIUS_NDX) > 0.0) && fAutoX && fExternalThreading) ? 1 : 0;
+	if (fBallCutting) {
+		SetCalculatePositionState(CALCULATE_PASSES);
+		CalculatePasses();
+		CalculateBallPosition();
+	}
+#endif
+
 	// Set up Jog table to Metric or Imperial just in case operator has changed units.
 	ChangeJogDistance(fMetricMode);
 	
@@ -460,6 +478,10 @@ RunKeyThread(void) {
 		 	switch( KeyValue & KEY_MASK ) {  // See if it's ours.
 		
 			  case KEY_STOP :	// Stop in middle of move if STOP key held down.
+#ifdef FEED_HOLD
+				if (MovementFeedHold() == 0)
+					break;			// Holding the thread instead.
+#endif
 				SystemCommand = STOP_CMD;
 				SystemError = MSG_MOTOR_STOPPED_ERROR;
 				MotorStop(MOTOR_Z);				// So stop motor
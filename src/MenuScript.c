@@ -33,6 +33,11 @@
    	Version changes:
 	03JAN09 jcd
 			Updated tapers to match Machinery Handbook.
+	1.11f
+			host/MenuCheck.c checks these tables.  Blank UNIT PARAMETERS soft keys went to
+			menu 0xFF, past the end of MenuData[]; they now go back to the setup menu like
+			every other blank key.  The imperial leadscrew and X axis pitch menus had
+			dependancies on the taper angle and X move rate menus instead of a flag.
 	
 */			 
 
@@ -151,7 +156,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	"Motor X Slew Rate                       ",
 	SLEW_RATE_X_NDX,   // Global Variable Array Index
 	0x0000,	 // Data
-	0,PULSE_CLOCK_RATE,
+	0,MAX_STEP_RATE,
 	LONG_TYPE,	 // Format
 	2,	 // Pos
 	7,	 // Len
@@ -197,7 +202,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	FLOAT_TYPE,	 // Format
 	6,	 // Pos
 	0x37,	 // Len
-	0x2E,   // Dependancy on Leadscrew Metric Flag
+	0,   // Not dependant since this menu is always imperial.
 	0,   // Units Position that uses Dependancy for which to display
 	1.0,  // Conversion Factor
 	ConvertToImperial,		// Write input value to EEROM as imperial units.
@@ -263,10 +268,10 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	"  Spindle Encoding            Pulses/Rev",
 	SPINDLE_PULSE_REV_NDX,   // Global Variable Array Index
 	1,	 // Data
-	1,1,
+	1,16,		// SPINDLE_SLOTS_MAX
 	BYTE_TYPE,	 // Format
 	6,	 // Pos
-	1,	 // Len
+	2,	 // Len
 	0,   // Dependancy
 	0,   // Units Position that uses Dependancy for which to display
 	1.0,  // Conversion Factor
@@ -302,9 +307,9 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	DoNothing
 	},
     { // 15 0x0F  Stored as pitch.
-	"     THREADING      TPI    PITCH  METRIC",
+	"     THREADING      TPI PITCH STRT METRC",
 	0,	 			// Global Variable Array Index
-	0x3D3B3B3C,   	// Links.
+	0x3D5B3B3C,   	// Links.
 	0,0,
 	MENU_TYPE,	 	// Format
 	0,	 // Pos
@@ -358,9 +363,9 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	DoNothing
 	},
     { // 19 0x13
-	"MOTOR Z MOVE RATE   SLEW DELAY      MOVE",
+	"MOTOR Z MOVE RATE   SLEW DELAY JERK MOVE",
 	0,   // Global Variable Array Index
-	0x15011B14,	 // Data
+	0x15571B14,	 // Data
 	0,0,
 	MENU_TYPE,	 // Format
 	2,	 // Pos
@@ -375,7 +380,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	"Motor Z Slew Rate                       ",
 	SLEW_RATE_Z_NDX,   // Global Variable Array Index
 	0x0000,	 // Data
-	0,PULSE_CLOCK_RATE,
+	0,MAX_STEP_RATE,
 	LONG_TYPE,	 // Format
 	2,	 // Pos
 	7,	 // Len
@@ -389,7 +394,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	"Motor Z Move Rate                       ",
 	MOVE_RATE_Z_NDX,   // Global Variable Array Index
 	0x0000,	 // Data
-	0,PULSE_CLOCK_RATE,
+	0,MAX_STEP_RATE,
 	LONG_TYPE,	 // Format
 	2,	 // Pos
 	7,	 // Len
@@ -501,7 +506,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	"Motor X Move Rate                       ",
 	MOVE_RATE_X_NDX,   // Global Variable Array Index
 	12000,	 // Data
-	0,PULSE_CLOCK_RATE,
+	0,MAX_STEP_RATE,
 	LONG_TYPE,	 // Format
 	1,	 // Pos
 	5,	 // Len
@@ -547,7 +552,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	FLOAT_TYPE,	 // Format
 	8,	 // Pos
 	0x37,	 // Len
-	0x31,   // Dependancy on X axis Metric Pitch Flag.
+	0,   // Not dependant since this menu is always imperial.
 	0,   // Units Position that uses Dependancy for which to display
 	1.0,  // Conversion Factor
 	ConvertToImperial,		// Write input value to EEROM as imperial units.
@@ -624,9 +629,9 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	ConvertToMetric
 	},
     { // 38 0x26
-	"X RUN PARAMETERS    POS  LOC         JOG",
+	"X RUN PARAMETERS    POS  LOC  BALL   JOG",
 	0,   // Global Variable Array Index
-	0x28015227,	 // Data
+	0x285A5227,	 // Data
 	0,0,
 	MENU_TYPE,	 // Format
 	8,	 // Pos
@@ -638,9 +643,9 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	DoNothing		// Read Steps from EEROM and make into distance.
 	},
     { // 39 0x27
-	"X BEGIN/END POS     BEGIN      RETRACTED",
+	"X BEGIN/END POS     BEGIN  CLR PULL RETR",
 	0,   // Global Variable Array Index
-	0x23010122,	 // Data
+	0x235E5922,	 // Data
 	0,0,
 	MENU_TYPE,	 // Format
 	2,	 // Pos
@@ -779,9 +784,9 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	DoNothing
 	},
     { // 49 0x31 
-	"MOTOR X MOVE RATE   SLEW            MOVE",
+	"MOTOR X MOVE RATE   SLEW       JERK MOVE",
 	0,   // Global Variable Array Index
-	0x1D010104,	 // Data
+	0x1D580104,	 // Data
 	0,0,
 	MENU_TYPE,	 // Format
 	2,	 // Pos
@@ -879,7 +884,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
     { // 56 0x38 
 	"  MORSE TAPER LIST                      ",
 	MORSE_TAPER_LIST_NDX,	 // Location in ROM list.
-	(long)MorseTaperList,	 // Address of ROM List.
+	MENU_LIST_ADDR(MorseTaperList),	 // Address of ROM List.
 	0,0,
 	LIST_TYPE,	 // Format is list of records that hold strings and floats
 	0,   		 // Pos where the string is put on LCD Display.
@@ -963,7 +968,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
     { // 62 0x3E
 	"USE COMPOUND FOR       THREADING IS     ",
 	0xFF,   		  // Global Variable Array Index Signal to use scroll feature.
-	0xFFFF2956,	 // Double linked list in first two bytes. [0] is next, [1] is previous.
+	0xFFFF295C,	 // Double linked list in first two bytes. [0] is next, [1] is previous.
 	0,0,
 	FLAG_TYPE,	 // Format
 	EM_XMOTOR_FLAGS,	 // Pos --> EEROM Location
@@ -1117,7 +1122,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
     { // 73 0x49 
 	" JACOB  TAPER LIST                      ",
 	JACOBS_TAPER_LIST_NDX,	 // Location in ROM list.
-	(long)JacobTaperList,	 // Address of ROM List.
+	MENU_LIST_ADDR(JacobTaperList),	 // Address of ROM List.
 	0,0,
 	LIST_TYPE,	 // Format is list of records that hold strings and floats
 	0,   		 // Pos where the string is put on LCD Display.
@@ -1131,7 +1136,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
     { // 74 0x4A 
 	"ASSORTED TAPER LIST                     ",
 	ASSORTED_TAPER_LIST_NDX,	 // Location in ROM list.
-	(long)AssortedTaperList,	 // Address of ROM List.
+	MENU_LIST_ADDR(AssortedTaperList),	 // Address of ROM List.
 	0,0,
 	LIST_TYPE,	 // Format is list of records that hold strings and floats
 	0,   		 // Pos where the string is put on LCD Display.
@@ -1215,7 +1220,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
     { // 80 0x50
 	"UNIT PARAMETERS     METRIC           SFM",
 	0, //METRIC_PITCH_NDX,   // Global Variable Array Index
-	0x51FFFF24,	 // Data
+	0x51010124,	 // Data
 	0,0,
 	MENU_TYPE,	 // Format
 	0,	 // Pos
@@ -1299,7 +1304,7 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
     { // 86 0x56
 	"BROACH MODE MOVEMENT IS                 ",
 	0xFF,   		  // Global Variable Array Index Signal to use scroll feature.
-	0xFFFF3E32,	 // Double linked list in first two bytes. [0] is next, [1] is previous.
+	0xFFFF5D32,	 // Double linked list in first two bytes. [0] is next, [1] is previous.
 	0,0,
 	FLAG_TYPE,	 // Format
 	EM_SYS_FLAGS,	 // Pos --> EEROM Location
@@ -1310,6 +1315,146 @@ rom TMENU_DATA MenuData[MENU_ITEMS] = {
 	DoNothing,
 	DoNothing
 	},
+    { // 87 0x57  0 is a linear ramp, otherwise an S-curve.
+	"Motor Z Jerk                            ",
+	JERK_RATE_Z_NDX,   // Global Variable Array Index
+	0,	 // Data
+	0,1000000,
+	LONG_TYPE,	 // Format
+	2,	 // Pos
+	7,	 // Len
+	0,   // Dependancy
+	0,   // Units Position that uses Dependancy for which to display
+	1.0,  // Conversion Factor
+	DoNothing,
+	DoNothing
+	},
+    { // 88 0x58  0 is a linear ramp, otherwise an S-curve.
+	"MOTOR X Jerk                            ",
+	JERK_RATE_X_NDX,   // Global Variable Array Index
+	0,	 // Data
+	0,1000000,
+	LONG_TYPE,	 // Format
+	2,	 // Pos
+	7,	 // Len
+	0,   // Dependancy
+	0,   // Units Position that uses Dependancy for which to display
+	1.0,  // Conversion Factor
+	DoNothing,
+	DoNothing
+	},
+    { // 89 0x59 X clear of the cut before Z returns, stored in floating point inches.  0 waits for X.
+	"Cross Slide Clearnc                     ",
+	CLEARANCE_X_NDX,   // Global Variable Array Index
+	0.020,	 // Data
+	0,0,
+	FLOAT_TYPE,	 // Format
+	8,	 // Pos
+	0x37,	 // Len
+	0x24,   // Dependancy
+	0,   // Units Position that uses Dependancy for which to display
+	1.0,  // Conversion Factor
+	ConvertToImperial,	// Convert and Store as inches if global Metric Mode.
+	ConvertToMetric		// Restore as Metric if Global Metric Mode	
+	},
+    { // 90 0x5A Radius of a ball cut by the turning cycle, stored in floating point inches.  0 turns straight.
+	"Ball Radius                             ",
+	BALL_RADIUS_NDX,   // Global Variable Array Index
+	0.0,	 // Data
+	0,0,
+	FLOAT_TYPE,	 // Format
+	8,	 // Pos
+	0x37,	 // Len
+	0x24,   // Dependancy
+	0,   // Units Position that uses Dependancy for which to display
+	1.0,  // Conversion Factor
+	ConvertToImperial,	// Convert and Store as inches if global Metric Mode.
+	ConvertToMetric		// Restore as Metric if Global Metric Mode	
+	},
+	{ // 91 0x5B Starts of a multi-start thread.  The pitch entered is the lead.
+	"Thread Starts                 Starts    ",
+	THREAD_STARTS_NDX,  // Global Variable Array Index
+	1,	 //Default value
+	1,16,
+	BYTE_TYPE,	 // Format
+	6,	 // Pos --> 
+	2,	 // Len --> Bit Position
+	0,   // Dependancy
+	0,   // Units Position that uses Dependancy for which to display
+	1.0,  // Conversion Factor
+	DoNothing,
+	DoNothing
+	},
+    { // 92 0x5C First pass depth sets the chip area every thread pass removes.
+	"CONSTANT AREA INFEEDFOR THREADS IS      ",
+	0xFF,   		  // Global Variable Array Index Signal to use scroll feature.
+	0xFFFF3E5D,	 // Double linked list in first two bytes. [0] is next, [1] is previous.
+	0,0,
+	FLAG_TYPE,	 // Format
+	EM_ZMOTOR_FLAGS,	 // Pos --> EEROM Location
+	fBITPOS_ConstantArea,	 // Len --> Bit Position
+	0,   // Dependancy
+	FLAG_XPOS,   // Where to put the Boolean FLAG TEXT.
+	1.0,  // Conversion Factor
+	DoNothing,
+	DoNothing
+	},
+    { // 93 0x5D THREAD BEGIN is where the thread starts.  Passes start back by the run-up.
+	"AUTO THREAD RUN-UP  IS                  ",
+	0xFF,   		  // Global Variable Array Index Signal to use scroll feature.
+	0xFFFF5C56,	 // Double linked list in first two bytes. [0] is next, [1] is previous.
+	0,0,
+	FLAG_TYPE,	 // Format
+	EM_ZMOTOR_FLAGS,	 // Pos --> EEROM Location
+	fBITPOS_RunUp,	 // Len --> Bit Position
+	0,   // Dependancy
+	FLAG_XPOS,   // Where to put the Boolean FLAG TEXT.
+	1.0,  // Conversion Factor
+	DoNothing,
+	DoNothing
+	},
+    { // 94 0x5E X pulls out along a chamfer at the end of each threading pass.
+	" THREAD PULL-OUT    LEADS ANGL          ",
+	0,   // Global Variable Array Index
+	0x0101605F,	 // Data
+	0,0,
+	MENU_TYPE,	 // Format
+	2,	 // Pos
+	6,	 // Len
+	0,   // Dependancy
+	0,   // Units Position that uses Dependancy for which to display
+	1.0,  // Conversion Factor
+	DoNothing,
+	DoNothing
+	},
+	{ // 95 0x5F Leads from the end of the thread X pulls out over.  0 stops Z first.
+	"Pull-out Length               Leads     ",
+	PULL_OUT_LEADS_NDX,  // Global Variable Array Index
+	0.0,	 //Default value
+	0,0,
+	FLOAT_TYPE,	 // Format
+	2,	 // Pos --> 
+	0x25,	 // Len --> Bit Position
+	0,   // Dependancy
+	0,   // Units Position that uses Dependancy for which to display
+	1.0,  // Conversion Factor
+	DoNothing,
+	DoNothing
+	},
+	{ // 96 0x60 Angle off the thread axis X pulls out at.
+	"Pull-out Angle                Degrees   ",
+	PULL_OUT_ANGLE_NDX,  // Global Variable Array Index
+	45.0,	 //Default value
+	0,0,
+	FLOAT_TYPE,	 // Format
+	2,	 // Pos --> 
+	0x15,	 // Len --> Bit Position
+	0,   // Dependancy
+	0,   // Units Position that uses Dependancy for which to display
+	1.0,  // Conversion Factor
+	DoNothing,
+	DoNothing
+	},
 };
 
 const rom TMENU_LIST MorseTaperList[NUMBER_OF_MORSE_TAPERS] = {
@@ -1551,6 +1696,8 @@ CalcImperialDepth( TMENU_DATA * p) {
 			);
 
 		p->Data.FloatValue = (GlobalVars[DEPTH_MULTIPLIER_NDX].f * GlobalVars[THREAD_SIZE_NDX].f);
+		if (GlobalVars[THREAD_STARTS_NDX].l > 1)	// Depth goes by the pitch, the lead over the starts.
+			p->Data.FloatValue /= GlobalVars[THREAD_STARTS_NDX].l;
 
 		// Then test the flag.
 		if (GetFlagVar(&d)) {	// If the metric flag is set convert the value to imperial.
@@ -1574,6 +1721,8 @@ CalcMetricDepth( TMENU_DATA * p) {
 			sizeof(TMENU_DATA)
 			);
 		p->Data.FloatValue = (GlobalVars[DEPTH_MULTIPLIER_NDX].f * GlobalVars[THREAD_SIZE_NDX].f);
+		if (GlobalVars[THREAD_STARTS_NDX].l > 1)	// Depth goes by the pitch, the lead over the starts.
+			p->Data.FloatValue /= GlobalVars[THREAD_STARTS_NDX].l;
 		// Then test the flag.
 		if (GetFlagVar(&d)) {	// If the metric flag is set convert the value to metric.
 			p->Data.FloatValue *= 25.4;
@@ -74,23 +74,75 @@ enum RPM_STATES RPMState = RPM_ZERO;
 int32 XStartMotorPosition;		// Each pass starts here.  Changed if auto depth enabled.
 volatile int32 XStepCount;		// Number of steps to move.
 
-volatile uint16 SpindleClocksPerRevolution;// Holds last accumulated number of Pulse Clocks per Rev.
+volatile uint32 SpindleClocksPerRevolution;// Holds last accumulated number of Spindle Clocks per Rev.
 float32 LeadScrewRatio;			// Calculated from Leadscrew Pitch, Motor Steps and Desired feed rate.
 
-// Running average counter array for Spindle RPM.
-int32 RPMAverage[16];
-static int8 RPMAverageIndex;
-int32 AveragedClocksPerRev;		// An average of the number of TICKs between spindle sensor interrupts.
+// Run time display scales.  Display digits (0.001" or 0.01mm) per motor step are
+// ZDisplayScale / 2^ZDisplayShift with the shift from 24 to 32.
+uint32 ZDisplayScale, XDisplayScale;
+uint8 ZDisplayShift, XDisplayShift;
+uint8 DisplayScaleMetric;		// fMetricMode the scales were set up for.
+int32 DisplayPitch;				// GlobalVars[MotionPitchIndex] in display digits.
+int32 DisplayTPI;				// and in tenths of a thread per inch.
+char DisplayPitchIndex;			// MotionPitchIndex they were set up for
+uint32 DisplayPitchBits;		// and the bits of its value then.
+
+// Alpha-beta estimate of the spindle period.
+static float32 SpindlePeriodEst;	// Filtered number of spindle clocks per rev.
+float32 SpindlePeriodRate;		// Change in clocks per rev from one spindle update to the next.
+int32 AveragedClocksPerRev;		// SpindlePeriodEst rounded.  The number of TICKs per spindle rev.
 int16 AverageRPM;
 int16 TargetRPM;
 int32 LastSpindleClocks;		// Holds the newest of TICKs between spindle sensor interrupt.
 
 /* --- Private Variables --- */
 float32 r,s;						// Temporary variables.
+static int32 ZRampAcc;				// Acceleration the linear ZRampTable was built for.  0 if none.
+static int32 XRampAcc;
+static int32 XDecelSteps;			// Steps an X S-curve needs to stop.  0 for a linear ramp.
+#ifdef THREAD_PHASE_START
+static int32 ZPhaseSteps;			// Steps Z was moved on along the thread for a phase start.
+static int32 ZPhaseAt;				// Where that left Z.
+#endif
+#ifdef FEED_HOLD
+static int32 ZHoldAt;				// Z on the helix when the pass was held.
+static float32 ZHoldRev;			// Fraction of a turn past the index the spindle was then.
+#endif
+
+// Acceleration and jerk globals to steps/sec/sec and steps/sec/sec/sec.
+#define ACCEL_SCALE		(PULSE_CLOCK_RATE / 65536.0)		// ZAcc is already << 5.
+#define JERK_SCALE		(32.0 * PULSE_CLOCK_RATE / 65536.0)
+
+// Spindle estimator gains.  ALPHA is how much of a new period's error goes into the period,
+// BETA how much into its rate of change.  BETA = ALPHA^2/(2-ALPHA) is critically damped.
+#define SPINDLE_ALPHA	0.25
+#define SPINDLE_BETA	(SPINDLE_ALPHA * SPINDLE_ALPHA / (2.0 - SPINDLE_ALPHA))
 
 
 /* --- Private Functions --- */
 float32 SetupThreadDivision(int8 ndx, pint32 pTrkRatio);	// Argument is index to global variable distance per spindle rev.
+float32 RampTime(float32 v, float32 a, float32 j, pfloat32 pTa);
+float32 RampSteps(float32 v, float32 a, float32 j);
+int32 BuildRampTable(puint16 table, int32 acc, int32 jerk, uint16 speed, puint16 pTicks);
+uint16 RampPeak(uint16 speed, int32 distance, int32 acc, int32 jerk);
+uint8 RampLevel(puint16 table, uint32 period);
+int32 GearDownSteps(uint8 top, uint8 gearTop, uint32 topPeriod, uint32 period);
+uint16 SetupRamp(int8 device, uint16 speed, int32 distance);
+int32 PredictClocksPerRev(int16 updates);
+#ifdef TRACK_SPINDLE_SPEED
+void SetupTracking(int32 clocks, uint32 period);
+#endif
+#ifdef RATIONAL_GEARING
+uint32 GreatestDivisor(uint32 a, uint32 b);
+int8 RationalPitch(float32 x, puint32 pNum, puint32 pDen);
+int8 MulFraction(puint32 pNum, puint32 pDen, uint32 n, uint32 d);
+#ifdef TRACK_SPINDLE_SPEED
+void SetupPitchLock(uint32 num, uint32 period);
+#endif
+#endif
+#ifdef MOTION_QUEUE
+uint8 PlanSegment(puint16 table, uint16 ticks, MOTION_SEGMENT * seg, uint8 prevTop, pint32 pPrevDown);
+#endif
 
 /*
  *  FUNCTION: labs
@@ -98,14 +150,17 @@ float32 SetupThreadDivision(int8 ndx, pint32 pTrkRatio);	// Argument is index to
  *  PARAMETERS:	32 bit signed long
  *
  *  DESCRIPTION: Takes the absolute value of the long argument.
+ *				 A HOST_BUILD uses the C library version instead.
  *
  *  RETURNS: The absolute value.
  *
  */
+#ifndef HOST_BUILD
 int32 
 labs(int32 arg) {
 	return((arg<0) ? 0-arg : arg);
 }
+#endif
 
 /* --- Public Functions --- */
 /*
@@ -122,10 +177,15 @@ void
 InitMotorDevice(void) {
   int8 i;
 
-	CCPR1L = PULSE_CLOCK_DIVISOR;    // Divide 40MHz by 4,  interrupt after PULSE_CLOCK_DIVISOR clocks == PULSE_POINT HZ
-	CCPR1H = PULSE_CLOCK_DIVISOR>>8;
-	CCP1CON = 0b00001011;   		// Compare generates an interrupt and clears Timer1.
-	T1CON = 0b00000001;
+	// Timer1 free runs at 40MHz / 4 as the time base for the step compares.
+	T1CON = 0b10000001;				// 16 bit reads, 1:1 prescale, Timer1 on.
+	T3CON = 0;						// Timer1 is the clock for both CCP1 and ECCP1.
+	CCP1CON = 0b00001010;   		// Compare only generates an interrupt.  Z axis step.
+	ECCP1CON = 0b00001010;			// Same for the X axis step.
+
+	// Timer2 makes the pulse clock.  PULSE_CLOCK_DIVISOR/2 clocks with a 1:2 postscale.
+	PR2 = (PULSE_CLOCK_DIVISOR/2) - 1;
+	T2CON = 0b00001100;				// 1:2 postscale, Timer2 on, 1:1 prescale.
 
 	// Initialize variables.
 	ZStepFlags.Byte = 0;				// Clear all Flags.  Nothing's happened yet.
@@ -135,24 +195,24 @@ InitMotorDevice(void) {
 	CurrentZPosition = 0;
 
 
-	ZAcc = GetGlobalVarLong(ACCEL_RATE_Z_NDX) << 5; 	// Get saved Acceleration.
-	ZVel = 0; 						// Motor not turning yet.
+	ZRampAcc = 0;					// Build ramp table from saved Acceleration.
+	SetupRamp(MOTOR_Z, 0, 0);
 	MaxZVel = 0;						// Motor not allowed to turn yet.
 	SystemZBackLashCount = 0;
 	LeadScrewRatio = SetupThreadDivision(MotionPitchIndex, &iTrackingRatio);
 
 #ifdef X_AXIS
-	XAcc = GetGlobalVarLong(ACCEL_RATE_X_NDX) << 5; 	// Get saved Acceleration.
-	XVel = 0; 						// Motor not turning yet.
+	XRampAcc = 0;					// Build ramp table from saved Acceleration.
+	SetupRamp(MOTOR_X, 0, 0);
 	MaxXVel = 0;					// Motor not allowed to turn yet.
 	XStartMotorPosition = 0;
 	XBackLashCount = 0;				// No backlash movement to start with.
 	TaperFlags.Byte = 0;		// Clear out Taper Movement flag so top bits aren't random.
 #endif
 
-	for (i=0;i<16; i++)
-		RPMAverage[i] = 0;
-	RPMAverageIndex = 0;
+	SpindlePeriodEst = 0;
+	SpindlePeriodRate = 0;
+	RPMState = RPM_ZERO;			// Averages start again from the next spindle pulse.
 	AveragedClocksPerRev = 0;
 	AverageRPM = 0;
 }
@@ -272,6 +332,110 @@ XDistanceToSteps( float32 distance) {
 	return(result);
 }
 
+/*
+ *  FUNCTION: DisplayScale
+ *
+ *  PARAMETERS: s		-- Display digits per step.
+ *				pScale	-- Filled with s in fixed point.
+ *
+ *  DESCRIPTION: Keeps as many bits of s as a float has.  Below one digit a step the
+ *				 shift goes up to 32 instead of leaving leading zeros in the scale.
+ *
+ *  RETURNS: The shift, 24 to 32.
+ *
+ */
+uint8
+DisplayScale(float32 s, puint32 pScale) {
+  uint8 shift = 24;
+	s *= 16777216.0;
+	while ((shift < 32) && (s < 2147483648.0)) {
+		s *= 2.0;
+		shift++;
+	}
+	s += 0.5;
+	*pScale = (s >= 4294967295.0) ? 0xFFFFFFFF : (uint32)s;
+	return(shift);
+}
+
+/*
+ *  FUNCTION: SetupDisplayScale
+ *
+ *  PARAMETERS: None
+ *
+ *  USES GLOBALS: ZDistanceDivisor, XDistanceDivisor, fMetricMode, MotionPitchIndex
+ *
+ *  DESCRIPTION: Works out how many display digits a motor step is worth on each axis
+ *				 so the run time display doesn't need floating point.  The last digit is
+ *				 0.001" or 0.01mm.  The pitch is turned into digits, and into TPI, here
+ *				 too.  Call again if the divisors, fMetricMode or the pitch change.
+ *
+ *  RETURNS: Nothing.  Sets ZDisplayScale, XDisplayScale, their shifts, DisplayScaleMetric,
+ *			 DisplayPitch, DisplayTPI, DisplayPitchIndex and DisplayPitchBits.
+ *
+ */
+void
+SetupDisplayScale(void) {
+  float32 units, pitch;
+	units = (fMetricMode) ? 2540.0 : 1000.0;		// Display digits per inch.
+	ZDisplayShift = DisplayScale(units / ZDistanceDivisor, &ZDisplayScale);
+	XDisplayShift = DisplayScale(units / XDistanceDivisor, &XDisplayScale);
+	DisplayScaleMetric = fMetricMode;
+
+	pitch = GlobalVars[MotionPitchIndex].f;
+	DisplayPitch = pitch * units + 0.5;
+	DisplayTPI = (pitch > 0.001) ? (int32)(10.0 / pitch + 0.5) : 0;	// Avoid divide by zero.
+	DisplayPitchIndex = MotionPitchIndex;
+	DisplayPitchBits = GlobalVars[MotionPitchIndex].l;
+}
+
+/*
+ *  FUNCTION: StepsToDisplay
+ *
+ *  PARAMETERS: steps	-- Motor position.
+ *				scale	-- ZDisplayScale or XDisplayScale.
+ *				shift	-- ZDisplayShift or XDisplayShift.
+ *
+ *  DESCRIPTION: steps * scale / 2^shift rounded, done as four 16 x 16 bit multiplies
+ *				 so the 64 bit product never has to be held.
+ *
+ *  RETURNS: Position in display digits.  Clipped to +/-0x7FFFFFFF.
+ *
+ */
+int32
+StepsToDisplay(int32 steps, uint32 scale, uint8 shift) {
+  uint32 a, p, lo, hi;
+  uint16 ah, al, kh, kl;
+  int8 minus = 0;
+	if (steps < 0) {
+		minus = 1;
+		steps = -steps;
+	}
+	a = steps;
+	ah = a >> 16;
+	al = a;
+	kh = scale >> 16;
+	kl = scale;
+	// a * scale = 2^32 ah*kh + 2^16 (ah*kl + al*kh) + al*kl.
+	// lo holds the 2^16 column and hi the 2^32 column.
+	p = (uint32)al * kl;
+	lo = p >> 16;
+	p = (uint32)ah * kl;
+	lo += p & 0xFFFF;
+	hi = p >> 16;
+	p = (uint32)al * kh;
+	lo += p & 0xFFFF;
+	hi += p >> 16;
+	hi += (uint32)ah * kh + (lo >> 16);
+	shift -= 16;				// Rest of the shift, 8 to 16.
+	if (hi >= (1UL << (15 + shift)))
+		a = 0x7FFFFFFF;			// Past anything the display can show.
+	else
+		a = (hi << (16 - shift)) + (((lo & 0xFFFF) + (1UL << (shift - 1))) >> shift);
+	if (minus)
+		return(-(int32)a);
+	return(a);
+}
+
 /*
  *  FUNCTION: PrintRPM
  *
@@ -342,6 +506,134 @@ SetupThreadDivision(int8 ndx, pint32 pTrkRatio) {
 	return(r);
 }
 
+#ifdef RATIONAL_GEARING
+/*
+ *  FUNCTION: GreatestDivisor
+ *
+ *  PARAMETERS:	a, b	-- Not both 0.
+ *
+ *  DESCRIPTION: Euclid's greatest common divisor.
+ *
+ *  RETURNS: 	The largest number that divides both.
+ *
+ */
+uint32
+GreatestDivisor(uint32 a, uint32 b) {
+  uint32 t;
+	while (b != 0) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return(a);
+}
+
+/*
+ *  FUNCTION: RationalPitch
+ *
+ *  PARAMETERS:	x			-- Pitch or step count as it's kept in the global variables.
+ *				pNum, pDen	-- Filled with x as a fraction.
+ *
+ *  DESCRIPTION: Walks the continued fraction of x to the first fraction that is as close
+ *				 as a float can tell.  Imperial pitches are whole numbers of threads per inch
+ *				 and metric ones are millimetres over 25.4 so both come back as what was
+ *				 typed in: 20 TPI is 1/20 and 1.5mm is 15/254.
+ *
+ *  RETURNS: 	0 if found with a denominator up to RATIONAL_DEN_MAX, otherwise -1.
+ *
+ */
+int8
+RationalPitch(float32 x, puint32 pNum, puint32 pDen) {
+  uint32 p0 = 0, q0 = 1, p1 = 1, q1 = 0, p, q, a;
+  float32 f, err;
+  int8 i;
+	*pNum = 0;
+	*pDen = 1;
+	if ((x <= 0.0) || (x >= (float32)RATIONAL_DEN_MAX * RATIONAL_DEN_MAX))
+		return(-1);
+	f = x;
+	for (i=0; i<16; i++) {
+		a = (uint32)f;
+		p = a * p1 + p0;
+		q = a * q1 + q0;
+		if (q > RATIONAL_DEN_MAX)
+			break;
+		p0 = p1; q0 = q1;
+		p1 = p;  q1 = q;
+		*pNum = p;
+		*pDen = q;
+		err = x - (float32)p / q;
+		if (fabs(err) <= x * (1.0 / 1048576.0))	// 20 bits of a float's 24.
+			return(0);
+		f -= a;
+		if (f < (1.0 / RATIONAL_DEN_MAX))
+			break;
+		f = 1.0 / f;
+	}
+	return(-1);
+}
+
+/*
+ *  FUNCTION: MulFraction
+ *
+ *  PARAMETERS:	pNum, pDen	-- Fraction multiplied in place.
+ *				n, d		-- By n/d.
+ *
+ *  DESCRIPTION: Cancels across before multiplying so the result stays in its lowest terms.
+ *
+ *  RETURNS: 	0, or -1 if the result doesn't fit below RATIONAL_MAX.
+ *
+ */
+int8
+MulFraction(puint32 pNum, puint32 pDen, uint32 n, uint32 d) {
+  uint32 g;
+	g = GreatestDivisor(*pNum, d);
+	*pNum /= g;
+	d /= g;
+	g = GreatestDivisor(n, *pDen);
+	n /= g;
+	*pDen /= g;
+	if ((n != 0) && (*pNum > RATIONAL_MAX / n))
+		return(-1);
+	if ((d != 0) && (*pDen > RATIONAL_MAX / d))
+		return(-1);
+	*pNum *= n;
+	*pDen *= d;
+	return(0);
+}
+
+/*
+ *  FUNCTION: SetupGearRatio
+ *
+ *  PARAMETERS: ndx			-- Index to Thread or Turning Pitch global variable.
+ *				pNum, pDen	-- Filled with Z steps per spindle rev as a fraction.
+ *
+ *  USES GLOBALS:	LEADSCREW_IPITCH_NDX
+ *					MOTOR_STEPS_REV_Z_NDX
+ *
+ *  DESCRIPTION: The exact form of SetupThreadDivision().  Thread pitch over leadscrew pitch
+ *				 times motor steps, each as the fraction it was entered as, so a metric thread
+ *				 on an imperial leadscrew keeps its 127/5.
+ *
+ *  RETURNS: 	0, or -1 if a pitch isn't a simple fraction or the result is too big.  The
+ *				caller falls back to the float ratio.
+ *
+ */
+int8
+SetupGearRatio(int8 ndx, puint32 pNum, puint32 pDen) {
+  uint32 n, d;
+	if (RationalPitch(GetGlobalVarFloat(ndx), pNum, pDen) != 0)
+		return(-1);
+	if (RationalPitch(GetGlobalVarFloat(LEADSCREW_IPITCH_NDX), &n, &d) != 0)
+		return(-1);
+	if (MulFraction(pNum, pDen, d, n) != 0)
+		return(-1);
+	if (RationalPitch(GetGlobalVarFloat(MOTOR_STEPS_REV_Z_NDX), &n, &d) != 0)
+		return(-1);
+	return(MulFraction(pNum, pDen, n, d));
+}
+#endif
+
 /*
  *  FUNCTION: SetupMotorSpeed
  *
@@ -351,7 +643,8 @@ SetupThreadDivision(int8 ndx, pint32 pTrkRatio) {
  *
  *  USES GLOBALS:
  * 		PULSE_CLOCK_RATE	    -- Frequency of pulse clock
- *		AveragedClocksPerRev	-- Number of pulse clocks per rev.
+ *		SPINDLE_CLOCK_RATE		-- Frequency the spindle is timed with.
+ *		AveragedClocksPerRev	-- Number of spindle clocks per rev.
  *
  *  DESCRIPTION:
  *		Example:
@@ -361,9 +654,11 @@ SetupThreadDivision(int8 ndx, pint32 pTrkRatio) {
  *			Therefore ratio = (1000 calculated in SetupThreadDivision) * 20000
  *			At 300 RPM we have 5 RPS or 200ms divided by our pulse clock period 1/20000 (50uS) = 4000
  *			so Stepper clock rate is 20000000/4000 = 5000 Hz.
+ *			With SPINDLE_CAPTURE AveragedClocksPerRev is in 625kHz spindle clocks and
+ *			the ratio is scaled to match.
  *
  *  RETURNS: 
- *		(Z axis Motor Steps per spindle Rev  * PULSE_CLOCK_RATE) / AveragedCLocksPerRev
+ *		(Z axis Motor Steps per spindle Rev  * SPINDLE_CLOCK_RATE) / AveragedCLocksPerRev
  *
  */
 int32 
@@ -379,7 +674,7 @@ SetupMotorSpeed(int32 ratio) {
 */
 	// If not use the average of the spindle speed over the last 10 seconds or so.
 	if (AveragedClocksPerRev != 0) 
-		StepperMotorClockRate = (ratio / AveragedClocksPerRev);
+		StepperMotorClockRate = (float32)ratio * ((float32)SPINDLE_CLOCK_RATE / PULSE_CLOCK_RATE) / AveragedClocksPerRev;
 //#endif
 	return(StepperMotorClockRate);
 }
@@ -414,6 +709,7 @@ CalculateMotorDistance( float32 dist, float32 divisor, int8 units ) {
  *  PARAMETERS:		iTrkRatio
  *
  *  USES GLOBALS:	PULSE_CLOCK_RATE
+ *					MAX_STEP_RATE
  *
  *  DESCRIPTION:	Helper function for calculating a spindle speed based on a 
  *					step rate about 5% under maximum stepper speed to avoid running 
@@ -424,15 +720,780 @@ CalculateMotorDistance( float32 dist, float32 divisor, int8 units ) {
  */
 int32 
 CalcuateSpindleSpeed(uint32 iTrkRatio) {
-	return( (PULSE_CLOCK_RATE * 60L) / (iTrkRatio/(PULSE_CLOCK_RATE-1000)) );
+	return( (PULSE_CLOCK_RATE * 60L) / (iTrkRatio/(MAX_STEP_RATE - MAX_STEP_RATE/20)) );
+}
+
+/*
+ *  FUNCTION: RampTime
+ *
+ *  PARAMETERS:		v		-- Speed to reach in steps/sec.
+ *					a		-- Acceleration in steps/sec/sec.
+ *					j		-- Jerk in steps/sec/sec/sec.  0 for a linear ramp.
+ *					pTa		-- Returns how long the acceleration takes to build up.
+ *
+ *  USES GLOBALS:	None
+ *
+ *  DESCRIPTION:	Time to get from a stop to v.  An S-curve builds the acceleration up at the
+ *					jerk rate, holds it and then lets it off again at the same rate.  If v is
+ *					reached before the acceleration is all built up there's no hold.
+ *
+ *  RETURNS: 		Seconds
+ *
+ */
+float32
+RampTime(float32 v, float32 a, float32 j, pfloat32 pTa) {
+  float32 ta;
+
+	if (j <= 0.0) {
+		*pTa = 0.0;
+		return(v / a);
+	}
+	ta = a / j;
+	if (v < a * ta) {			// Never gets to full acceleration.
+		ta = sqrt(v / j);
+		*pTa = ta;
+		return(2.0 * ta);
+	}
+	*pTa = ta;
+	return(v / a + ta);
+}
+
+/*
+ *  FUNCTION: RampSteps
+ *
+ *  PARAMETERS:		v, a, j	-- As for RampTime.
+ *
+ *  USES GLOBALS:	PULSE_CLOCK_RATE
+ *
+ *  DESCRIPTION:	Steps an S-curve takes to get up to v and back down again on the table
+ *					BuildRampTable() makes for it.  The interrupt routine holds the top for a
+ *					whole level as it turns round so that's a level more than the smooth ramp.
+ *
+ *  RETURNS: 		Steps
+ *
+ */
+float32
+RampSteps(float32 v, float32 a, float32 j) {
+  float32 t, ta;
+
+	t = RampTime(v, a, j, &ta);
+	return(v * (t + ceil(t * PULSE_CLOCK_RATE / RAMP_TABLE_SIZE) / PULSE_CLOCK_RATE));
+}
+
+/*
+ *  FUNCTION: BuildRampTable
+ *
+ *  PARAMETERS:		table	-- ZRampTable or XRampTable to fill in.
+ *					acc		-- Acceleration added to the velocity << 16 each pulse clock.
+ *					jerk	-- JERK_RATE global.  0 for a linear ramp.
+ *					speed	-- Speed an S-curve ramps to.
+ *					pTicks	-- Returns the number of pulse clocks spent at each level.
+ *
+ *  USES GLOBALS:	MAX_STEP_RATE, PULSE_CLOCK_RATE
+ *
+ *  DESCRIPTION:	Cuts the ramp into RAMP_TABLE_SIZE levels of the same length of time.  Each
+ *					entry is the step period, in Timer1 counts, of the speed in the middle of its
+ *					level so a move covers the same distance while ramping as a smooth ramp.
+ *
+ *					A linear ramp goes from a stop to MAX_STEP_RATE so one table does every
+ *					speed.  An S-curve's shape depends on the speed so its table only goes to
+ *					speed.  Running faster than the top of the table jumps from the last level.
+ *
+ *					Periods longer than Timer1 can count are clipped which only matters for the
+ *					first levels.  A very low acceleration runs out of pulse clocks per level so
+ *					its table stops short of the top speed.
+ *
+ *  RETURNS: 		Steps an S-curve takes from speed to a stop.  0 for a linear ramp.
+ *
+ */
+int32
+BuildRampTable(puint16 table, int32 acc, int32 jerk, uint16 speed, puint16 pTicks) {
+  float32 a, j, v, t, ta, ticks, ti, vi, period;
+  int8 i;
+
+	if (acc < 1)
+		acc = 1;
+	a = (float32)acc * ACCEL_SCALE;
+	j = (float32)jerk * JERK_SCALE;
+	v = (jerk) ? (float32)speed : (float32)MAX_STEP_RATE;
+	if (v < 1.0)
+		v = 1.0;
+	t = RampTime(v, a, j, &ta);
+	ticks = ceil(t * PULSE_CLOCK_RATE / RAMP_TABLE_SIZE);
+	if (ticks > 65535.0)
+		ticks = 65535.0;
+
+	for (i = 0; i < RAMP_TABLE_SIZE; i++) {
+		ti = ((float32)i + 0.5) * ticks / PULSE_CLOCK_RATE;		// Middle of the level.
+		if (ti >= t)
+			vi = v;
+		else if (ti < ta)									// Building up acceleration.
+			vi = 0.5 * j * ti * ti;
+		else if (ti > t - ta)								// Letting it off.
+			vi = v - 0.5 * j * (t - ti) * (t - ti);
+		else												// Full acceleration.
+			vi = 0.5 * j * ta * ta + a * (ti - ta);
+		period = (float32)STEP_TIMER_RATE / vi;
+		table[i] = (period > 65535.0) ? 65535 : (uint16)period;
+	}
+	*pTicks = (uint16)ticks;
+
+	// Coming down, the interrupt routine stays at the top for a level before walking
+	// down the table, and runs the first level until the step count runs out.
+	if (jerk)
+		return((int32)(v * (t + ticks / PULSE_CLOCK_RATE) / 2.0));
+	return(0);
+}
+
+/*
+ *  FUNCTION: RampPeak
+ *
+ *  PARAMETERS:		speed		-- Speed the move wants.
+ *					distance	-- Steps in the move.  0 for no limit.
+ *					acc, jerk	-- As for BuildRampTable.
+ *
+ *  USES GLOBALS:	None
+ *
+ *  DESCRIPTION:	A move shorter than RampSteps() of its speed peaks at a lower speed.
+ *					Finds that speed so the move turns round at the top of its table rather
+ *					than slowing down from part way up and creeping the last steps.
+ *
+ *  RETURNS: 		Speed the S-curve should go to.
+ *
+ */
+uint16
+RampPeak(uint16 speed, int32 distance, int32 acc, int32 jerk) {
+  float32 a, j, lo, hi, v;
+  int8 i;
+
+	a = (float32)acc * ACCEL_SCALE;
+	j = (float32)jerk * JERK_SCALE;
+	if ((distance <= 0) || (speed == 0) || (RampSteps(speed, a, j) <= (float32)distance))
+		return(speed);
+
+	lo = 0.0;
+	hi = speed;
+	for (i = 0; i < 16; i++) {
+		v = (lo + hi) / 2.0;
+		if (RampSteps(v, a, j) > (float32)distance)
+			hi = v;
+		else
+			lo = v;
+	}
+	return((lo < 1.0) ? 1 : (uint16)lo);
+}
+
+/*
+ *  FUNCTION: RampLevel
+ *
+ *  PARAMETERS:		table	-- ZRampTable or XRampTable.
+ *					period	-- Step period to ramp to.  0 to stop.
+ *
+ *  USES GLOBALS:	None
+ *
+ *  DESCRIPTION:	The first ramp level at or above the speed.  The interrupt routine runs
+ *					at that level with the exact step period rather than the table entry.
+ *
+ *  RETURNS: 		Level from 0 (stopped) to RAMP_TABLE_SIZE.
+ *
+ */
+uint8
+RampLevel(puint16 table, uint32 period) {
+  uint8 level;
+
+	if (period == 0)
+		return(0);
+	for (level = 0; level < RAMP_TABLE_SIZE - 1; level++) {
+		if (((uint32)table[level] << STEP_FRACTION_BITS) <= period)
+			break;
+	}
+	return(level + 1);
+}
+
+/*
+ *  FUNCTION: GearDownSteps
+ *
+ *  PARAMETERS:		top			-- Level a geared pass catches up at.
+ *					gearTop		-- Level it creeps at.
+ *					topPeriod	-- Step period at top.
+ *					period		-- Step period of the geared speed.
+ *
+ *  USES GLOBALS:	ZRampTable, ZRampTicks
+ *
+ *  DESCRIPTION:	Steps Z makes up on the encoder coming down from top to gearTop.  Each
+ *					level lasts ZRampTicks pulse clocks.  The top level is counted whole so the
+ *					pass comes down a little early and creeps the rest rather than overshooting.
+ *
+ *  RETURNS: 		Steps made up.  0 if there's no ramp down.
+ *
+ */
+int32
+GearDownSteps(uint8 top, uint8 gearTop, uint32 topPeriod, uint32 period) {
+  uint8 level;
+  float32 counts, geared, steps;
+
+	if (top <= gearTop)
+		return(0);
+	counts = (float32)ZRampTicks * (STEP_TIMER_RATE / PULSE_CLOCK_RATE);	// Timer1 counts at each level.
+	geared = counts * (1 << STEP_FRACTION_BITS) / period;					// Encoder steps over a level.
+	steps = counts * (1 << STEP_FRACTION_BITS) / topPeriod - geared;
+	for (level = top - 1; level > gearTop; level--)
+		steps += counts / ZRampTable[level - 1] - geared;
+	return((steps > 0.0) ? (int32)(steps + 0.5) : 0);
+}
+
+/*
+ *  FUNCTION: SetupRamp
+ *
+ *  PARAMETERS:		device		-- MOTOR_Z or MOTOR_X
+ *					speed		-- Speed the move wants.
+ *					distance	-- Steps in the move.  0 for a jog or when speed can't be reduced.
+ *
+ *  USES GLOBALS:	ACCEL_RATE_Z_NDX, JERK_RATE_Z_NDX, ACCEL_RATE_X_NDX, JERK_RATE_X_NDX
+ *					Sets ZAcc, ZRampTable, ZRampTicks, ZDecelSteps and the X equivalents.
+ *
+ *  DESCRIPTION:	Gets the acceleration and jerk from EEROM since they may have changed.
+ *					With no jerk the linear table is rebuilt if the acceleration changed.  With
+ *					jerk an S-curve is built for this move and ZDecelSteps says where to start
+ *					slowing down.  The table is only touched while the axis is stopped since the
+ *					interrupt routine may be walking it.
+ *
+ *  RETURNS: 		Speed to move at.  Less than speed for an S-curve move too short to get there.
+ *
+ */
+uint16
+SetupRamp(int8 device, uint16 speed, int32 distance) {
+  int32 jerk;
+
+	switch (device) {
+	  case MOTOR_Z :
+		ZAcc = GetGlobalVarLong(ACCEL_RATE_Z_NDX) << 5;
+		jerk = GetGlobalVarLong(JERK_RATE_Z_NDX);
+		if (!fZAxisActive && !fZMoveRQ) {
+			ZDecelSteps = 0;
+			if (jerk) {
+				speed = RampPeak(speed, distance, ZAcc, jerk);
+				ZDecelSteps = BuildRampTable(ZRampTable, ZAcc, jerk, speed, &ZRampTicks);
+				ZRampAcc = 0;			// Linear table has to be built again.
+			}
+			else if (ZAcc != ZRampAcc) {
+				BuildRampTable(ZRampTable, ZAcc, 0, 0, &ZRampTicks);
+				ZRampAcc = ZAcc;
+			}
+		}
+		break;
+
+	  case MOTOR_X :
+#ifdef X_AXIS
+		XAcc = GetGlobalVarLong(ACCEL_RATE_X_NDX) << 5;
+		jerk = GetGlobalVarLong(JERK_RATE_X_NDX);
+		if (!fXAxisActive) {
+			XDecelSteps = 0;
+			if (jerk) {
+				speed = RampPeak(speed, distance, XAcc, jerk);
+				XDecelSteps = BuildRampTable(XRampTable, XAcc, jerk, speed, &XRampTicks);
+				XRampAcc = 0;
+			}
+			else if (XAcc != XRampAcc) {
+				BuildRampTable(XRampTable, XAcc, 0, 0, &XRampTicks);
+				XRampAcc = XAcc;
+			}
+		}
+#endif
+		break;
+	}
+	return(speed);
+}
+
+/*
+ *  FUNCTION: PredictClocksPerRev
+ *
+ *  PARAMETERS:	updates	-- Number of spindle updates ahead to predict.
+ *
+ *  USES GLOBALS:	AveragedClocksPerRev, SpindlePeriodEst, SpindlePeriodRate, SpindleUpdates
+ *
+ *  DESCRIPTION: Extrapolates the spindle estimator's period and rate of change.  A spindle
+ *				 slot sensor gives SpindleSlots updates per revolution.  Updates MotorDevice()
+ *				 hasn't taken yet have already gone by so they're added on.
+ *
+ *  RETURNS: 	Predicted spindle clocks per rev.  The current estimate if the prediction
+ *				would have the spindle stopping or more than doubling its speed.
+ *
+ */
+int32
+PredictClocksPerRev(int16 updates) {
+  float32 clocks;
+
+	clocks = SpindlePeriodEst + SpindlePeriodRate * (updates + SpindleUpdates);
+	if ((clocks < SpindlePeriodEst / 2) || (clocks > SpindlePeriodEst * 2))
+		return(AveragedClocksPerRev);
+	return((int32)(clocks + 0.5));
+}
+
+#ifdef THREAD_PHASE_START
+/*
+ *  FUNCTION: ThreadPhaseSteps
+ *
+ *  PARAMETERS:	speed	-- Rate in Hz that Z is moved on at.
+ *				length	-- Steps from the start of the thread to its end.  The sign is the
+ *						   direction the thread is cut in.
+ *
+ *  USES GLOBALS:	AveragedClocksPerRev, LeadScrewRatio, ZPhaseSteps, ZPhaseAt,
+ *					ACCEL_RATE_Z_NDX, JERK_RATE_Z_NDX
+ *
+ *  DESCRIPTION: A threading pass waits at the start of the thread for the index.  Instead Z
+ *				 can be moved on along the thread to where the helix will be a little later
+ *				 and the pass started when the spindle gets round to that phase.  The time
+ *				 allowed is PHASE_START_SETTLE plus the move of the steps on the same linear
+ *				 or S-curve ramp SetupRamp() will give it, peaking lower if it's short.  How
+ *				 far to go depends on how long it takes to get there so it is worked out a
+ *				 few times over.  If the helix gets away from Z or the index comes first
+ *				 the pass starts on the index as before.  A move that runs late only costs a
+ *				 turn since the interrupt routine waits for the phase to come round again.
+ *				 MotorMoveDistance() turns the steps back into a start phase if Z is where
+ *				 this left it.
+ *
+ *  RETURNS: 	Steps to move Z on along the thread before the pass, less than a spindle
+ *				revolution's worth.  0 to start on the index.
+ *
+ */
+int32
+ThreadPhaseSteps(uint16 speed, int32 length) {
+  int32 phase, acc, jerk;
+  float32 rev, lead, steps, time, a, ta;
+  uint16 peak;
+  int8 i;
+
+	ZPhaseSteps = 0;
+	phase = GetSpindlePhase();
+	if ((phase < 0) || (AveragedClocksPerRev <= 0) || (speed == 0) || (SpindleLines > 1))
+		return(0);	// Spindle position not known yet or the encoder gears the pass on the line.
+	LeadScrewRatio = SetupThreadDivision(MotionPitchIndex, &iTrackingRatio);
+	acc = GetGlobalVarLong(ACCEL_RATE_Z_NDX) << 5;
+	if (acc < 1)
+		acc = 1;
+	jerk = GetGlobalVarLong(JERK_RATE_Z_NDX);
+	a = (float32)acc * ACCEL_SCALE;
+	rev = (float32)phase / AveragedClocksPerRev;		// Fraction of a turn past the index.
+	lead = rev;
+	for (i=0; (i<4) && (lead < 1.0); i++) {
+		steps = lead * LeadScrewRatio;
+		// Up to speed and back down again.  Each ramp covers half what the peak speed would
+		// in its time.
+		peak = RampPeak(speed, (int32)steps, acc, jerk);
+		time = steps / peak + RampTime(peak, a, (float32)jerk * JERK_SCALE, &ta);
+		lead = rev + (PHASE_START_SETTLE + time) * SPINDLE_CLOCK_RATE / AveragedClocksPerRev;
+	}
+	if (lead >= 1.0)
+		return(0);
+	ZPhaseSteps = (int32)(lead * LeadScrewRatio + 0.5);
+	if ((ZPhaseSteps == 0) || (ZPhaseSteps >= labs(length))) {
+		ZPhaseSteps = 0;
+		return(0);
+	}
+	if (length < 0)
+		ZPhaseSteps = -ZPhaseSteps;
+	INTCON &= 0x3F;
+	ZPhaseAt = ZMotorPosition + ZPhaseSteps;
+	INTCON |= 0xC0;
+	return(ZPhaseSteps);
+}
+#endif
+
+#ifdef THREAD_RUN_UP
+/*
+ *  FUNCTION: ThreadRunUp
+ *
+ *  PARAMETERS:	pSpeed	-- Returns the steps per second Z threads at.
+ *				pOn		-- Returns the steps Z goes before it's on the helix.
+ *
+ *  USES GLOBALS:	AveragedClocksPerRev, Sets LeadScrewRatio, ACCEL_RATE_Z_NDX, JERK_RATE_Z_NDX
+ *
+ *  DESCRIPTION: Linear or S-curve, the ramp from rest to the threading speed covers half the
+ *				 distance full speed would have in the same time.  That's how far Z ends up
+ *				 behind a full speed start, and how far it goes getting up to speed.
+ *				 A pass geared off the encoder ramps up linearly to 1/GEAR_CATCH_UP faster, stays
+ *				 there till what it owes is what the ramp back down makes up, then comes down.
+ *				 It ends up right on the lines with nothing behind.
+ *
+ *  RETURNS: 	Run-up in steps Z is behind.  0 if it isn't or the spindle speed isn't known.
+ *
+ */
+static float32
+ThreadRunUp(pfloat32 pSpeed, pfloat32 pOn) {
+  int32 clocks, acc;
+  float32 t, ta, a, c, owed;
+
+	*pSpeed = *pOn = 0.0;
+	clocks = AveragedClocksPerRev;
+#ifdef SPINDLE_PREDICT_START
+	clocks = PredictClocksPerRev(SpindleSlots);		// As MotorMoveDistance() will use.
+#endif
+	LeadScrewRatio = SetupThreadDivision(MotionPitchIndex, &iTrackingRatio);
+	if ((clocks <= 0) || (LeadScrewRatio <= 0.0))
+		return(0.0);	// No speed yet.
+	*pSpeed = LeadScrewRatio * SPINDLE_CLOCK_RATE / clocks;
+	if (*pSpeed > MAX_STEP_RATE)
+		return(0.0);	// The pass will be refused anyway.
+	acc = GetGlobalVarLong(ACCEL_RATE_Z_NDX) << 5;
+	if (acc < 1)
+		acc = 1;
+	a = (float32)acc * ACCEL_SCALE;
+	if ((SpindleLines > 1) && (LeadScrewRatio <= (float32)SpindleLines)
+			&& (*pSpeed <= MAX_STEP_RATE - MAX_STEP_RATE / (GEAR_CATCH_UP + 1))) {
+		c = *pSpeed / GEAR_CATCH_UP;						// Catching up this much faster.
+		owed = (*pSpeed * (*pSpeed + c) - (*pSpeed + c) * (*pSpeed + c) / 2.0 - c * c / 2.0) / a;
+		t = (*pSpeed + c) / a + c / a;						// Up and back down.
+		if (owed > 0.0)
+			t += owed / c;									// At the top.
+		*pOn = *pSpeed * t;
+		return(0.0);
+	}
+	t = RampTime(*pSpeed, a, (float32)GetGlobalVarLong(JERK_RATE_Z_NDX) * JERK_SCALE, &ta);
+	*pOn = *pSpeed * t / 2.0;
+	return(*pOn);
+}
+
+/*
+ *  FUNCTION: ThreadRunUpSteps
+ *
+ *  PARAMETERS:	length	-- Steps from the start of the thread to its end.  The sign is the
+ *						   direction the thread is cut in.
+ *
+ *  USES GLOBALS:	LeadScrewRatio
+ *
+ *  DESCRIPTION: A threading pass starts from rest on the index and ramps up to the spindle's
+ *				 speed.  Once up to speed Z trails a full speed start by its ThreadRunUp().
+ *				 Starting a whole number of leads less that run-up back from the start of
+ *				 the thread puts Z on the helix a full speed start there would have cut, so
+ *				 every pass matches even if the RPM changes between them.  Enough leads are
+ *				 taken for Z to be up to speed before it gets there.  A pass geared off the
+ *				 encoder isn't behind once it has caught up so it starts whole leads back.
+ *
+ *  RETURNS: 	Steps before the start of the thread to start the pass at, with the sign of
+ *				length.  0 if there is no run-up or the spindle speed isn't known.
+ *
+ */
+int32
+ThreadRunUpSteps(int32 length) {
+  int32 steps;
+  float32 v, runUp, on;
+
+	runUp = ThreadRunUp(&v, &on);
+	if (on < 0.5)
+		return(0);
+	steps = (int32)(ceil((on + runUp) / LeadScrewRatio) * LeadScrewRatio - runUp + 0.5);
+	return((length < 0) ? -steps : steps);
 }
+#endif
+
+#ifdef FEED_HOLD
+/*
+ *  FUNCTION: MotorFeedHold
+ *
+ *  PARAMETERS:	None
+ *
+ *  USES GLOBALS:	ZMotorPosition, AveragedClocksPerRev, Sets ZHoldAt and ZHoldRev.
+ *
+ *  DESCRIPTION: Stops a threading pass that's up to speed and so on the helix, remembering
+ *				 where Z and the spindle were for MotorResumeAt().  Z decelerates as for
+ *				 MotorStop() without following the spindle any more.  A pass still ramping
+ *				 isn't on the helix yet and one geared off the encoder can't be restarted
+ *				 part way round, so those can't be held.
+ *
+ *  RETURNS: 	0 if held.  MSG_MOTOR_STOPPED_ERROR if the pass has to be stopped instead.
+ *
+ */
+int8
+MotorFeedHold(void) {
+  int32 phase;
+
+	if (!fThreading || !fZMoveBSY || !fZUpToSpeed || fZDeccel || (AveragedClocksPerRev <= 0))
+		return(MSG_MOTOR_STOPPED_ERROR);
+#ifdef THREAD_PULL_OUT
+	if (fPullingOut)
+		return(MSG_MOTOR_STOPPED_ERROR);	// X is already on its way out.
+#endif
+	if ((phase = GetSpindlePhase()) < 0)
+		return(MSG_MOTOR_STOPPED_ERROR);
+	INTCON &= 0x3F;
+	ZHoldAt = ZMotorPosition;
+	fThreading = 0;
+	INTCON |= 0xC0;
+	ZHoldRev = (float32)phase / AveragedClocksPerRev;
+	MotorStop(MOTOR_Z);
+	return(0);
+}
+
+/*
+ *  FUNCTION: MotorResumeAt
+ *
+ *  PARAMETERS:	length	-- The sign is the direction the thread is cut in.
+ *				xSteps	-- Steps X goes back in once Z is on the helix again.
+ *				xSpeed	-- Rate in Hz that X goes in at.
+ *
+ *  USES GLOBALS:	ZHoldAt, ZHoldRev, LeadScrewRatio, ACCEL_RATE_X_NDX
+ *					Sets ZPhaseSteps and ZPhaseAt.
+ *
+ *  DESCRIPTION: Picks up a pass held by MotorFeedHold().  Z starts back far enough to get up
+ *				 to speed and then run on the helix while X goes back in, before it gets to
+ *				 where the pass was held.  Up to speed Z trails its start by the run-up so
+ *				 the pass starts (back + run-up) / lead of a turn before the hold's spindle
+ *				 phase.  That phase is left in ZPhaseSteps for MotorMoveDistance() as for a
+ *				 phase start.
+ *
+ *  RETURNS: 	Where to move Z to before the SPEED_TRACK_SPINDLE move to the end.
+ *
+ */
+int32
+MotorResumeAt(int32 length, int32 xSteps, uint16 xSpeed) {
+  int32 acc, back;
+  float32 v, a, runUp, on, time, rev;
+
+	runUp = ThreadRunUp(&v, &on);
+	acc = GetGlobalVarLong(ACCEL_RATE_X_NDX) << 5;
+	if (acc < 1)
+		acc = 1;
+	a = (float32)acc * ACCEL_SCALE;
+	time = PHASE_START_SETTLE;
+	if (xSpeed != 0) {		// X in at speed or a triangle if it's too short to get there.
+		if ((float32)xSteps * a < (float32)xSpeed * xSpeed)
+			time += 2.0 * sqrt(xSteps / a);
+		else
+			time += (float32)xSteps / xSpeed + (float32)xSpeed / a;
+	}
+	back = (int32)(on + v * time + 0.5);
+	rev = ZHoldRev - (back + runUp) / LeadScrewRatio;
+	rev -= floor(rev);
+	ZPhaseSteps = (int32)(rev * LeadScrewRatio + 0.5);
+	if ((float32)ZPhaseSteps >= LeadScrewRatio)
+		ZPhaseSteps = 0;		// Back round to the index.
+	ZPhaseAt = (length < 0) ? ZHoldAt + back : ZHoldAt - back;
+	return(ZPhaseAt);
+}
+#endif
+
+#ifdef THREAD_PULL_OUT
+/*
+ *  FUNCTION: MotorPullOut
+ *
+ *  PARAMETERS:	zSteps	-- Z steps from the end of the pass to start pulling out.
+ *				xSteps	-- X steps out over them.
+ *				dir		-- MOVE_OUT or MOVE_IN, whichever way X retracts.
+ *
+ *  USES GLOBALS:	fXDirection, X_AXIS_BACKLASH_NDX
+ *					Sets ZPullOutSteps, PullOutBacklash, PullOutTangent, fPullOutDir and fPullOutArmed.
+ *
+ *  DESCRIPTION: Arms a pull out on the threading pass just asked for.  The interrupt steps X
+ *				 off Z so X can take at most one step per Z step.  A steeper pull out comes
+ *				 out at that and the retract after the pass does the rest.  If X last went
+ *				 the other way, as it does after an infeed, its backlash is taken up first
+ *				 at a step per Z step and the pull out starts that much sooner.
+ *
+ *  RETURNS: 	Nothing
+ *
+ */
+void
+MotorPullOut(int32 zSteps, int32 xSteps, uint8 dir) {
+  float32 tangent, res;
+  int32 backlash = 0;
+
+	if ((zSteps <= 0) || (xSteps <= 0))
+		return;
+	tangent = (float32)xSteps / zSteps * 4294967296.0;
+	if ((fMXInvertDirMotor ^ dir) != fXDirection) {
+		res = GetGlobalVarFloat(X_AXIS_BACKLASH_NDX);
+		if (fMetricMode)
+			res = res * 25.4;
+		backlash = CalculateMotorDistance(res, XDistanceDivisor, fMetricMode);
+	}
+	INTCON &= 0x3F;
+	ZPullOutSteps = zSteps + backlash + 1;	// The interrupt's ZStepCount still has the step just taken.
+	PullOutBacklash = backlash;
+	PullOutTangent = (tangent >= 4294967295.0) ? 0xFFFFFFFF : (uint32)tangent;
+	fPullOutDir = dir;
+	fPullingOut = 0;
+	fPullOutArmed = 1;
+	INTCON |= 0xC0;
+}
+#endif
+
+#ifdef TRACK_SPINDLE_SPEED
+/*
+ *  FUNCTION: SetupTracking
+ *
+ *  PARAMETERS:	clocks	-- Spindle clocks per rev the thread is cut at.
+ *				period	-- Step period at that spindle speed.
+ *
+ *  USES GLOBALS:	Sets SpinRate, SpinClip, SpinFloor, SpinSlew, ZCruisePeriod and ZPeriodPerClock.
+ *					ACCEL_RATE_Z_NDX, SpindleSlots
+ *
+ *  DESCRIPTION: Spindle Speed tracking variables get set up.  They can be done outside the
+ *				 interrupt routine because they aren't being used until fThreading is 1.
+ *				 Z follows the spindle down to a fifth of the speed, and up till it would
+ *				 pass MAX_STEP_RATE.  The correction moves by at most SpinSlew spindle clocks
+ *				 an update, the change in step rate Z can make at its acceleration in the
+ *				 time between updates.  A pitch lock makes up for the steps that costs.
+ *
+ *  RETURNS: 	Nothing
+ *
+ */
+void
+SetupTracking(int32 clocks, uint32 period) {
+  int32 acc;
+  float32 slew;
+
+	SpinRate = clocks;	// 16MAR12 -- jcd -- Use average value since it's also used to 
+						// calculate stepper motor rate.
+	// SpinRate = LastSpindleClocks;	// Get spindle clocks value used to calculate stepper rate.
+	SpinClip = SpinRate << 2;		// Calculate ceiling to prevent overruns.
+	// The interrupt routine scales the step period by the change in spindle period.
+	ZCruisePeriod = period;
+	ZPeriodPerClock = (float32)ZCruisePeriod * (1L << TRACK_FRACTION_BITS) / SpinRate;
+	if ((ZPeriodPerClock != 0) && (SpinClip > 0x7FFFFFFFL / ZPeriodPerClock))
+		SpinClip = 0x7FFFFFFFL / ZPeriodPerClock;	// Keep the correction inside an int32.
+	// Faster than this would need a period shorter than MAX_STEP_RATE's.
+	SpinFloor = 0;
+	if (period > STEP_PERIOD(MAX_STEP_RATE))
+		SpinFloor = -(int32)((float32)SpinRate * (period - STEP_PERIOD(MAX_STEP_RATE)) / period);
+	// dv = acceleration * time between updates.  A change of dv in v is dv / v of the spindle clocks.
+	acc = GetGlobalVarLong(ACCEL_RATE_Z_NDX) << 5;
+	if (acc < 1)
+		acc = 1;
+	slew = (float32)acc * ACCEL_SCALE * ((float32)SpinRate / (SpindleSlots * (float32)SPINDLE_CLOCK_RATE))
+			* SpinRate / ((float32)STEP_TIMER_RATE * (1L << STEP_FRACTION_BITS) / period);
+	SpinSlew = (slew < 1.0) ? 1 : (slew > (float32)SpinClip) ? SpinClip : (int32)slew;
+}
+
+/*
+ *  FUNCTION: PrintTracking
+ *
+ *  PARAMETERS:	None
+ *
+ *  USES GLOBALS:	TrackUpdates, TrackSlewed, TrackClipped, TrackCorrMin, TrackCorrMax,
+ *					TrackPitchMax, SpinRate, GearDenominator
+ *
+ *  DESCRIPTION: Reports on the serial port how the last threading move followed the spindle.
+ *				 Spindle updates, how many were held back by SpinSlew or out of range, the
+ *				 RPM range while up to speed as percent of the RPM it started at, and the
+ *				 worst pitch error at an index in steps.
+ *
+ *  RETURNS: 	Nothing
+ *
+ */
+void
+PrintTracking(void) {
+  int16 slow, fast;
+
+	if (SpinRate <= 0)
+		return;
+	slow = (int16)(100.0 * TrackCorrMax / (SpinRate + TrackCorrMax) + 0.5);
+	fast = (int16)(-100.0 * TrackCorrMin / (SpinRate + TrackCorrMin) + 0.5);
+	printf((MEM_MODEL rom char *)"Tracking: %u updates, %u slewed, %u clipped, RPM -%d%% +%d%%",
+		TrackUpdates, TrackSlewed, TrackClipped, slow, fast);
+#ifdef RATIONAL_GEARING
+	printf((MEM_MODEL rom char *)", pitch error %ld/%ld steps", (long)TrackPitchMax, (long)GearDenominator);
+#endif
+	printf((MEM_MODEL rom char *)"\n");
+}
+
+#ifdef RATIONAL_GEARING
+/*
+ *  FUNCTION: SetupPitchLock
+ *
+ *  PARAMETERS:	num		-- GearNumerator, the exact steps per rev times GearDenominator.
+ *				period	-- Step period at the threading speed.
+ *
+ *  USES GLOBALS:	Sets ZPeriodPerPitch and PitchClip.
+ *
+ *  DESCRIPTION: Half a revolution's worth of PitchError changes the step period by half.
+ *				 The correction is limited to an eighth of the period.
+ *
+ *  RETURNS: 	Nothing
+ *
+ */
+void
+SetupPitchLock(uint32 num, uint32 period) {
+  float32 f;
+	f = (float32)period * (1L << TRACK_FRACTION_BITS) / (2.0 * num);
+	ZPeriodPerPitch = (f < (float32)RATIONAL_MAX) ? (uint32)f : RATIONAL_MAX;
+	PitchClip = num >> 2;
+	if ((ZPeriodPerPitch != 0) && (PitchClip > 0x7FFFFFFFL / ZPeriodPerPitch))
+		PitchClip = 0x7FFFFFFFL / ZPeriodPerPitch;
+}
+#endif
+#endif
+
+#ifdef MOTION_QUEUE
+/*
+ *  FUNCTION: PlanSegment
+ *
+ *  PARAMETERS:	table		-- ZRampTable or XRampTable.  The linear one.
+ *				ticks		-- ZRampTicks or XRampTicks.
+ *				seg			-- Segment with Steps, Top and TopPeriod filled in.
+ *				prevTop		-- Top level of the segment in front if it can run on into this one.
+ *							   0 if it has to stop first.
+ *				pPrevDown	-- Returns steps from the end the segment in front starts slowing down.
+ *
+ *  USES GLOBALS:	None
+ *
+ *  DESCRIPTION: Look-ahead for the motion queue.  Each level of the table lasts ticks pulse
+ *				 clocks so the steps to get up to a level are that time over the step period of
+ *				 every level below it, and slowing down takes the same steps.  The two segments
+ *				 meet at the slower of their speeds, or lower still if this segment couldn't
+ *				 stop from there in its own length.  Top comes down if the segment is too short
+ *				 to get from there up to it and back down to a stop.  Sets Top, TopPeriod and
+ *				 DownSteps.
+ *
+ *  RETURNS: 	Level the segments meet at.  0 if the one in front has to stop.
+ *
+ */
+uint8
+PlanSegment(puint16 table, uint16 ticks, MOTION_SEGMENT * seg, uint8 prevTop, pint32 pPrevDown) {
+  uint8 level, last, limit, meet, top;
+  uint32 counts;
+  int32 steps, meetSteps, topSteps, prevSteps;
+
+	counts = (uint32)ticks * (STEP_TIMER_RATE / PULSE_CLOCK_RATE);	// Timer1 counts at each level.
+	limit = (prevTop < seg->Top) ? prevTop : seg->Top;
+	last = (prevTop > seg->Top) ? prevTop : seg->Top;
+	meet = top = 0;
+	steps = meetSteps = topSteps = prevSteps = 0;
+	for (level = 1; level <= last; level++) {
+		steps += counts / table[level - 1];		// Steps from a stop up to this level.
+		if (level == prevTop)
+			prevSteps = steps;
+		if (level <= limit) {
+			if (steps < seg->Steps) {			// Can still stop from here.
+				meet = top = level;
+				meetSteps = topSteps = steps;
+			}
+		}
+		else if ((level <= seg->Top) && (top == level - 1) && (2 * steps - meetSteps <= seg->Steps)) {
+			top = level;						// Room to get up here and down again.
+			topSteps = steps;
+		}
+	}
+	if (top == 0) {								// Too short for any ramp.  Runs at the first
+		top = 1;								// level and stops dead from there.
+		topSteps = 0;
+	}
+	if (top < seg->Top) {
+		seg->Top = top;
+		seg->TopPeriod = (uint32)table[top - 1] << STEP_FRACTION_BITS;
+	}
+	seg->DownSteps = (topSteps < seg->Steps) ? topSteps : seg->Steps - 1;
+	*pPrevDown = prevSteps - meetSteps;
+	return(meet);
+}
+#endif
 
 /*
  *  FUNCTION: MotorMoveDistance
  *
  *  PARAMETERS:	device 		-- MOTOR_X or MOTOR_Z
  *				distance 	-- Distance in steps
- *				speed       -- Motor Speed in Hz up PULSE_CLOCK_RATE
+ *				speed       -- Motor Speed in Hz up to MAX_STEP_RATE
  *				dir 		-- Which direction to turn
  *				SpindleON 	-- Spindle needs to be turning if true
  *				useLimit	-- Make use of Limit switch or not.
@@ -440,18 +1501,20 @@ CalcuateSpindleSpeed(uint32 iTrkRatio) {
  *  USES GLOBALS:
  *				MotorState	-- for type of motion.
  *				Sets ZAcc	-- ACCEL_RATE_Z_NDX
+ *				Sets ZRampTop, ZTopPeriod, XRampTop and XTopPeriod for the interrupt routine.
  *
  *  DESCRIPTION:
  *
  *  RETURNS: 	0 if all is well, Non Zero error #'s
  *					MSG_SPINDLE_TO_FAST_ERROR
  *					MSG_MOTOR_STOPPED_ERROR
+ *					MSG_SPINDLE_INDEX_ERROR
  *
  */
 int8
 MotorMoveDistance( int8 device, 	// Motor X or Z
 				   int32 distance, 	// Distance in steps
-				   uint16 speed, 	// Speed in Hz up PULSE_POINT, 0 if we track spindle.
+				   uint16 speed, 	// Speed in Hz up to MAX_STEP_RATE, 0 if we track spindle.
 				   uint8 dir, 		// Which way to turn
 				   int8 SpindleON, 	// SPINDLE_TURNING or SPINDLE_EITHER
 				   int8 useLimit	// Make use of limit switch in distance move.
@@ -460,6 +1523,20 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
   int16 rpm;
   int32 vel;
   int32 halfway;
+  uint8 top;
+  uint32 period;
+  int8 track = 0;
+  int8 gear = 0;
+  uint8 gearTop = 0;					// A geared pass creeps at this level and period
+  uint32 creep = 0;						// and catches up at catchUp.
+  uint32 catchUp = 0;
+  int32 downSteps = 0;
+  int32 clocks = AveragedClocksPerRev;	// Spindle period the thread is cut at.
+  uint32 phase = 0;						// Spindle clocks after the index to start at.
+#ifdef RATIONAL_GEARING
+  uint32 num, den, g;					// Exact steps per rev or per encoder line.
+  int8 exact = 0;
+#endif
 
 	switch (device) {
 	  /*
@@ -468,21 +1545,61 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 	  */
 	  case MOTOR_Z :
 		fZDirectionCmd = dir;	// MOVE_LEFT is 0, MOVE_RIGHT is 1.
-		// Get acceleration from EEROM since it may have changed.		
-		ZAcc = GetGlobalVarLong(ACCEL_RATE_Z_NDX) << 5; 
-		
 		// Check if we are supposed to turn a specific speed relative to the spindle RPM.	
 		// Use MOVE rate if spindle stopped.
 		if (speed == SPEED_TRACK_SPINDLE) {	// speed == 0 if we track spindle.
 			// Figure out how fast the lead screw should turn.
 			LeadScrewRatio = SetupThreadDivision(MotionPitchIndex, &iTrackingRatio);  // Get number of stepper steps per spindle revolution.
 			speed = SetupMotorSpeed(iTrackingRatio);	// Get lead screw speed based on spindle RPM. 
+			track = 1;
+			// With a spindle encoder that has at least as many lines as steps per rev the
+			// interrupt routine gears the Z steps straight off the encoder lines.  It has to
+			// be able to catch up to them after ramping up.
+			gear = (SpindleLines > 1) && (LeadScrewRatio <= (float32)SpindleLines)
+					&& (speed <= MAX_STEP_RATE - MAX_STEP_RATE / (GEAR_CATCH_UP + 1));
+#ifdef RATIONAL_GEARING
+			exact = (SetupGearRatio(MotionPitchIndex, &num, &den) == 0);
+			if (exact && gear) {			// Per encoder line.
+				g = GreatestDivisor(num, SpindleLines);
+				num /= g;
+				g = SpindleLines / g;
+				exact = (den <= RATIONAL_MAX / g);
+				den *= g;
+			}
+#endif
+#ifdef SPINDLE_PREDICT_START
+			// The move waits for the next index so start at the period the spindle will have
+			// then rather than the one it has now.
+			clocks = PredictClocksPerRev(SpindleSlots);
+#endif
+#ifdef THREAD_PHASE_START
+			// Z was moved on along the thread by ThreadPhaseSteps() so start that much of a
+			// turn after the index.
+			if (!gear && (ZPhaseSteps != 0) && (ZMotorPosition == ZPhaseAt))
+				phase = (float32)labs(ZPhaseSteps) * clocks / LeadScrewRatio;
+			ZPhaseSteps = 0;
+#endif
+		}
+
+		// Get acceleration from EEROM since it may have changed.  Threading has to run at the
+		// spindle's speed so a short thread isn't slowed down to fit the S-curve.
+		speed = SetupRamp(MOTOR_Z, speed, (SpindleON == SPINDLE_TURNING) ? 0 : distance);
+		if (gear && (ZRampAcc != ZAcc) && !fZAxisActive && !fZMoveRQ) {
+			BuildRampTable(ZRampTable, ZAcc, 0, 0, &ZRampTicks);	// Catches up on the linear table.
+			ZRampAcc = ZAcc;
+			ZDecelSteps = 0;
 		}
 	
 		vel = (int32)speed << 16;
 		halfway = distance / 2;
 		rpm = PrintRPM(1,0);			// Show console serial output if Debug enabled, RPM, not SFM	
-		if (speed > PULSE_CLOCK_RATE) {
+		// A slot disk with no gap has no index to start every pass at the same place.
+		if ((SpindleON == SPINDLE_TURNING) && fXThreading && (SpindleSlots > 1)
+				&& (IndexMisses >= SPINDLE_INDEX_MISSES)) {
+			DEBUGSTR(", MOVEZ:No gap in the %d spindle slots for an index.\n", SpindleSlots);
+			return(MSG_SPINDLE_INDEX_ERROR);
+		}
+		if (speed > MAX_STEP_RATE) {
 			// Calculate target RPM based on close to but not quite top Stepper Motor Speed.
 			// TargetRPM is used in the ERROR screen showing current RPM and what it should be.
 			TargetRPM = (int16)CalcuateSpindleSpeed(iTrackingRatio);
@@ -490,6 +1607,22 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 			return(MSG_SPINDLE_TO_FAST_ERROR);
 		}
 		else { 
+			// Set point for the acceleration ramp.
+			period = (speed) ? STEP_PERIOD(speed) : 0;
+			// Threading steps at exactly the spindle's period over the steps per rev rather
+			// than at a whole number of Hz.
+			if (track && (speed != 0))
+				period = (float32)clocks * ((float32)STEP_TIMER_RATE * (1 << STEP_FRACTION_BITS) / SPINDLE_CLOCK_RATE)
+							/ LeadScrewRatio;
+			top = RampLevel(ZRampTable, period);
+			if (gear) {
+				// Catch up with the encoder 1/GEAR_CATCH_UP faster, then creep.
+				creep = period - (period >> GEAR_CREEP_SHIFT);
+				gearTop = RampLevel(ZRampTable, creep);
+				catchUp = period - period / (GEAR_CATCH_UP + 1);
+				top = RampLevel(ZRampTable, catchUp);
+				downSteps = GearDownSteps(top, gearTop, catchUp, period);
+			}
 			DEBUGSTR(", MOVEZ: Step Speed=%ld pps, Accel=%ld, ", vel>>16, ZAcc >> 5);
 			DEBUGSTR("Moving Z %ld steps to ", distance);
 			if (!dir) 
@@ -501,21 +1634,59 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 				
 				if (rpm > 0) {
 #ifdef TRACK_SPINDLE_SPEED
-					// Spindle Speed tracking variables get set up.  They can be done outside the interrupt
-					// routine because they aren't being used until fThreading is 1.
-					SpinRate = AveragedClocksPerRev; // 16MAR12 -- jcd -- Use average value since it's also used to 
-													 // calculate stepper motor rate.
-					// SpinRate = LastSpindleClocks;	// Get spindle clocks value used to calculate stepper rate.
-					SpinClip = SpinRate >> 1;		// Calculate ceiling to prevent overruns.
-					NegSpinRate = 0-SpinRate;		// Make the negative for faster calculation in interrupt routine.
+					SetupTracking(clocks, period);
+#ifdef RATIONAL_GEARING
+					if (exact && !gear)
+						SetupPitchLock(num, period);
+#endif
 #endif
 					INTCON &= 0x3F;
 					fZMoveRQ = 1;  				// On Spindle Index Interrupt the move will start.
+					ZStartPhase = phase;		// Or this far past it.
+					ZPhaseArmed = 0;
+#ifdef MOTION_QUEUE
+					ZRampEnd = 0;
+#endif
 					NewZVel = vel;				// Want to go this fast
+					ZRampTop = top;
+					ZTopPeriod = period;
+					fZSCurve = (ZDecelSteps != 0);
 					ZStepCount = distance;		// and this far.
 					ZHalfwayPoint = halfway;	// Halfway point if we never reach max speed decelerate here.
 					fUseLimits = useLimit;
-					fThreading = 1;				// Track spindle speed.
+					if (gear) {
+						// Steps per encoder line as an exact fraction, or with GEAR_SCALE
+						// resolution if it won't fit.  Counted from the index like a half
+						// nut engaging there while Z ramps up and catches up.
+#ifdef RATIONAL_GEARING
+						if (exact) {
+							GearNumerator = num;
+							GearDenominator = den;
+						}
+						else
+#endif
+						{
+							GearNumerator = (uint32)(LeadScrewRatio * GEAR_SCALE + 0.5);
+							GearDenominator = (uint32)SpindleLines * GEAR_SCALE;
+						}
+						ZTopPeriod = catchUp;
+						ZGearTop = gearTop;
+						ZGearPeriod = creep;
+						ZGearDownSteps = downSteps;
+						fZSCurve = 1;			// Stops dead on its last step.
+						fGearing = 1;
+						fThreading = 0;
+					}
+					else {
+						fGearing = 0;
+						fThreading = 1;			// Track spindle speed.
+#ifdef RATIONAL_GEARING
+						// And hold it to the exact pitch.
+						GearNumerator = num;
+						GearDenominator = den;
+						fPitchLock = exact;
+#endif
+					}
 					INTCON |= 0xC0;
 					
 					DEBUGSTR("Waiting for Index Pulse\n");
@@ -532,10 +1703,16 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 				fUseLimits = useLimit;
 				if (!fZMoveBSY) {
 					fZDeccel = 0;			// Not decelerating yet.
-					StepsToZVel = 0;		// Keep track of how int32 it takes to get to velocity.
+					StepsToZVel = ZDecelSteps;	// 0 keeps track of how long it takes to get to velocity.
+					fZSCurve = (ZDecelSteps != 0);	// An S-curve already knows where to slow down.
 					fZUpToSpeed = 0;		// Motor isn't up to speed yet.
 					fZStopping = 0;			// Nor is it stopping.
+#ifdef MOTION_QUEUE
+					ZRampEnd = 0;			// Stops at the end.
+#endif
 					MaxZVel = vel;			// Want to go this fast.
+					ZRampTop = top;
+					ZTopPeriod = period;
 					ZStepCount = distance;	// and this far.
 					fZMoveBSY = 1;			// Manual Non-sync'd move so we set that the motor is busy.
 					fZAxisActive = 1;		// Enable Z axis interrupt handling.
@@ -545,6 +1722,10 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 						fZDeccel = 0;			// Not decelerating anymore
 						fZUpToSpeed = 0;		// Motor isn't up to speed again
 						MaxZVel = vel;			// Want to go this fast since we're not stopping.
+						ZRampTop = top;
+						ZTopPeriod = period;
+						if (fZSCurve)
+							StepsToZVel = ZDecelSteps;
 					}
 					ZStepCount += distance;	// Motor is already turning so just increase how far to go.
 				}
@@ -555,10 +1736,6 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 
 	  case MOTOR_X :
 #ifdef X_AXIS
-		// Get acceleration from EEROM since it may have changed.		
-		XAcc = GetGlobalVarLong(ACCEL_RATE_X_NDX) << 5;
-		
-		NewXVel = (int32)speed << 16;
 #ifdef DIRECT_MODE_ENABLED
 		distance = (fMXDirectMode) ? distance<<1 : distance;
 #endif
@@ -575,11 +1752,17 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 	    // Set Motor Direction based on flag which tells us what polarity a minus direction is.
 		fXDirection = fMXInvertDirMotor ^ dir;
 
-		if (speed > PULSE_CLOCK_RATE) {
+		// Get acceleration from EEROM since it may have changed.
+		speed = SetupRamp(MOTOR_X, speed, distance);
+		NewXVel = (int32)speed << 16;
+
+		if (speed > MAX_STEP_RATE) {
 			DEBUGSTR("MOVEX:Stepper speed %ld  too high.\n", NewXVel>>16);
 			return(MSG_SPINDLE_TO_FAST_ERROR);
 		}
 		else { 
+			period = (speed) ? STEP_PERIOD(speed) : 0;
+			top = RampLevel(XRampTable, period);
 			DEBUGSTR("MOVEX: Step Speed=%ld pps, ", NewXVel>>16);
 			DEBUGSTR("Moving X %ld steps ", distance);
 			if (!dir) 
@@ -591,10 +1774,16 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 			fUseLimits = useLimit;
 			if (!fXMoveBSY) {
 				fXDeccel = 0;			// Not decelerating.
-				StepsToXVel = 0;		// Keep track of how int32 it to get to velocity.
+				StepsToXVel = XDecelSteps;	// 0 keeps track of how long it takes to get to velocity.
+				fXSCurve = (XDecelSteps != 0);
 				fXUpToSpeed = 0;		// Not up to speed yet.
 				fXStopping = 0;			// So not stopping yet.
+#ifdef MOTION_QUEUE
+				XRampEnd = 0;
+#endif
 				MaxXVel = NewXVel;		// This is how fast to go
+				XRampTop = top;
+				XTopPeriod = period;
 				XStepCount = distance; 	// and this is how far.
 				fXMoveBSY = 1;			// It's a programmed distance so flag we're busy.
 				fXAxisActive = 1;		// Enable X axis Pulse Clock interrupt handling.
@@ -610,6 +1799,254 @@ MotorMoveDistance( int8 device, 	// Motor X or Z
 	return(0);
 }
 
+#ifdef MOTION_QUEUE
+/*
+ *  FUNCTION: MotorQueueMove
+ *
+ *  PARAMETERS:	device 		-- MOTOR_X or MOTOR_Z
+ *				distance 	-- Distance in steps
+ *				speed       -- Motor Speed in Hz up to MAX_STEP_RATE, 0 to thread.
+ *				dir 		-- Which direction to turn
+ *
+ *  USES GLOBALS:	ZQueue, ZQueueHead, ZQueueTail, ZRampEnd and the X equivalents.
+ *					Sets ZAcc and XAcc.
+ *
+ *  DESCRIPTION: Adds a segment to the axis's motion queue, or starts it straight away if the
+ *				 axis is stopped.  The segment in front, whether still queued or already running,
+ *				 is told to slow down only to the level PlanSegment() says the two meet at so the
+ *				 interrupt routine goes from one to the other without stopping.  A running
+ *				 segment that has already started slowing down stops first.
+ *				 A Z threading segment waits for the index.  Its spindle tracking is set up here
+ *				 unless a pass is already threading, in which case it uses that pass's figures.
+ *				 Queued threads don't use the encoder gearbox.  X segments don't thread.
+ *
+ *  RETURNS: 	0 if all is well, -1 if the queue is full or an S-curve move has to finish
+ *				first, Non Zero error #'s
+ *					MSG_MOTOR_DISTANCE_ERROR
+ *					MSG_SPINDLE_TO_FAST_ERROR
+ *					MSG_MOTOR_STOPPED_ERROR
+ *
+ */
+int8
+MotorQueueMove(int8 device, int32 distance, uint16 speed, uint8 dir) {
+  MOTION_SEGMENT seg;
+  MOTION_SEGMENT * prev;
+  uint8 head, prevTop, meet, last;
+  int32 prevDown;
+  int32 clocks;
+  float32 res;
+
+	if (distance <= 0)
+		return(MSG_MOTOR_DISTANCE_ERROR);
+	seg.Backlash = 0;
+	seg.End = 0;
+	seg.Sync = SEGMENT_FREE;
+
+	switch (device) {
+	  case MOTOR_Z :
+		head = ZQueueHead;
+		if (((head + 1) & SEGMENT_QUEUE_MASK) == ZQueueTail)
+			return(-1);
+		ZAcc = GetGlobalVarLong(ACCEL_RATE_Z_NDX) << 5;
+		if (!fZAxisActive && !fZMoveRQ) {
+			if (ZAcc != ZRampAcc) {			// The queue runs on the linear table.
+				BuildRampTable(ZRampTable, ZAcc, 0, 0, &ZRampTicks);
+				ZRampAcc = ZAcc;
+			}
+		}
+		else if (ZRampAcc == 0)				// An S-curve move has the table.
+			return(-1);
+
+		if (speed == SPEED_TRACK_SPINDLE) {
+			if (AverageRPM <= 0)
+				return(MSG_MOTOR_STOPPED_ERROR);
+			LeadScrewRatio = SetupThreadDivision(MotionPitchIndex, &iTrackingRatio);
+			speed = SetupMotorSpeed(iTrackingRatio);
+			seg.Sync = SEGMENT_INDEX;
+		}
+		if (speed > MAX_STEP_RATE) {
+			TargetRPM = (int16)CalcuateSpindleSpeed(iTrackingRatio);
+			return(MSG_SPINDLE_TO_FAST_ERROR);
+		}
+		if (speed == 0)
+			return(MSG_MOTOR_STOPPED_ERROR);
+		seg.TopPeriod = STEP_PERIOD(speed);
+		if (seg.Sync == SEGMENT_INDEX) {
+			clocks = AveragedClocksPerRev;
+#ifdef SPINDLE_PREDICT_START
+			clocks = PredictClocksPerRev(SpindleSlots);
+#endif
+			seg.TopPeriod = (float32)clocks * ((float32)STEP_TIMER_RATE * (1 << STEP_FRACTION_BITS) / SPINDLE_CLOCK_RATE)
+								/ LeadScrewRatio;
+#ifdef TRACK_SPINDLE_SPEED
+			if (!fThreading)
+				SetupTracking(clocks, seg.TopPeriod);
+#endif
+		}
+		seg.Steps = distance;
+		seg.Dir = dir;
+		seg.Top = RampLevel(ZRampTable, seg.TopPeriod);
+
+		// The last queued segment, or a queued segment that's running and hasn't started
+		// slowing down, can run on into this one if it goes the same way.
+		prevTop = 0;
+		INTCON &= 0x3F;
+		if (ZQueueTail != head) {
+			prev = &ZQueue[(head - 1) & SEGMENT_QUEUE_MASK];
+			if ((prev->Dir == dir) && (prev->Sync == SEGMENT_FREE))
+				prevTop = prev->Top;
+		}
+		else if (fZMoveBSY && fZSCurve && !fThreading && (StepsToZVel >= 0) && (fZDirectionCmd == dir))
+			prevTop = ZRampTop;
+		INTCON |= 0xC0;
+		if (seg.Sync != SEGMENT_FREE)
+			prevTop = 0;
+		meet = PlanSegment(ZRampTable, ZRampTicks, &seg, prevTop, &prevDown);
+		DEBUGSTR("QUEUEZ: %ld steps at level %d, meets the last at %d\n", seg.Steps, seg.Top, meet);
+
+		// The interrupt routine may have moved on while that was worked out.
+		INTCON &= 0x3F;
+		if (ZQueueTail != head) {			// The one in front is still queued.
+			if (meet) {
+				prev = &ZQueue[(head - 1) & SEGMENT_QUEUE_MASK];
+				prev->End = meet;
+				prev->DownSteps = (prevDown < prev->Steps) ? prevDown : prev->Steps - 1;
+			}
+			ZQueue[head] = seg;
+			ZQueueHead = (head + 1) & SEGMENT_QUEUE_MASK;
+		}
+		else if (fZMoveBSY || fZMoveRQ) {	// Running or waiting for the index.
+			if (meet && fZMoveBSY && fZSCurve && (StepsToZVel >= 0) && (fZDirectionCmd == dir)
+					&& (ZRampTop == prevTop) && (ZStepCount > prevDown)) {
+				StepsToZVel = prevDown;
+				ZRampEnd = meet;
+			}
+			ZQueue[head] = seg;
+			ZQueueHead = (head + 1) & SEGMENT_QUEUE_MASK;
+		}
+		else {								// Stopped so start it now.
+			fZDirectionCmd = dir;
+			ZStepCount = seg.Steps;
+			ZRampTop = seg.Top;
+			ZTopPeriod = seg.TopPeriod;
+			ZRampEnd = 0;
+			fZSCurve = 1;
+			if (seg.Sync == SEGMENT_INDEX) {
+				ZDecelSteps = seg.DownSteps;
+				ZStartPhase = 0;			// Right on the index.
+				ZPhaseArmed = 0;
+				fGearing = 0;
+				fThreading = 1;
+#ifdef RATIONAL_GEARING
+				fPitchLock = 0;				// Segments run at their own rates.
+#endif
+				fZMoveRQ = 1;
+			}
+			else {
+				StepsToZVel = seg.DownSteps;
+				fZDeccel = 0;
+				fZUpToSpeed = 0;
+				fZStopping = 0;
+				fZMoveBSY = 1;
+				fZAxisActive = 1;
+			}
+		}
+		INTCON |= 0xC0;
+		break;
+
+	  case MOTOR_X :
+#ifdef X_AXIS
+#ifdef DIRECT_MODE_ENABLED
+		distance = (fMXDirectMode) ? distance<<1 : distance;
+#endif
+		head = XQueueHead;
+		if (((head + 1) & SEGMENT_QUEUE_MASK) == XQueueTail)
+			return(-1);
+		XAcc = GetGlobalVarLong(ACCEL_RATE_X_NDX) << 5;
+		if (!fXAxisActive) {
+			if (XAcc != XRampAcc) {
+				BuildRampTable(XRampTable, XAcc, 0, 0, &XRampTicks);
+				XRampAcc = XAcc;
+			}
+		}
+		else if (XRampAcc == 0)
+			return(-1);
+
+		if (speed > MAX_STEP_RATE)
+			return(MSG_SPINDLE_TO_FAST_ERROR);
+		if (speed == SPEED_TRACK_SPINDLE)
+			return(MSG_MOTOR_STOPPED_ERROR);
+		seg.TopPeriod = STEP_PERIOD(speed);
+		seg.Dir = fMXInvertDirMotor ^ dir;
+		seg.Top = RampLevel(XRampTable, seg.TopPeriod);
+
+		prevTop = 0;
+		INTCON &= 0x3F;
+		if (XQueueTail != head) {
+			prev = &XQueue[(head - 1) & SEGMENT_QUEUE_MASK];
+			last = prev->Dir;
+			if (prev->Dir == seg.Dir)
+				prevTop = prev->Top;
+		}
+		else {
+			last = fXDirection;
+			if (fXMoveBSY && fXSCurve && (XStepCount > StepsToXVel) && (fXDirection == seg.Dir))
+				prevTop = XRampTop;
+		}
+		INTCON |= 0xC0;
+		// Take up the backlash if it turns round.
+		if (seg.Dir != last) {
+			res = GetGlobalVarFloat(X_AXIS_BACKLASH_NDX);
+			if (fMetricMode)
+				res = res * 25.4;
+			seg.Backlash = CalculateMotorDistance(res, XDistanceDivisor, fMetricMode);
+		}
+		seg.Steps = distance + seg.Backlash;
+		meet = PlanSegment(XRampTable, XRampTicks, &seg, prevTop, &prevDown);
+		DEBUGSTR("QUEUEX: %ld steps at level %d, meets the last at %d\n", seg.Steps, seg.Top, meet);
+
+		INTCON &= 0x3F;
+		if (XQueueTail != head) {
+			if (meet) {
+				prev = &XQueue[(head - 1) & SEGMENT_QUEUE_MASK];
+				prev->End = meet;
+				prev->DownSteps = (prevDown < prev->Steps) ? prevDown : prev->Steps - 1;
+			}
+			XQueue[head] = seg;
+			XQueueHead = (head + 1) & SEGMENT_QUEUE_MASK;
+		}
+		else if (fXMoveBSY) {
+			if (meet && fXSCurve && (XStepCount > StepsToXVel) && (fXDirection == seg.Dir)
+					&& (XRampTop == prevTop) && (XStepCount > prevDown)) {
+				StepsToXVel = prevDown;
+				XRampEnd = meet;
+			}
+			XQueue[head] = seg;
+			XQueueHead = (head + 1) & SEGMENT_QUEUE_MASK;
+		}
+		else {
+			fXDirection = seg.Dir;
+			XBackLashCount = seg.Backlash;
+			XStepCount = seg.Steps;
+			StepsToXVel = seg.DownSteps;
+			XRampTop = seg.Top;
+			XTopPeriod = seg.TopPeriod;
+			XRampEnd = 0;
+			fXSCurve = 1;
+			fXDeccel = 0;
+			fXUpToSpeed = 0;
+			fXStopping = 0;
+			fXMoveBSY = 1;
+			fXAxisActive = 1;
+		}
+		INTCON |= 0xC0;
+#endif
+		break;
+	}
+	return(0);
+}
+#endif
+
 /*
  *  FUNCTION: MotorMoveTo
  *
@@ -689,6 +2126,214 @@ MotorMoveTo( int8 device, 	// Motor X or Z
 	}
 }
 
+#ifdef TAPERING
+/*
+ *  FUNCTION: MotorTaperMove
+ *
+ *  PARAMETERS: position	-- Where Z is to end up in steps.
+ *
+ *  USES GLOBALS:	TaperTangent, TAccumulator, fTaperXMaster, fTaperDirection,
+ *					SystemZBackLashCount, MotionPitchIndex, iTrackingRatio
+ *
+ *  DESCRIPTION: A taper steeper than one X step per Z step is cut with X as the master
+ *				 and the interrupt routine steps Z off the carry out of TAccumulator.  X
+ *				 is given just enough steps for Z to get to position, including Z's
+ *				 backlash if it turns round since that comes out of the first Z steps.
+ *				 X steps at the rate Z would have for the feed so the master axis runs
+ *				 at the same rate either side of 45 degrees in steps.  A thread has to
+ *				 be cut off the spindle on Z so that can't be done.  Nor can a face:
+ *				 with TaperTangent 0 Z never moves so there's no X distance to get to
+ *				 position with.
+ *
+ *  RETURNS: Result of MotorMoveDistance or MSG_TAPER_TOO_BIG_ERROR
+ *
+ */
+int8
+MotorTaperMove(int32 position) {
+  uint8 dir;
+  int32 distance;
+  int32 speed;
+  int8 err;
+
+	if (fXThreading || (TaperTangent == 0))
+		return(MSG_TAPER_TOO_BIG_ERROR);
+
+	INTCON &= 0x3F;
+		CurrentZPosition = ZMotorPosition;
+	INTCON |= 0xC0;
+	if (position == CurrentZPosition)
+		return(0);
+	dir = (position < CurrentZPosition) ? MOVE_LEFT : MOVE_RIGHT;
+	distance = labs(position - CurrentZPosition);
+	if ((dir ^ fMZInvertDirMotor) != bMZDirectionMotor)
+		distance += SystemZBackLashCount;
+
+	LeadScrewRatio = SetupThreadDivision(MotionPitchIndex, &iTrackingRatio);
+	speed = SetupMotorSpeed(iTrackingRatio);
+	if (speed == 0)
+		return(MSG_MOTOR_STOPPED_ERROR);
+	if (speed > MAX_STEP_RATE)
+		return(MSG_SPINDLE_TO_FAST_ERROR);
+
+	INTCON &= 0x3F;
+	fZDirectionCmd = dir;		// Which way the Z steps go.
+	TAccumulator = 0;
+	fTaperXMaster = 1;
+	INTCON |= 0xC0;
+	// Enough X steps for the carry to come round distance times.
+	err = MotorMoveDistance(MOTOR_X, (int32)ceil((float32)distance * 4294967296.0 / TaperTangent), (uint16)speed,
+						((dir ^ fTaperDirection) == 1) ? MOVE_IN : MOVE_OUT, SPINDLE_EITHER, TRUE);
+	if (err != 0)
+		fTaperXMaster = 0;
+	return(err);
+}
+#endif
+
+#ifdef CIRCULAR_INTERPOLATION
+static int32 ArcRatio;			// Z steps per spindle rev of the feed * PULSE_CLOCK_RATE.
+static float32 ArcFeedScale;	// ArcFeed for each Z step per second of feed.
+
+/*
+ *  FUNCTION: MotorArcMove
+ *
+ *  PARAMETERS: zEnd, xEnd			-- Where the arc ends in steps.
+ *				zCentre, xCentre	-- Centre of the circle in steps.
+ *
+ *  USES GLOBALS:	ZDistanceDivisor, XDistanceDivisor, MotionPitchIndex, SystemZBackLashCount
+ *					and the arc variables in Int.h.
+ *
+ *  DESCRIPTION: Cut an arc from where the tool is to zEnd, xEnd about the centre at the
+ *				 feed per spindle rev of MotionPitchIndex.  Neither end may be across an axis
+ *				 through the centre from the other so X and Z each only go one way; a ball
+ *				 is a quarter circle.  The error terms are weighted by 1/(steps per inch)^2
+ *				 so it's round in inches and scaled up as far as ARC_TERM_MAX allows.  The
+ *				 step lengths are in 1/65536 of a step of the finer axis.  Backlash on
+ *				 either axis is taken up before the arc starts.  The end only has to be
+ *				 near the circle since whichever axis has steps left finishes straight.
+ *
+ *  RETURNS: 0 if the arc started or there's nowhere to go, otherwise an error.
+ *
+ */
+int8
+MotorArcMove(int32 zEnd, int32 xEnd, int32 zCentre, int32 xCentre) {
+  int32 x, z;
+  float32 wx, wz, k, fine, res;
+  uint8 xDir, zDir;
+  int16 xLead, zLead;
+  int8 err;
+
+	if (fArcing || fZMoveBSY || fZMoveRQ)
+		return(MSG_MOTOR_DISTANCE_ERROR);
+	INTCON &= 0x3F;
+		CurrentZPosition = ZMotorPosition;
+		CurrentXPosition = XMotorRelPosition;
+	INTCON |= 0xC0;
+	x = CurrentXPosition - xCentre;
+	z = CurrentZPosition - zCentre;
+	xEnd -= xCentre;
+	zEnd -= zCentre;
+	if (((x < 0) && (xEnd > 0)) || ((x > 0) && (xEnd < 0)) || ((z < 0) && (zEnd > 0)) || ((z > 0) && (zEnd < 0)))
+		return(MSG_MOTOR_DISTANCE_ERROR);		// More than a quarter.
+	if ((x == xEnd) && (z == zEnd))
+		return(0);
+	xDir = (xEnd > x) ? MOVE_OUT : MOVE_IN;
+	zDir = (zEnd > z) ? MOVE_RIGHT : MOVE_LEFT;
+
+	// Scale the weights so the biggest term anywhere on the arc is ARC_TERM_MAX.
+	wx = 1.0 / (XDistanceDivisor * XDistanceDivisor);
+	wz = 1.0 / (ZDistanceDivisor * ZDistanceDivisor);
+	k = wx * (2.0 * ((labs(x) > labs(xEnd)) ? labs(x) : labs(xEnd)) + 1.0);
+	res = wz * (2.0 * ((labs(z) > labs(zEnd)) ? labs(z) : labs(zEnd)) + 1.0);
+	if (res > k)
+		k = res;
+	k = (float32)ARC_TERM_MAX / k;
+	wx = floor(wx * k + 0.5);
+	wz = floor(wz * k + 0.5);
+	if (wx < 1.0)
+		wx = 1.0;
+	if (wz < 1.0)
+		wz = 1.0;
+
+	// Step lengths.
+	fine = (XDistanceDivisor > ZDistanceDivisor) ? XDistanceDivisor : ZDistanceDivisor;
+	fine *= 65536.0;
+	ArcXCost = fine / XDistanceDivisor + 0.5;
+	ArcZCost = fine / ZDistanceDivisor + 0.5;
+	ArcXZCost = fine * sqrt(1.0 / (XDistanceDivisor * XDistanceDivisor) + 1.0 / (ZDistanceDivisor * ZDistanceDivisor)) + 0.5;
+	ArcFeedScale = (float32)ArcZCost / PULSE_CLOCK_RATE;
+	LeadScrewRatio = SetupThreadDivision(MotionPitchIndex, &ArcRatio);
+	if ((err = ArcFeedRate()) != 0)
+		return(err);
+
+	// Backlash to take up first if either axis turns round.
+	zLead = ((zDir ^ fMZInvertDirMotor) != bMZDirectionMotor) ? SystemZBackLashCount : 0;
+	xLead = 0;
+	if ((fMXInvertDirMotor ^ xDir) != fXDirection) {
+		res = GetGlobalVarFloat(X_AXIS_BACKLASH_NDX);
+		if (fMetricMode)
+			res = res * 25.4;
+		xLead = CalculateMotorDistance(res, XDistanceDivisor, fMetricMode);
+	}
+	DEBUGSTR("ARC: X %ld, Z %ld steps\n", labs(xEnd - x), labs(zEnd - z));
+
+	INTCON &= 0x3F;
+	fZDirectionCmd = zDir;
+	fXDirection = fMXInvertDirMotor ^ xDir;
+	ArcXLeft = labs(xEnd - x);
+	ArcZLeft = labs(zEnd - z);
+	ArcXInc = 2 * (int32)wx;
+	ArcZInc = 2 * (int32)wz;
+	ArcXTerm = (int32)wx * (((xDir == MOVE_OUT) ? 2 * x : -2 * x) + 1);
+	ArcZTerm = (int32)wz * (((zDir == MOVE_RIGHT) ? 2 * z : -2 * z) + 1);
+	ArcError = 0;					// The circle goes through where the tool is.
+	ArcXLead = xLead;
+	ArcZLead = zLead;
+	ArcDistance = 0;
+	ArcNext = 0;					// The first time round only picks the first step.
+	ArcCost = ArcXZCost;
+	fArcing = 1;
+	INTCON |= 0xC0;
+	return(0);
+}
+
+/*
+ *  FUNCTION: ArcFeedRate
+ *
+ *  PARAMETERS: None
+ *
+ *  USES GLOBALS:	ArcRatio, ArcFeedScale, AveragedClocksPerRev, ArcFeed
+ *
+ *  DESCRIPTION: Sets the arc's feed for the spindle speed.  MotorDevice() calls it on
+ *				 each new revolution so the feed per rev holds as the spindle drifts.  The
+ *				 pulse clock can only take one step each time round so the feed is held
+ *				 to that.
+ *
+ *  RETURNS: 0, MSG_MOTOR_STOPPED_ERROR or MSG_SPINDLE_TO_FAST_ERROR if it had to be held.
+ *
+ */
+int8
+ArcFeedRate(void) {
+  uint32 feed;
+  int8 err = 0;
+
+	feed = (float32)SetupMotorSpeed(ArcRatio) * ArcFeedScale;
+	if (feed == 0)
+		err = MSG_MOTOR_STOPPED_ERROR;
+	if (feed > ArcXCost) {
+		feed = ArcXCost;
+		err = MSG_SPINDLE_TO_FAST_ERROR;
+	}
+	if (feed > ArcZCost) {
+		feed = ArcZCost;
+		err = MSG_SPINDLE_TO_FAST_ERROR;
+	}
+	INTCON &= 0x3F;
+	ArcFeed = feed;
+	INTCON |= 0xC0;
+	return(err);
+}
+#endif
+
 
 /*
  *  FUNCTION: MotorJog
@@ -700,6 +2345,7 @@ MotorMoveTo( int8 device, 	// Motor X or Z
  *  USES GLOBALS: 	TURN_PITCH_NDX
   *					MOVE_RATE_Z_NDX
  *					iTrackingRatio
+ *					Sets ZRampTop, ZTopPeriod, XRampTop and XTopPeriod for the interrupt routine.
  *
  *  DESCRIPTION:
  *					Set up variables and data structures and interrupt routine to do continuous
@@ -718,6 +2364,8 @@ MotorJog( int8 device,	  	// Which motor
   uint8 deccelFlag;
   int32 trackingRatio;
   int32 vel;
+  uint8 top;
+  uint32 period;
 
 
 	switch (device) {
@@ -737,6 +2385,7 @@ MotorJog( int8 device,	  	// Which motor
 		}
 	
 		MotorState = MOTOR_JOGGING;
+		SetupRamp(MOTOR_Z, speed, 0);
 
 		INTCON &= 0x3F;
 			vel = MaxZVel;		// Copy 32 bit value from interrupt routine.
@@ -751,6 +2400,8 @@ MotorJog( int8 device,	  	// Which motor
 	
 		vel = speed;
 		vel = vel << 16;		// Now make a 32 bit variable of target speed.
+		period = (speed) ? STEP_PERIOD(speed) : 0;
+		top = RampLevel(ZRampTable, period);
 
 		INTCON &= 0x3F;
 			if (deccelFlag) {
@@ -764,6 +2415,8 @@ MotorJog( int8 device,	  	// Which motor
 			}			
 			NewZVel = vel;				// Make a 32 bit copy for others.
 			MaxZVel = NewZVel;			// Transfer 32 bit velocity value to interrupt routine.
+			ZRampTop = top;
+			ZTopPeriod = period;
 
 			// Still need to tell Interrupt routine that direction has changed and motor needs to 
 			// decelerate to 0 first and then accelerate but for now we'll do an abrupt reversal if 
@@ -779,6 +2432,7 @@ MotorJog( int8 device,	  	// Which motor
 	  case MOTOR_X :
 
 		MotorState = MOTOR_JOGGING;
+		SetupRamp(MOTOR_X, speed, 0);
 		INTCON &= 0x3F;
 			vel = MaxXVel;		// Copy 32 bit value from interrupt routine.
 		INTCON |= 0xC0;	// go.
@@ -792,6 +2446,8 @@ MotorJog( int8 device,	  	// Which motor
 	
 		vel = speed;
 		vel = vel << 16;
+		period = (speed) ? STEP_PERIOD(speed) : 0;
+		top = RampLevel(XRampTable, period);
 	
 		INTCON &= 0x3F;
 			if (deccelFlag) {
@@ -805,6 +2461,8 @@ MotorJog( int8 device,	  	// Which motor
 			}
 			NewXVel = vel;				// Make a 32 bit copy for others.
 			MaxXVel = NewXVel;
+			XRampTop = top;
+			XTopPeriod = period;
 			// Still need to tell Interrupt routine that direction has changed and motor needs to 
 			// decelerate to 0 first and then accelerate but for now we'll do an abrupt reversal if 
 			// requested.
@@ -827,11 +2485,13 @@ MotorJog( int8 device,	  	// Which motor
  *						-- Z Axis
  *						fZDeccel		Tell Z Motor to decelerate
  *						MaxZVel			Velocity gets set to 0
+ *						ZRampTop		Ramp down to level 0
  *						fZMoveBSY		Cancel move.
  *						fZMoveRQ		
  *						-- X Axis
  *						fXDeccel		Tell Z Motor to decelerate
  *						MaxXVel			Velocity gets set to 0
+ *						XRampTop		Ramp down to level 0
  *						fXMoveBSY		Cancel Move.
  *						fXMoveRQ		
  *
@@ -850,8 +2510,24 @@ MotorStop(int8 device) {
 		INTCON &= 0x3F;
 		fZDeccel = 1;		// Tell interrupt routine to decelerate the motor.
 		MaxZVel = 0;		// to speed 0.
+		ZRampTop = 0;
+		ZTopPeriod = 0;
 		fZMoveBSY = 0;		// Cancenl any current moves.
 		fZMoveRQ = 0;		// Ack the requests.
+		fGearing = 0;		// and stop taking steps from the spindle encoder.
+#ifdef RATIONAL_GEARING
+		fPitchLock = 0;
+#endif
+#ifdef MOTION_QUEUE
+		ZQueueTail = ZQueueHead;	// Nothing more to come.
+		ZRampEnd = 0;
+#endif
+#ifdef CIRCULAR_INTERPOLATION
+		fArcing = 0;		// An arc stops dead.  It's only ever at a feed rate.
+#endif
+#ifdef THREAD_PULL_OUT
+		PullOutFlags.Byte = 0;	// X stops where it got to.
+#endif
 		INTCON |= 0xC0;		// go.
 		break;
 
@@ -860,8 +2536,23 @@ MotorStop(int8 device) {
 		INTCON &= 0x3F;
 		fXDeccel = 1;
 		MaxXVel = 0;
+		XRampTop = 0;
+		XTopPeriod = 0;
 		fXMoveBSY = 0;
 		fXMoveRQ = 0;
+#ifdef TAPERING
+		fTaperXMaster = 0;
+#endif
+#ifdef CIRCULAR_INTERPOLATION
+		fArcing = 0;
+#endif
+#ifdef THREAD_PULL_OUT
+		PullOutFlags.Byte = 0;
+#endif
+#ifdef MOTION_QUEUE
+		XQueueTail = XQueueHead;
+		XRampEnd = 0;
+#endif
 		INTCON |= 0xC0;	// go.
 		break;
 	}
@@ -880,15 +2571,23 @@ MotorStop(int8 device) {
  *						AveragedClocksPerRev
  *						fUpdatedRPM
  *						AverageRPM
- *						RPMAverage	   				-- Array
- *						RPMAverageIndex				-- Index into array
+ *						SpindlePeriodEst
+ *						SpindlePeriodRate
  *
  *  DESCRIPTION:		Motor device used to track spindle speed and adjust Z axis stepper.
  *						However, loop time is too long between new RPM value, calculations
  *						and updating stepper speed so the concept has been scrapped.
- *						Instead the MotorDevice monitors spindle RPM, averages the value
+ *						Instead the MotorDevice monitors spindle RPM, filters the value
  *						and updates AverageRPM for display and for calculating initial 
  *						stepper speed.
+ *						The filter is an alpha-beta tracker.  It keeps the period and its
+ *						rate of change so a spindle that is speeding up or slowing down under
+ *						load doesn't leave the estimate lagging 8 updates behind the way the
+ *						old 16 bucket box average did.
+ *						A sensor with more than one slot per rev gives a new revolution time
+ *						on every slot so the rate is per slot rather than per revolution.
+ *						The estimate is advanced over every update the interrupt counted in
+ *						SpindleUpdates, not just the ones this loop got to.
  *
  *  RETURNS: 			Nothing
  *
@@ -897,7 +2596,8 @@ void
 MotorDevice(void) {
   int8 i;				// Loop counter
   int8 deccelFlag;
-  static int32 PulseClocksRunningTotal = 0;
+  float32 predicted, residual;
+  uint8 updates;
   static int8 cycleCount = 0;
   static int8 averageSampleCount = 0;
 
@@ -912,6 +2612,7 @@ MotorDevice(void) {
 			fSpindleInterrupt = 0;				// Clear semaphore.
 			SpindleClocksPerRevolution = 0;		// Trash first value.
 			fUpdatedRPM = 0;					// RPM not valid yet.
+			SpindleUpdates = 0;
 			StartTimer(MOTOR_TIMER, T_2_5SEC); 	// Spindle turning timeout timer.
 			RPMState = RPM_STARTING;			// Need a full turn for RPM so nothing else is done.
 		}
@@ -927,17 +2628,14 @@ MotorDevice(void) {
 			fSpindleInterrupt = 0;				// Clear semaphore.
 			LastSpindleClocks = SpindleClocksPerRevolution;	// Grab time for one rev.
 			fUpdatedRPM = 0;					// Flag that we've got it.
+			SpindleUpdates = 0;
 			INTCON |= 0xC0;						// Done touching common variables.
 
 			if (LastSpindleClocks > 0) {
-				PulseClocksRunningTotal = 0;
-				for (RPMAverageIndex=0; RPMAverageIndex<16; RPMAverageIndex++) {
-					RPMAverage[RPMAverageIndex]	= LastSpindleClocks;	// Make all filter boxes the same to start with.
-					PulseClocksRunningTotal += LastSpindleClocks;
-				}
-				RPMAverageIndex=0;
-				AveragedClocksPerRev = PulseClocksRunningTotal / 16;				
-				AverageRPM = (int16)((PULSE_CLOCK_RATE * 60L) / (int32)AveragedClocksPerRev);
+				SpindlePeriodEst = (float32)LastSpindleClocks;	// Start the estimate at the first period
+				SpindlePeriodRate = 0;							// with the speed holding steady.
+				AveragedClocksPerRev = LastSpindleClocks;
+				AverageRPM = (int16)((SPINDLE_CLOCK_RATE * 60L) / (int32)AveragedClocksPerRev);
 				RPMState = RPM_STEADY;
 			}
 			else {
@@ -954,7 +2652,7 @@ MotorDevice(void) {
 		break;
 
 	  /*
-	   	Accumulate spindle period averaging in RPMAverage[]
+	   	Track the spindle period and its rate of change.
 	  */	
 	  case RPM_STEADY :
 		INTCON &= 0x3F;							// Interrupt touches these variables.
@@ -962,15 +2660,20 @@ MotorDevice(void) {
 			fSpindleInterrupt = 0;				// Clear semaphore.
 			LastSpindleClocks = SpindleClocksPerRevolution;	// Grab time for one rev.
 			fUpdatedRPM = 0;					// Flag that we've got it.
+			updates = SpindleUpdates;			// Updates since the last one we took.
+			SpindleUpdates = 0;
 			INTCON |= 0xC0;						// Done touching common variables.
+			if (updates == 0)
+				updates = 1;
 			
-			PulseClocksRunningTotal -= RPMAverage[RPMAverageIndex];	 	// Subtract oldest value.
-			RPMAverage[RPMAverageIndex++] = LastSpindleClocks;			// replace oldest value. 	
-			RPMAverageIndex &= 0xf;										// Wrap index around circular buffer.
-			PulseClocksRunningTotal += LastSpindleClocks;			 	// Add in newest value.
-			AveragedClocksPerRev = PulseClocksRunningTotal >> 4;
+			// Where the last rate said it would be that many updates on.  The rate stays per update.
+			predicted = SpindlePeriodEst + SpindlePeriodRate * updates;
+			residual = (float32)LastSpindleClocks - predicted;
+			SpindlePeriodEst = predicted + SPINDLE_ALPHA * residual;
+			SpindlePeriodRate += SPINDLE_BETA * residual / updates;
+			AveragedClocksPerRev = (int32)(SpindlePeriodEst + 0.5);
 			if (AveragedClocksPerRev > 0) {
-				AverageRPM = (int16)((PULSE_CLOCK_RATE * 60L) / (int32)AveragedClocksPerRev);
+				AverageRPM = (int16)((SPINDLE_CLOCK_RATE * 60L) / (int32)AveragedClocksPerRev);
 				RPMState = RPM_STEADY;
 			}
 			else {
@@ -978,10 +2681,13 @@ MotorDevice(void) {
 				RPMState = RPM_SLOWING;
 			}
 			StartTimer(MOTOR_TIMER, T_2_5SEC); 	// Spindle turning timeout timer.
+#ifdef CIRCULAR_INTERPOLATION
+			if (fArcing)
+				ArcFeedRate();					// Same feed per rev at the new speed.
+#endif
 #ifdef DEBUG_SPEED_BUCKETS
-			// Debug 16 buckets and calculated RPM.
-			for (i=0;i<16;)
-				printf((far rom int8 *)"%ld, ",RPMAverage[i++]);
+			// Debug measured period, estimate, rate and calculated RPM.
+			printf((far rom int8 *)"%ld, %ld, %ld, ", LastSpindleClocks, AveragedClocksPerRev, (int32)SpindlePeriodRate);
 			printf((far rom int8 *)"%d, %ld\n",AverageRPM, NewZVel>>16);
 #endif
 		}
@@ -997,6 +2703,8 @@ MotorDevice(void) {
 	  */	
 	  case RPM_SLOWING :
 		AveragedClocksPerRev = 0;
+		SpindlePeriodEst = 0;
+		SpindlePeriodRate = 0;
 		AverageRPM = 0;
 		LastSpindleClocks = 0;		// 12OCT08 -- Fixes slow move rate after spindles stops. 
 											//            This was a side effect of spindle tracking.
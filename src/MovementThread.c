@@ -33,6 +33,14 @@
    	Version changes:
 	1.02m -- AutoInitialized PassCount and SpringPassCount to 0
 	1.10h -- See Config.h for description.
+	1.10r -- X retract and infeed overlap the Z return by CLEARANCE_X_NDX.
+	1.10u -- Ball turning.  Each pass is a quarter circle cut by MotorArcMove.
+	1.10w -- Multi-start threads.  Every start is cut at each depth before the next depth.
+	1.10x -- Constant area infeed.  Thread pass depths are tabled at the start of the cycle.
+	1.10y -- Thread run-up.  With fRunUp a pass starts back from the thread by ThreadRunUpSteps().
+	1.10z -- Feed hold.  MovementFeedHold() and MOVE_HOLD, MOVE_HOLD_BACK and MOVE_RESUME.
+	1.11  -- Thread pull-out.  ArmPullOut() with each threading move to the end.
+	1.11a -- PrintTracking() at the end of each threading pass.
 
 
 */
@@ -121,17 +129,31 @@ G76 Simulation has arguments:								Global Variable array indices
 // The other diagnostic flags are in config.h
 //#define MOVE_DIAGNOSTICS	1
 
+#ifdef HOST_BUILD
+#ifdef MOVE_DIAGNOSTICS
+#define M_DEBUGSTR(...) printf(__VA_ARGS__)
+#else
+#define M_DEBUGSTR(...)
+#endif
+#else
 #ifdef MOVE_DIAGNOSTICS
 #define M_DEBUGSTR(s) printf((far rom int8 *)s)
 #else
 #define M_DEBUGSTR(s)
 #endif
+#endif
 
 enum PASS_STATES PassState = CALCULATE_PASSES;
 
 static float32 TAN_Angle, Adjust_pass, PassDepth, EachPassDepth;
 float32 PassDistance;
 
+// Constant area infeed.  AreaPassDepth[] holds the depth at the end of each pass.
+#define INFEED_PASSES_MAX	24
+static float32 AreaPassDepth[INFEED_PASSES_MAX];
+static uint8 AreaPasses;		// Entries in AreaPassDepth[].  0 uses the FRST, EACH, LAST passes.
+static uint8 AreaPass;			// Entry being cut.
+
 /* ------------  Public Data -------------*/
 enum MOVEMENT_STATES MovementState = MOVE_WAIT;
 
@@ -141,6 +163,24 @@ float32 ZBeginPosition, ZEndPosition;
 
 int32 	XRetractedPositionSteps, XBeginPositionSteps, XEndPositionSteps;
 int32 	XPassSteps;    // Amount to move X per pas
+int32	XClearanceSteps;	// X this far off the cut lets Z move.  0 waits for X to stop.
+static int32 XCutPositionSteps;	// Where X was at the end of the pass.
+static uint8 ThreadStarts;		// THREAD_STARTS_NDX for this set of passes.
+static uint8 ThreadStart;		// Start being cut.  0 is the one on ZPassBeginSteps.
+static int32 ZPassBeginSteps;	// ZBeginPositionSteps of this depth for the first start.
+#ifdef THREAD_RUN_UP
+static int32 ZRunUpAt;			// Where Z was sent back to for the run-up.  ZBeginPositionSteps if none.
+#endif
+#ifdef FEED_HOLD
+static int32 XHoldAt;			// Where X was cutting when the pass was held.
+#endif
+#ifdef THREAD_PULL_OUT
+static int8 PulledOut;			// ArmPullOut() set XCutPositionSteps for this pass.
+#endif
+#ifdef CIRCULAR_INTERPOLATION
+static int32 BallCentreXSteps;	// X on the centre line of the ball.
+static int32 BallEndXSteps;		// X where this pass meets the shoulder at ZEndPositionSteps.
+#endif
 float32 XRetractedPosition, XBeginPosition, XEndPosition;
 float32 AdjustPass, RunTimeAdjust, RunTimeLast; //Added RE
 int8 	PassCount = 0;
@@ -264,8 +304,74 @@ CalculateCompoundPosition(void) {
 }
 
 
+/*
+ *  FUNCTION: ThreadStartSteps
+ *
+ *  PARAMETERS:		start	-- 0 to ThreadStarts-1.
+ *
+ *  USES GLOBALS:	THREAD_SIZE_NDX
+ *					ZDistanceDivisor
+ *					ThreadStarts
+ *					fMovingRight
+ *
+ *  DESCRIPTION:	The starts are spread evenly round the lead so each one begins that
+ *					fraction of a lead further back from the work, on the same index.
+ *
+ *  RETURNS: 		Z steps to add to ZPassBeginSteps.
+ *
+ */
+int32
+ThreadStartSteps(uint8 start) {
+  int32 steps;
+	steps = ((float32)start * GetGlobalVarFloat(THREAD_SIZE_NDX) * ZDistanceDivisor) / ThreadStarts + 0.5;
+	return((fMovingRight) ? -steps : steps);
+}
+
 /* ------------  Public Functions -------------*/
 
+#ifdef CIRCULAR_INTERPOLATION
+/*
+ *  FUNCTION: CalculateBallPosition
+ *
+ *  PARAMETERS:		None
+ *
+ *  USES GLOBALS:	BALL_RADIUS_NDX
+ *					DEPTH_X_NDX
+ *					PassDepth
+ *					XBeginPosition
+ *					ZEndPositionSteps
+ *					fMovingRight
+ *
+ *  DESCRIPTION:	A ball is turned as a quarter circle centred on the axis of the work at
+ *					ZEndPositionSteps.  BEGIN_X_NDX is the finished ball and DEPTH_X_NDX
+ *					the stock left on it, so every pass but the last cuts a larger circle about
+ *					the same centre.  A pass starts on the centre line beyond the tip and
+ *					rises to the shoulder at ZEndPositionSteps.
+ *
+ *  RETURNS: 		Nothing
+ *					XBeginPositionSteps		-- Centre line of the ball.
+ *					ZBeginPositionSteps		-- Tip of the ball for this pass.
+ *
+ */
+void
+CalculateBallPosition(void) {
+  float32 radius;
+	// Radius, depth and pass depth are all kept in inches.
+	radius = GetGlobalVarFloat(BALL_RADIUS_NDX);
+	BallCentreXSteps = XDistanceToSteps(XBeginPosition) - (int32)(radius * XDistanceDivisor + 0.5);
+	// Stock still to come off.
+	radius += GetGlobalVarFloat(DEPTH_X_NDX) - PassDepth;
+	if (radius < 0.0)
+		radius = 0.0;
+	BallEndXSteps = BallCentreXSteps + (int32)(radius * XDistanceDivisor + 0.5);
+	XBeginPositionSteps = BallCentreXSteps;
+	if (fMovingRight)
+		ZBeginPositionSteps = ZEndPositionSteps - (int32)(radius * ZDistanceDivisor + 0.5);
+	else
+		ZBeginPositionSteps = ZEndPositionSteps + (int32)(radius * ZDistanceDivisor + 0.5);
+}
+#endif
+
 /*
     CalculatePosition :
         Determines a new X and Z start position based on the threading parameters and
@@ -284,6 +390,46 @@ CalculateCompoundPosition(void) {
 */
 
 
+/*
+ *  FUNCTION: CalculateAreaPasses
+ *
+ *  PARAMETERS:
+ *
+ *  USES GLOBALS:	DEPTH_X_NDX,
+ *					PASS_FIRST_X_DEPTH_NDX
+ *					PASS_END_X_DEPTH_NDX
+ *
+ *  DESCRIPTION:	Fills AreaPassDepth[] so that every pass removes the chip area of the first pass.
+ *					The area of a V thread grows as the square of its depth so pass k of n ends at
+ *					depth * sqrt(k/n) where n is (depth/first)^2 rounded up.  The last pass depth
+ *					is held back and cut on its own at the end of the table.  A thread too deep
+ *					for the table isn't tabled at all rather than given a heavier first pass.
+ *
+ *  RETURNS: 		Number of passes in the table.  0 if there is no first pass to set the area,
+ *					more than INFEED_PASSES_MAX if the passes don't fit.
+ */
+static uint8
+CalculateAreaPasses(void) {
+  float32 depth, ratio;
+  uint8 passes, pass, last;
+	depth = GetGlobalVarFloat(DEPTH_X_NDX) - GetGlobalVarFloat(PASS_END_X_DEPTH_NDX);
+	if ((GetGlobalVarFloat(PASS_FIRST_X_DEPTH_NDX) <= 0.0) || (depth <= 0.0))
+		return 0;
+	last = (GetGlobalVarFloat(PASS_END_X_DEPTH_NDX) > 0.0);
+	ratio = depth / GetGlobalVarFloat(PASS_FIRST_X_DEPTH_NDX);
+	ratio *= ratio;
+	if (ratio - 0.0001 > (INFEED_PASSES_MAX - last))	// Allowing for float error.
+		return INFEED_PASSES_MAX + 1;
+	passes = ratio;
+	if ((passes == 0) || (ratio - passes > 0.0001))	// Round up, allowing for float error.
+		passes++;
+	for (pass = 1; pass <= passes; pass++)
+		AreaPassDepth[pass - 1] = depth * sqrt((float32)pass / passes);
+	if (last)
+		AreaPassDepth[passes++] = GetGlobalVarFloat(DEPTH_X_NDX);
+	return passes;
+}
+
 /*
 Following modified by RE 23/12/08
 Further modifed 24/12/08
@@ -297,9 +443,12 @@ Further modifed 24/12/08
  *					PASS_EACH_X_DEPTH_NDX
  *					PASS_END_X_DEPTH_NDX
  *					PASS_SPRING_CNT_NDX
+ *					THREAD_STARTS_NDX
  *
  *  DESCRIPTION:	Sets up the values needed for the CalculatePosition State machine when doing
- *					multiple passes.
+ *					multiple passes.  With fConstantArea set a thread's passes come from the
+ *					AreaPassDepth[] table instead.  MOVE_WAIT won't start a thread too deep for
+ *					the table but if it's changed after that the FRST, EACH, LAST passes are cut.
  *
  *  RETURNS: 		Nothing
  *					PassCount //Total number of passes to do
@@ -374,7 +523,23 @@ CalculatePasses(void) {
 			PassCount += (AdjustPasses + EachPasses);
 		}
 	}
+	AreaPasses = 0;
+	AreaPass = 0;
+	if (fConstantArea && fXThreading) {
+		AreaPasses = CalculateAreaPasses();
+		if (AreaPasses > INFEED_PASSES_MAX)
+			AreaPasses = 0;
+		if (AreaPasses != 0) {
+			PassCount = AreaPasses;
+			PassDepth = AreaPassDepth[0];
+		}
+	}
 	SpringPassCount = GetGlobalVarByte(PASS_SPRING_CNT_NDX);
+	ThreadStarts = GetGlobalVarByte(THREAD_STARTS_NDX);
+	if (ThreadStarts == 0)
+		ThreadStarts = 1;
+	ThreadStart = 0;
+	ZPassBeginSteps = ZBeginPositionSteps;
 	M_DEBUGSTR("PassCount=%d, SpringPassCount=%d\n", PassCount, SpringPassCount);
 }
 /*
@@ -423,6 +588,10 @@ switch (PassState) {
 	  */
 	case CALCULATE_PASSES :
 		CalculatePasses();
+		if (AreaPasses != 0) {
+			PassState = AREA_PASS;	// PassDepth is the first entry in the table.
+			break;
+		}
 		// PassDepth currently set to FirstPassDepth which will be added to XStart location.
 		PassState = EACH_PASS;	// Next time run the Each pass.
 		if (PassDepth != 0) {
@@ -472,6 +641,16 @@ switch (PassState) {
 
 	case FINISHED_PASSES :
 		break;
+
+	// Constant area passes straight from the table then spring passes at full depth.
+	case AREA_PASS :
+		if (++AreaPass < AreaPasses)
+			PassDepth = AreaPassDepth[AreaPass];
+		else if (SpringPassCount != 0)
+			PassState = SPRING_PASSES;
+		else
+			PassState = FINISHED_PASSES;
+		break;
 	} // End of Switch
 
 	// Parameters set up s now calculate distance to move.
@@ -516,6 +695,10 @@ switch (PassState) {
 				// Metric Mode is enabled, the ZBeginPosition is correct for SCREW Cutting.
 			 ZBeginPositionSteps = ZDistanceToSteps(ZBeginPosition);
 		}
+#ifdef CIRCULAR_INTERPOLATION
+		if (fBallCutting)
+			CalculateBallPosition();	// Same passes, but round the ball rather than along Z.
+#endif
 	}
 }
 
@@ -560,6 +743,9 @@ InitMovementThread(void) {
 
     ZBeginPosition = (fMetricMode) ? GetGlobalVarFloat(THREAD_BEGIN_NDX) * 25.4 : GetGlobalVarFloat(THREAD_BEGIN_NDX);
     ZBeginPositionSteps = ZDistanceToSteps(ZBeginPosition);
+#ifdef THREAD_RUN_UP
+	ZRunUpAt = ZBeginPositionSteps;
+#endif
 
     ZEndPosition = (fMetricMode) ? GetGlobalVarFloat(THREAD_END_NDX) * 25.4 : GetGlobalVarFloat(THREAD_END_NDX);
     ZEndPositionSteps = ZDistanceToSteps(ZEndPosition);
@@ -634,6 +820,7 @@ MovementStartThread(void) {
         // Grab current position
         INTCON &= 0x3F;
         fXMoveBSY = 0;          // X is now in position.
+        fXApproach = 0;
         CurrentZPosition = ZMotorPosition;
         INTCON |= 0xC0;
         // We're no longer ready
@@ -646,6 +833,10 @@ MovementStartThread(void) {
 	        MovementState = MOVE_WAIT;
         }
     }
+#ifdef FEED_HOLD
+    else if (MovementState == MOVE_HOLD)
+        fMoveStartRQ = 1;       // Pick the held pass up again.
+#endif
 }
 
 /*
@@ -666,6 +857,85 @@ MovementStopThread(void) {
     fRunMachine = 0;    // Request that we stop.
 }
 
+#ifdef THREAD_PULL_OUT
+/*
+ *  FUNCTION: ArmPullOut
+ *
+ *  PARAMETERS:			xCut	-- Where X is cutting this pass.
+ *
+ *  USES GLOBALS:		PULL_OUT_LEADS_NDX, PULL_OUT_ANGLE_NDX, LeadScrewRatio,
+ *						Sets XCutPositionSteps and PulledOut.
+ *
+ *  DESCRIPTION:		Called with the threading move to ZEndPositionSteps just asked for.
+ *						Over the last PULL_OUT_LEADS_NDX leads X comes out at PULL_OUT_ANGLE_NDX
+ *						to the thread axis while Z is still on the helix, so the thread runs out
+ *						on a chamfer instead of a groove and the retract is under way when Z
+ *						stops.  Not for tapers or balls, where X already follows Z.
+ *
+ *  RETURNS: 			Nothing.
+ *
+ */
+static void
+ArmPullOut(int32 xCut) {
+  float32 leads;
+  int32 zSteps, xSteps;
+
+	PulledOut = 0;
+	leads = GetGlobalVarFloat(PULL_OUT_LEADS_NDX);
+	if ((leads <= 0.0) || !fAutoX || !fXThreading || fBroachMode || fBallCutting || fTapering || (LeadScrewRatio <= 0.0))
+		return;
+	INTCON &= 0x3F;
+		CurrentZPosition = ZMotorPosition;
+	INTCON |= 0xC0;
+	zSteps = (int32)(leads * LeadScrewRatio + 0.5);
+	if (zSteps > labs(ZEndPositionSteps - CurrentZPosition))
+		zSteps = labs(ZEndPositionSteps - CurrentZPosition);
+	// Z steps to X steps through the steps per unit of each.
+	xSteps = (int32)(zSteps * tan(GetGlobalVarFloat(PULL_OUT_ANGLE_NDX) * RADIANS_PER_DEGREE)
+				* labs(XDistanceToSteps(100.0)) / labs(ZDistanceToSteps(100.0)) + 0.5);
+	MotorPullOut(zSteps, xSteps, (XRetractedPositionSteps > xCut) ? MOVE_OUT : MOVE_IN);
+	XCutPositionSteps = xCut;
+	PulledOut = 1;
+}
+#endif
+
+#ifdef FEED_HOLD
+/*
+ *  FUNCTION: MovementFeedHold
+ *
+ *  PARAMETERS:			None
+ *
+ *  USES GLOBALS:		MovementState, fRunMachine, fLOkToStop, XHoldAt
+ *
+ *  DESCRIPTION:		STOP held during a threading pass.  MotorFeedHold() stops Z and X
+ *						comes out of the cut.  START then picks the pass up again on the
+ *						same helix, or a STOP tap gives up on it.  Needs an X stepper to get
+ *						the tool clear while Z gets back on the helix.  Tapers and balls
+ *						move X with Z so they're stopped as before.
+ *
+ *  RETURNS: 			0 if held, MSG_MOTOR_STOPPED_ERROR if the caller should just stop.
+ *
+ */
+int8
+MovementFeedHold(void) {
+	if ((MovementState != MOVE_TO_END) || !fAutoX || !fXThreading || fBroachMode || fBallCutting
+			|| fTapering || fTaperXMaster || fArcing)
+		return(MSG_MOTOR_STOPPED_ERROR);
+	if (MotorFeedHold() != 0)
+		return(MSG_MOTOR_STOPPED_ERROR);
+	INTCON &= 0x3F;
+		XHoldAt = XMotorRelPosition;
+	INTCON |= 0xC0;
+	SystemError = MotorMoveTo( MOTOR_X, XRetractedPositionSteps, GetGlobalVarWord(SLEW_RATE_X_NDX), SPINDLE_EITHER );
+	fRunMachine = 1;		// Take back the stop the tap asked for.
+	fLOkToStop = 0;
+	DisplayModeMenuIndex = MSG_FEED_HOLD_MODE;
+	M_DEBUGSTR("Move: HOLD\n");
+	MovementState = MOVE_HOLD;
+	return(0);
+}
+#endif
+
 /*
  *  FUNCTION: MovementThread
  *
@@ -685,6 +955,10 @@ void
 MovementThread(void) {
 static uint16 HomeSpeed, XSpeed;
 static int32 TargetXPosition, TargetZPosition;
+static int32 PhaseSteps;		// Steps Z is moved on along the thread so it needn't wait for the index.
+#ifdef THREAD_RUN_UP
+static int32 RunUpSteps;		// Steps before ZBeginPositionSteps the pass starts at.
+#endif
 
 int8 i,p,c;
 
@@ -715,6 +989,13 @@ int8 i,p,c;
 			if (ZBeginPositionSteps == ZEndPositionSteps) {
                 fRunMachine = 0;    // Ask machine to stop.
 				SystemError = MSG_START_EQUALS_END_ERROR;
+                DisplayModeMenuIndex = SystemError;
+				break;
+			}
+			// Nor cut constant area passes the table can't hold.
+			if (fConstantArea && fXThreading && (CalculateAreaPasses() > INFEED_PASSES_MAX)) {
+                fRunMachine = 0;
+				SystemError = MSG_AREA_PASSES_ERROR;
                 DisplayModeMenuIndex = SystemError;
 				break;
 			}
@@ -889,6 +1170,28 @@ int8 i,p,c;
             DisplayModeMenuIndex = SystemError;
             break;
         }
+#ifdef MOTION_QUEUE
+        if (fAutoX && fXMoveBSY && fXApproach) {
+            // Queue the rest of the infeed behind the approach so X runs on through the
+            // clearance point instead of stopping there.
+            fXApproach = 0;
+            XSpeed = GetGlobalVarWord(SLEW_RATE_X_NDX);
+            SystemError = MotorQueueMove( MOTOR_X, XClearanceSteps, XSpeed,
+            						(XRetractedPositionSteps > XBeginPositionSteps) ? MOVE_IN : MOVE_OUT );
+            if (SystemError == -1)
+                SystemError = 0;    // No room so wait for X to stop.
+            else if (SystemError == 0) {
+                fLOkToStop = 0;     // No stop while X axis moving in.
+                DisplayModeMenuIndex = MSG_INSERT_TOOL_MODE;
+                M_DEBUGSTR("Tool runs on in\n");
+                M_DEBUGSTR("Move: WAIT_X_DONE\n");
+                MovementState = MOVE_WAIT_X_DONE;
+            }
+            break;
+        }
+#endif
+        if (fAutoX && fXMoveBSY)
+            break;              // Overlapped retract or approach still going.
         if (fAutoX) {
             // X axis has a stepper which is either direct or through CAN Bus.
             // So move X into work              newDistance = XRetractedPositionSteps - XCurrentPositionSteps;
@@ -1087,7 +1390,11 @@ int8 i,p,c;
 			CurrentZPosition = ZMotorPosition;
         INTCON |= 0xC0;
 
-        if (CurrentZPosition != ZBeginPositionSteps) {
+        if ((CurrentZPosition != ZBeginPositionSteps)
+#ifdef THREAD_RUN_UP
+        		&& (CurrentZPosition != ZRunUpAt)
+#endif
+        		) {
                 fLOkToStop = 1;
                 M_DEBUGSTR("Move: WAIT\n");
                 MovementState = MOVE_WAIT;
@@ -1108,13 +1415,53 @@ int8 i,p,c;
 
                 // Do our thread or turning pass.
                 M_DEBUGSTR("Thread to End ... ");
+				PhaseSteps = 0;
+#ifdef THREAD_RUN_UP
+				RunUpSteps = (fRunUp && fXThreading) ? ThreadRunUpSteps(ZEndPositionSteps - ZBeginPositionSteps) : 0;
+#endif
 				if (fBroachMode)
 					SystemError = MotorMoveTo( MOTOR_Z, ZEndPositionSteps, HomeSpeed, SPINDLE_EITHER );
+#ifdef CIRCULAR_INTERPOLATION
+				// Round from the tip to the shoulder.
+				else if (fBallCutting)
+					SystemError = MotorArcMove(ZEndPositionSteps, BallEndXSteps, ZEndPositionSteps, BallCentreXSteps);
+#endif
+#ifdef TAPERING
+				// Steeper than 45 degrees in steps so Z follows X.
+				else if (fTapering && fTaperSteep)
+					SystemError = MotorTaperMove(ZEndPositionSteps);
+#endif
+#ifdef THREAD_RUN_UP
+				// Back far enough for Z to be up to speed, and on the helix, at the start of
+				// the thread.  Then start on the index.  Z may already be there from the return.
+				else if (RunUpSteps != 0) {
+					if ((PhaseSteps = ZBeginPositionSteps - RunUpSteps - CurrentZPosition) != 0) {
+						ZRunUpAt = CurrentZPosition + PhaseSteps;
+						SystemError = MotorMoveTo( MOTOR_Z, ZRunUpAt, GetGlobalVarWord(SLEW_RATE_Z_NDX), SPINDLE_EITHER );
+					}
+					else
+						SystemError = MotorMoveTo( MOTOR_Z, ZEndPositionSteps, SPEED_TRACK_SPINDLE, SPINDLE_TURNING );
+				}
+#endif
+#ifdef THREAD_PHASE_START
+				// Slew on along the thread to where the helix will be shortly rather than
+				// wait up to a turn for the index.
+				else if ((PhaseSteps = ThreadPhaseSteps(GetGlobalVarWord(SLEW_RATE_Z_NDX), ZEndPositionSteps - ZBeginPositionSteps)) != 0)
+					SystemError = MotorMoveTo( MOTOR_Z, ZBeginPositionSteps + PhaseSteps, GetGlobalVarWord(SLEW_RATE_Z_NDX), SPINDLE_EITHER );
+#endif
                 else
 					SystemError = MotorMoveTo( MOTOR_Z, ZEndPositionSteps, SPEED_TRACK_SPINDLE, SPINDLE_TURNING );
 
 				if (SystemError == 0) {
                     DisplayModeMenuIndex = MSG_THREAD_END_MODE;
+					if (PhaseSteps != 0) {
+	                    M_DEBUGSTR("Move: TO_PHASE\n");
+	                    MovementState = MOVE_TO_PHASE;
+						break;
+					}
+#ifdef THREAD_PULL_OUT
+					ArmPullOut(XMotorRelPosition);
+#endif
                     M_DEBUGSTR("Threading to End Position\n");
                     M_DEBUGSTR("Move: TO_END\n");
                     MovementState = MOVE_TO_END;
@@ -1144,12 +1491,38 @@ int8 i,p,c;
 
 
 
+      /*
+        MOVE_TO_PHASE --
+            Z is being moved on along the thread to where this pass joins the helix,
+            or back to its run-up.
+            Then thread to the end, starting when the spindle comes round to match.
+      */
+      case MOVE_TO_PHASE :
+        if (!fZMoveRQ && !fZMoveBSY) {      // Z is there.
+            if (SystemError == 0)
+                SystemError = MotorMoveTo( MOTOR_Z, ZEndPositionSteps, SPEED_TRACK_SPINDLE, SPINDLE_TURNING );
+            if (SystemError != 0) {
+                fLOkToStop = 1;
+                fRunMachine = 0;    // Ask machine to stop.
+                MovementState = MOVE_WAIT;
+                DisplayModeMenuIndex = SystemError;
+                break;
+            }
+#ifdef THREAD_PULL_OUT
+            ArmPullOut(XMotorRelPosition);
+#endif
+            M_DEBUGSTR("Threading to End Position\n");
+            M_DEBUGSTR("Move: TO_END\n");
+            MovementState = MOVE_TO_END;
+        }
+        break;
+
       /*
         MOVE_TO_END --
             Wait till end point is reached.
       */
       case MOVE_TO_END :
-        if (!fZMoveRQ && !fZMoveBSY) {      // Z move is complete.
+        if (!fZMoveRQ && !fZMoveBSY && !fTaperXMaster && !fArcing) {      // Z move is complete.
             fLOkToStop = 1;
             // Move is done or we've hit a limit or ESTOP.
             if (SystemError != 0) {
@@ -1158,6 +1531,10 @@ int8 i,p,c;
                 DisplayModeMenuIndex = SystemError;
                 break;
             }
+#ifdef TRACK_SPINDLE_SPEED
+            if (fXThreading && !fBroachMode)
+                PrintTracking();    // How well that pass followed the spindle.
+#endif
             DisplayModeMenuIndex = MSG_THREAD_END_MODE;
             M_DEBUGSTR("Move: AT_END\n");
             MovementState = MOVE_AT_END;
@@ -1183,6 +1560,17 @@ int8 i,p,c;
             // X axis has a stepper which is either direct or through CAN Bus.
             // So move X out of the work.
             XSpeed = GetGlobalVarWord(SLEW_RATE_X_NDX);
+            XClearanceSteps = labs(XDistanceToSteps((fMetricMode) ? GetGlobalVarFloat(CLEARANCE_X_NDX) * 25.4 : GetGlobalVarFloat(CLEARANCE_X_NDX)));
+#ifdef THREAD_PULL_OUT
+            if (!PulledOut) {	// Otherwise X was cutting where it started pulling out.
+#endif
+            INTCON &= 0x3F;
+				XCutPositionSteps = XMotorRelPosition;
+            INTCON |= 0xC0;
+#ifdef THREAD_PULL_OUT
+            }
+            PulledOut = 0;
+#endif
 
             if ((SystemError = MotorMoveTo( MOTOR_X, XRetractedPositionSteps, XSpeed, SPINDLE_EITHER )) != 0) {
                 fLOkToStop = 1;
@@ -1214,9 +1602,15 @@ int8 i,p,c;
       /*
         MOVE_WAIT_END_OUT --
             Now wait for operator to remove tool (or do it automatically)
+            An automatic retract only has to get XClearanceSteps off the cut before
+            Z can head back while X carries on out.
       */
       case MOVE_WAIT_END_OUT :
-        if ( !fXMoveBSY )  { // X axis move is complete
+        INTCON &= 0x3F;
+			CurrentXPosition = XMotorRelPosition;
+        INTCON |= 0xC0;
+        if ( !fXMoveBSY || (fAutoX && (XClearanceSteps != 0) && ((PassCount+SpringPassCount) > 0)
+        		&& (labs(CurrentXPosition - XCutPositionSteps) >= XClearanceSteps)) )  { // X axis clear of the work
             // Move is done or we've hit a limit or ESTOP.
             if (SystemError != 0) {
                 fRunMachine = 0;    // Ask machine to stop.
@@ -1224,7 +1618,7 @@ int8 i,p,c;
                 DisplayModeMenuIndex = SystemError;
                 break;
             }
-            fLOkToStop = 1;
+            fLOkToStop = !fXMoveBSY;    // Not while X is still on its way out.
             M_DEBUGSTR("Move: WAIT_END\n");
             MovementState = MOVE_WAIT_END;
         }
@@ -1245,8 +1639,9 @@ int8 i,p,c;
                 break;
             }
 			// Since user was allowed to stop machine the X axis may not be where we think it is.
-			// Check that and if it's not retracted, go yank it out first.
-			if (XMotorRelPosition != XRetractedPositionSteps) {
+			// Check that and if it's not retracted, go yank it out first.  X may still be on its
+			// way out from an overlapped retract.
+			if (!fXMoveBSY && (XMotorRelPosition != XRetractedPositionSteps)) {
 	            DisplayModeMenuIndex = MSG_THREAD_END_MODE;
     	        M_DEBUGSTR("Move: AT_END\n");
         	    MovementState = MOVE_AT_END;
@@ -1258,23 +1653,40 @@ int8 i,p,c;
             // Under automatic mode, and threading, do all depth passes and do the extra finishing pass
             // at the final depth.
             // If not using the compound then Calculate the new Z and X positions.
-            if (/*(fAutoX || fUseCompound) &&*/ fXThreading) {
+            // A multi-start thread cuts the rest of its starts at this depth first.
+            if (fXThreading && (PassState != CALCULATE_PASSES) && (++ThreadStart < ThreadStarts)) {
+				ZBeginPositionSteps = ZPassBeginSteps + ThreadStartSteps(ThreadStart);
+            }
+            else if (/*(fAutoX || fUseCompound) &&*/ fXThreading || fBallCutting) {
+				ThreadStart = 0;
                 if (PassCount > 0) {
                     PassCount = (--PassCount <= 0) ? 0 : PassCount;
                 }
                 else if (SpringPassCount > 0) {
                     SpringPassCount = (--SpringPassCount <= 0) ? 0 : SpringPassCount;
                 }
-				CalculatePosition(fUseCompound);		// If using compound don't actually change position here
-				if (fUseCompound)  // Now calculate hypotenuse and use that instead).
+				CalculatePosition(fUseCompound && !fBallCutting);		// If using compound don't actually change position here
+				if (fUseCompound && !fBallCutting)  // Now calculate hypotenuse and use that instead).
 					CalculateCompoundPosition();
-
+				if (PassState == FINISHED_PASSES)	// Back to the first start for a pass after this.
+					ZBeginPositionSteps = ZPassBeginSteps;
+				else
+					ZPassBeginSteps = ZBeginPositionSteps;
             }
             M_DEBUGSTR("Return To Start ... ");
+            fXApproach = 0;
+#ifdef THREAD_RUN_UP
+			// Straight back to the run-up at the present RPM.
+			ZRunUpAt = ZBeginPositionSteps;
+			if (fRunUp && fXThreading)
+				ZRunUpAt -= ThreadRunUpSteps(ZEndPositionSteps - ZBeginPositionSteps);
+            MotorMoveTo( MOTOR_Z, ZRunUpAt, HomeSpeed, SPINDLE_EITHER );
+#else
             MotorMoveTo( MOTOR_Z, ZBeginPositionSteps, HomeSpeed, SPINDLE_EITHER );
+#endif
 
             // If we're turning terminate at the end of this single pass.
-            if (!fXThreading) {
+            if (!fXThreading && !fBallCutting) {
                 PassCount = 0;
 				SpringPassCount = 0;
             }
@@ -1295,6 +1707,34 @@ int8 i,p,c;
             Heading back to start position.
       */
       case MOVE_WAIT_TO_START :
+        // Bring X in to XClearanceSteps off the next cut while Z is still on its way.
+        // The rest of the infeed waits for Z in MOVE_AT_START.
+        // Not for a ball, where X goes in to the centre line ahead of the work.
+        // With the motion queue the approach goes in behind a retract that's still running.
+        INTCON &= 0x3F;
+			CurrentXPosition = XMotorRelPosition;
+        INTCON |= 0xC0;
+#ifdef MOTION_QUEUE
+        if (fAutoX && !fBallCutting && !fXApproach && (XClearanceSteps != 0)
+        		&& (fXMoveBSY || (CurrentXPosition == XRetractedPositionSteps))
+        		&& (labs(XRetractedPositionSteps - XBeginPositionSteps) > XClearanceSteps)) {
+            XSpeed = GetGlobalVarWord(SLEW_RATE_X_NDX);
+            SystemError = MotorQueueMove( MOTOR_X, labs(XRetractedPositionSteps - XBeginPositionSteps) - XClearanceSteps,
+            						XSpeed, (XRetractedPositionSteps > XBeginPositionSteps) ? MOVE_IN : MOVE_OUT );
+            if (SystemError == -1)
+                SystemError = 0;    // Try again next time round.
+            else
+                fXApproach = (SystemError == 0);
+#else
+        if (fAutoX && !fBallCutting && !fXMoveBSY && (XClearanceSteps != 0) && (CurrentXPosition == XRetractedPositionSteps)
+        		&& (labs(XRetractedPositionSteps - XBeginPositionSteps) > XClearanceSteps)) {
+            XSpeed = GetGlobalVarWord(SLEW_RATE_X_NDX);
+            SystemError = MotorMoveTo( MOTOR_X, (XRetractedPositionSteps > XBeginPositionSteps) ?
+            						XBeginPositionSteps + XClearanceSteps : XBeginPositionSteps - XClearanceSteps,
+            						XSpeed, SPINDLE_EITHER );
+#endif
+            M_DEBUGSTR("X to clearance\n");
+        }
         if (!fZMoveRQ && !fZMoveBSY) {      // Z move is complete.
             fLOkToStop = 1;     // Allow stop button to work.
             // Move is done or we've hit a limit or ESTOP.
@@ -1307,7 +1747,11 @@ int8 i,p,c;
             INTCON &= 0x3F;
 				CurrentZPosition = ZMotorPosition;
             INTCON |= 0xC0;
-            if (CurrentZPosition == ZBeginPositionSteps) {
+            if ((CurrentZPosition == ZBeginPositionSteps)
+#ifdef THREAD_RUN_UP
+            		|| (CurrentZPosition == ZRunUpAt)
+#endif
+            		) {
                 M_DEBUGSTR("Move: TO_START\n");
                 MovementState = MOVE_TO_START;
             }
@@ -1318,5 +1762,97 @@ int8 i,p,c;
         }
         break;
 
+#ifdef FEED_HOLD
+      /*
+        MOVE_HOLD --
+            Feed hold.  Z is stopping off the helix and X is coming out of the cut.
+            Then START picks the pass up, backing Z up far enough to be on the helix
+            again with X back in before it gets to where it stopped.  STOP gives up.
+      */
+      case MOVE_HOLD :
+        if (fZAxisActive || fXMoveBSY)
+            break;              // Still stopping.
+        fLOkToStop = 1;
+        if ((SystemError != 0) || !fRunMachine) {
+            fRunMachine = 0;    // Ask machine to stop.
+            if (SystemError != 0)
+                DisplayModeMenuIndex = SystemError;
+            M_DEBUGSTR("Move: WAIT\n");
+            MovementState = MOVE_WAIT;
+            break;
+        }
+        if (fMoveStartRQ) {
+            fMoveStartRQ = 0;
+            if (!fSpindleTurning) {
+                fRunMachine = 0;    // Ask machine to stop.
+                DisplayModeMenuIndex = MSG_SPINDLE_OFF_MODE;
+                SystemError = MSG_SPINDLE_OFF_MODE;
+                M_DEBUGSTR("Move: WAIT\n");
+                MovementState = MOVE_WAIT;
+                break;
+            }
+            XSpeed = GetGlobalVarWord(SLEW_RATE_X_NDX);
+            TargetZPosition = MotorResumeAt(ZEndPositionSteps - ZBeginPositionSteps,
+            					labs(XRetractedPositionSteps - XHoldAt), XSpeed);
+            if ((SystemError = MotorMoveTo( MOTOR_Z, TargetZPosition, GetGlobalVarWord(SLEW_RATE_Z_NDX), SPINDLE_EITHER )) != 0) {
+                fRunMachine = 0;    // Ask machine to stop.
+                MovementState = MOVE_WAIT;
+                DisplayModeMenuIndex = SystemError;
+                break;
+            }
+            fLOkToStop = 0;
+            DisplayModeMenuIndex = MSG_THREAD_END_MODE;
+            M_DEBUGSTR("Move: HOLD_BACK\n");
+            MovementState = MOVE_HOLD_BACK;
+        }
+        break;
+
+      /*
+        MOVE_HOLD_BACK --
+            Z is backing up for the resume.  Then thread on to the end starting at the
+            spindle phase MotorResumeAt() worked out.
+      */
+      case MOVE_HOLD_BACK :
+        if (!fZMoveRQ && !fZMoveBSY) {
+            if (SystemError == 0)
+                SystemError = MotorMoveTo( MOTOR_Z, ZEndPositionSteps, SPEED_TRACK_SPINDLE, SPINDLE_TURNING );
+            if (SystemError != 0) {
+                fLOkToStop = 1;
+                fRunMachine = 0;    // Ask machine to stop.
+                MovementState = MOVE_WAIT;
+                DisplayModeMenuIndex = SystemError;
+                break;
+            }
+#ifdef THREAD_PULL_OUT
+            ArmPullOut(XHoldAt);	// X is back in before Z gets there.
+#endif
+            M_DEBUGSTR("Move: RESUME\n");
+            MovementState = MOVE_RESUME;
+        }
+        break;
+
+      /*
+        MOVE_RESUME --
+            Once Z is up to speed it's back on the helix so X can go back in.
+      */
+      case MOVE_RESUME :
+        if (!fSpindleTurning) {
+            MotorStop(MOTOR_Z);             // So stop motor
+            fLOkToStop = 1;
+            fRunMachine = 0;    // Ask machine to stop.
+            DisplayModeMenuIndex = MSG_SPINDLE_OFF_MODE;
+            SystemError = MSG_SPINDLE_OFF_MODE;
+            M_DEBUGSTR("Move: WAIT\n");
+            MovementState = MOVE_WAIT;
+        }
+        else if (!fZMoveRQ && (fZUpToSpeed || !fZMoveBSY)) {
+            if (fZMoveBSY)
+                SystemError = MotorMoveTo( MOTOR_X, XHoldAt, XSpeed, SPINDLE_EITHER );
+            M_DEBUGSTR("Move: TO_END\n");
+            MovementState = MOVE_TO_END;
+        }
+        break;
+#endif
+
     }
 }